@@ -12,7 +12,12 @@
 // Qt
 #include <QKeyEvent>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 // Konsole
+#include "RenderScheduler.h"
 #include "Screen.h"
 #include "ScreenWindow.h"
 #include "keyboardtranslator/KeyboardTranslator.h"
@@ -27,20 +32,22 @@ Emulation::Emulation()
     , _keyTranslator(nullptr)
     , _usesMouseTracking(false)
     , _bracketedPasteMode(false)
-    , _bulkTimer1(QTimer(this))
-    , _bulkTimer2(QTimer(this))
     , _imageSizeInitialized(false)
+    , _largeChunks(0)
+    , _outputBacklogged(false)
+    , _receivedSinceUpdate(false)
     , _peekingPrimary(false)
     , _activeScreenIndex(0)
+    , _receiveBuffer(QVector<uint>())
+    , _utf8CodePoint(0)
+    , _utf8Remaining(0)
+    , _utf8Minimum(0)
 {
     // create screens with a default size
     _screen[0] = new Screen(40, 80);
     _screen[1] = new Screen(40, 80);
     _currentScreen = _screen[0];
 
-    QObject::connect(&_bulkTimer1, &QTimer::timeout, this, &Konsole::Emulation::showBulk);
-    QObject::connect(&_bulkTimer2, &QTimer::timeout, this, &Konsole::Emulation::showBulk);
-
     // listen for mouse status changes
     connect(this, &Konsole::Emulation::programRequestsMouseTracking, this, &Konsole::Emulation::setUsesMouseTracking);
     connect(this, &Konsole::Emulation::programBracketedPasteModeChanged, this, &Konsole::Emulation::bracketedPasteModeChanged);
@@ -98,6 +105,11 @@ void Emulation::checkSelectedText()
 
 Emulation::~Emulation()
 {
+    // the scheduler may already be gone when emulations are destroyed on exit
+    if (RenderScheduler *scheduler = RenderScheduler::instance()) {
+        scheduler->cancelUpdate(this);
+    }
+
     for (ScreenWindow *window : qAsConst(_windows)) {
         delete window;
     }
@@ -161,6 +173,7 @@ void Emulation::setCodec(const QTextCodec *codec)
         _codec = codec;
 
         _decoder.reset(_codec->makeDecoder());
+        _utf8Remaining = 0;
 
         Q_EMIT useUtf8Request(utf8());
     } else {
@@ -233,31 +246,145 @@ void Emulation::receiveData(const char *text, int length)
 {
     Q_ASSERT(_decoder);
 
-    bufferedUpdate();
+    updateOutputBacklog(length);
+    RenderScheduler::instance()->scheduleUpdate(this, length);
+
+    if (utf8()) {
+        // decode straight into _receiveBuffer, looking for the z-modem
+        // indicator on the way
+        const ZModemState zmodem = decodeUtf8(text, length);
+        receiveChars(_receiveBuffer);
+        notifyZModem(zmodem);
+        return;
+    }
 
     // send characters to terminal emulator
     const QVector<uint> chars = _decoder->toUnicode(text, length).toUcs4();
     receiveChars(chars);
 
     // look for z-modem indicator
-    //-- someone who understands more about z-modems that I do may be able to move
-    // this check into the above for loop?
+    ZModemState zmodem = NoZModem;
     auto *found = static_cast<const char *>(memchr(text, '\030', length));
-    if (found) {
-        auto startPos = text - found;
-        if (startPos < 0) {
-            return;
+    while (found != nullptr) {
+        const int pos = found - text;
+        zmodem = checkZModem(text, pos, length, zmodem);
+        found = static_cast<const char *>(memchr(found + 1, '\030', length - pos - 1));
+    }
+    notifyZModem(zmodem);
+}
+
+Emulation::ZModemState Emulation::checkZModem(const char *text, int pos, int length, ZModemState state)
+{
+    // <CAN> 'B' '0' '0' starts a download, <CAN> 'B' '0' '1' an upload
+    if (pos + 3 < length && text[pos + 1] == 'B' && text[pos + 2] == '0') {
+        if (text[pos + 3] == '0') {
+            return ZModemDownload;
+        } else if (text[pos + 3] == '1') {
+            return ZModemUpload;
+        }
+    }
+    return state;
+}
+
+void Emulation::notifyZModem(ZModemState state)
+{
+    if (state == ZModemDownload) {
+        Q_EMIT zmodemDownloadDetected();
+    } else if (state == ZModemUpload) {
+        Q_EMIT zmodemUploadDetected();
+    }
+}
+
+// Widens the leading run of ASCII bytes of @p src into @p dst and returns its
+// length. The run also stops at <CAN>, which may start a z-modem indicator.
+static int widenAscii(const uchar *src, int length, uint *dst)
+{
+    int i = 0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i cancel = _mm_set1_epi8('\030');
+    for (; i + 16 <= length; i += 16) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        // the high bit is set for non-ASCII bytes, and for <CAN> after the compare
+        if (_mm_movemask_epi8(_mm_or_si128(bytes, _mm_cmpeq_epi8(bytes, cancel))) != 0) {
+            break;
+        }
+        const __m128i low = _mm_unpacklo_epi8(bytes, zero);
+        const __m128i high = _mm_unpackhi_epi8(bytes, zero);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_unpacklo_epi16(low, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i + 4), _mm_unpackhi_epi16(low, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i + 8), _mm_unpacklo_epi16(high, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i + 12), _mm_unpackhi_epi16(high, zero));
+    }
+#endif
+    for (; i < length && src[i] < 0x80 && src[i] != '\030'; ++i) {
+        dst[i] = src[i];
+    }
+    return i;
+}
+
+Emulation::ZModemState Emulation::decodeUtf8(const char *text, int length)
+{
+    static const uint REPLACEMENT_CHARACTER = 0xfffd;
+
+    const auto *src = reinterpret_cast<const uchar *>(text);
+    ZModemState zmodem = NoZModem;
+
+    // Every byte produces at most one code point, plus one for an incomplete
+    // sequence left over from the previous call which turns out to be invalid
+    _receiveBuffer.resize(length + 1);
+    uint *dst = _receiveBuffer.data();
+    int count = 0;
+
+    int i = 0;
+    while (i < length) {
+        if (_utf8Remaining == 0) {
+            const int ascii = widenAscii(src + i, length - i, dst + count);
+            i += ascii;
+            count += ascii;
+            if (i == length) {
+                break;
+            }
         }
-        for (int i = startPos; i < length - 4; i++) {
-            if (text[i] == '\030') {
-                if (qstrncmp(text + i + 1, "B00", 3) == 0) {
-                    Q_EMIT zmodemDownloadDetected();
-                } else if (qstrncmp(text + i + 1, "B01", 3) == 0) {
-                    Q_EMIT zmodemUploadDetected();
-                }
+
+        const uchar byte = src[i];
+
+        if (_utf8Remaining > 0) {
+            if ((byte & 0xc0) != 0x80) {
+                // sequence cut short, reprocess the byte on its own
+                dst[count++] = REPLACEMENT_CHARACTER;
+                _utf8Remaining = 0;
+                continue;
+            }
+            _utf8CodePoint = (_utf8CodePoint << 6) | (byte & 0x3f);
+            if (--_utf8Remaining == 0) {
+                const bool invalid = _utf8CodePoint < _utf8Minimum || _utf8CodePoint > 0x10ffff || (_utf8CodePoint >= 0xd800 && _utf8CodePoint <= 0xdfff);
+                dst[count++] = invalid ? REPLACEMENT_CHARACTER : _utf8CodePoint;
             }
+        } else if (byte < 0x80) {
+            // <CAN>
+            zmodem = checkZModem(text, i, length, zmodem);
+            dst[count++] = byte;
+        } else if (byte >= 0xc2 && byte <= 0xdf) {
+            _utf8CodePoint = byte & 0x1f;
+            _utf8Remaining = 1;
+            _utf8Minimum = 0x80;
+        } else if (byte >= 0xe0 && byte <= 0xef) {
+            _utf8CodePoint = byte & 0x0f;
+            _utf8Remaining = 2;
+            _utf8Minimum = 0x800;
+        } else if (byte >= 0xf0 && byte <= 0xf4) {
+            _utf8CodePoint = byte & 0x07;
+            _utf8Remaining = 3;
+            _utf8Minimum = 0x10000;
+        } else {
+            dst[count++] = REPLACEMENT_CHARACTER;
         }
+        ++i;
     }
+
+    _receiveBuffer.resize(count);
+    return zmodem;
 }
 
 void Emulation::writeToStream(TerminalCharacterDecoder *decoder, int startLine, int endLine)
@@ -271,28 +398,65 @@ int Emulation::lineCount() const
     return _currentScreen->getLines() + _currentScreen->getHistLines();
 }
 
+bool Emulation::isOutputBacklogged() const
+{
+    return _outputBacklogged;
+}
+
+void Emulation::updateOutputBacklog(int length)
+{
+    // The pty is read as soon as there is any output, so a chunk of this size
+    // means that the output was waiting to be read
+    static const int LARGE_CHUNK_SIZE = 2048;
+    // Number of large chunks in a row after which the output is backlogged
+    static const int BACKLOG_CHUNKS = 32;
+
+    _receivedSinceUpdate = true;
+    _largeChunks = length >= LARGE_CHUNK_SIZE ? _largeChunks + 1 : 0;
+
+    // full screen programs on the alternate screen are always drawn, as
+    // their intermediate images are meant to be seen
+    setOutputBacklogged(_largeChunks >= BACKLOG_CHUNKS && _currentScreen == _screen[0]);
+}
+
+void Emulation::setOutputBacklogged(bool backlogged)
+{
+    if (backlogged == _outputBacklogged) {
+        return;
+    }
+
+    _outputBacklogged = backlogged;
+    Q_EMIT outputBackloggedChanged(backlogged);
+}
+
 void Emulation::showBulk()
 {
-    _bulkTimer1.stop();
-    _bulkTimer2.stop();
+    RenderScheduler::instance()->cancelUpdate(this);
+
+    if (_outputBacklogged) {
+        if (_receivedSinceUpdate) {
+            // keep the changes for the next update, and check again with the
+            // next frame whether the output has stopped
+            _receivedSinceUpdate = false;
+            bufferedUpdate();
+            Q_EMIT outputSkipped();
+            return;
+        }
+        _largeChunks = 0;
+        setOutputBacklogged(false);
+    }
+    _receivedSinceUpdate = false;
 
     Q_EMIT outputChanged();
 
     _currentScreen->resetScrolledLines();
     _currentScreen->resetDroppedLines();
+    _currentScreen->resetDirtyLines();
 }
 
 void Emulation::bufferedUpdate()
 {
-    static const int BULK_TIMEOUT1 = 10;
-    static const int BULK_TIMEOUT2 = 40;
-
-    _bulkTimer1.setSingleShot(true);
-    _bulkTimer1.start(BULK_TIMEOUT1);
-    if (!_bulkTimer2.isActive()) {
-        _bulkTimer2.setSingleShot(true);
-        _bulkTimer2.start(BULK_TIMEOUT2);
-    }
+    RenderScheduler::instance()->scheduleUpdate(this);
 }
 
 char Emulation::eraseChar() const
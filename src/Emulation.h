@@ -108,6 +108,12 @@ public:
      */
     int lineCount() const;
 
+    /**
+     * Returns true while the output of the program arrives faster than it
+     * could be displayed, see outputBackloggedChanged()
+     */
+    bool isOutputBacklogged() const;
+
     /**
      * Sets the history store used by this emulation.  When new lines
      * are added to the output, older lines at the top of the screen are transferred to a history
@@ -305,6 +311,24 @@ Q_SIGNALS:
      */
     void outputChanged();
 
+    /**
+     * Emitted when the primary screen receives a sustained stream of output,
+     * i.e. the output arrives in large chunks, because the program writes it
+     * faster than the emulation reads it.
+     *
+     * While the output is backlogged, outputSkipped() is emitted in place of
+     * outputChanged(), so that no intermediate screen images nobody could
+     * read are drawn.  Once the output slows down or stops, outputChanged()
+     * is emitted again with all of the changes.
+     */
+    void outputBackloggedChanged(bool backlogged);
+
+    /**
+     * Emitted in place of outputChanged() while the output is backlogged,
+     * see outputBackloggedChanged()
+     */
+    void outputSkipped();
+
     /**
      * Emitted when the program running in the terminal wishes to update
      * certain session attributes. This allows terminal programs to customize
@@ -449,7 +473,8 @@ protected:
 
 protected Q_SLOTS:
     /**
-     * Schedules an update of attached views.
+     * Schedules an update of attached views with the next frame of the
+     * RenderScheduler.
      * Repeated calls to bufferedUpdate() in close succession will result in only a single update,
      * much like the Qt buffered update of widgets.
      */
@@ -462,25 +487,53 @@ protected Q_SLOTS:
     void checkSelectedText();
 
 private Q_SLOTS:
-    // triggered by timer, causes the emulation to send an updated screen image to each
-    // view
-    void showBulk();
-
     void setUsesMouseTracking(bool usesMouseTracking);
 
     void bracketedPasteModeChanged(bool bracketedPasteMode);
 
 private:
+    friend class RenderScheduler;
+
+    // called by the RenderScheduler, causes the emulation to send an updated
+    // screen image to each view
+    void showBulk();
+
     void setScreenInternal(int index);
     Q_DISABLE_COPY(Emulation)
 
+    enum ZModemState {
+        NoZModem,
+        ZModemDownload,
+        ZModemUpload,
+    };
+
+    // returns the z-modem transfer announced by the <CAN> at text[pos], or
+    // @p state if there is none
+    static ZModemState checkZModem(const char *text, int pos, int length, ZModemState state);
+    void notifyZModem(ZModemState state);
+
+    // decodes UTF-8 into _receiveBuffer without going through _decoder,
+    // keeping incomplete sequences for the next call
+    ZModemState decodeUtf8(const char *text, int length);
+
+    // updates isOutputBacklogged() after receiving a chunk of @p length bytes
+    void updateOutputBacklog(int length);
+    void setOutputBacklogged(bool backlogged);
+
     bool _usesMouseTracking;
     bool _bracketedPasteMode;
-    QTimer _bulkTimer1;
-    QTimer _bulkTimer2;
     bool _imageSizeInitialized;
+    int _largeChunks; // number of large chunks of input received in a row
+    bool _outputBacklogged; // see isOutputBacklogged()
+    bool _receivedSinceUpdate; // true if input was received since the last showBulk()
     bool _peekingPrimary;
     int _activeScreenIndex;
+
+    // reused for every chunk of UTF-8 input, see decodeUtf8()
+    QVector<uint> _receiveBuffer;
+    uint _utf8CodePoint;
+    int _utf8Remaining;
+    uint _utf8Minimum;
 };
 }
 
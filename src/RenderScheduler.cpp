@@ -0,0 +1,152 @@
+/*
+    SPDX-FileCopyrightText: 2022 Konsole Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+// Own
+#include "RenderScheduler.h"
+
+// Qt
+#include <QGuiApplication>
+#include <QScreen>
+
+// Konsole
+#include "Emulation.h"
+
+using namespace Konsole;
+
+// Used when the refresh rate of the screen is unknown, e.g. without a GUI
+static const int DEFAULT_FRAME_INTERVAL = 16;
+
+RenderScheduler::RenderScheduler()
+    : _pendingUpdates(QHash<Emulation *, PendingUpdate>())
+    , _frameTimer(QTimer(this))
+    , _lastFrameTime(-1)
+{
+    _frameTimer.setSingleShot(true);
+    _frameTimer.setTimerType(Qt::PreciseTimer);
+    connect(&_frameTimer, &QTimer::timeout, this, &Konsole::RenderScheduler::renderFrame);
+
+    _clock.start();
+}
+
+RenderScheduler::~RenderScheduler() = default;
+
+Q_GLOBAL_STATIC(RenderScheduler, theRenderScheduler)
+RenderScheduler *RenderScheduler::instance()
+{
+    return theRenderScheduler;
+}
+
+void RenderScheduler::scheduleUpdate(Emulation *emulation, int receivedBytes)
+{
+    _pendingUpdates[emulation].receivedBytes += receivedBytes;
+    startFrameTimer();
+}
+
+void RenderScheduler::cancelUpdate(Emulation *emulation)
+{
+    _pendingUpdates.remove(emulation);
+}
+
+bool RenderScheduler::isInThroughputMode(Emulation *emulation) const
+{
+    return _pendingUpdates.value(emulation).throughputMode;
+}
+
+int RenderScheduler::frameInterval() const
+{
+    const QScreen *screen = QGuiApplication::primaryScreen();
+    const qreal refreshRate = screen != nullptr ? screen->refreshRate() : 0;
+
+    if (refreshRate < 1) {
+        return DEFAULT_FRAME_INTERVAL;
+    }
+    return qMax(1, qRound(1000 / refreshRate));
+}
+
+RenderScheduler::FrameStatistics RenderScheduler::statistics() const
+{
+    return _statistics;
+}
+
+void RenderScheduler::resetStatistics()
+{
+    _statistics = FrameStatistics();
+}
+
+QString RenderScheduler::summary() const
+{
+    const auto milliseconds = [](qint64 nanoseconds) {
+        return QString::number(nanoseconds / 1000000.0, 'f', 2);
+    };
+
+    const qint64 averageTime = _statistics.frames == 0 ? 0 : _statistics.totalUpdateTime / _statistics.frames;
+
+    return QStringLiteral(
+               "scheduler: %1 frames, %2 updates, %3 deferred\n"
+               "update average %4 ms, slowest %5 ms, longest frame interval %6 ms")
+        .arg(QString::number(_statistics.frames),
+             QString::number(_statistics.updates),
+             QString::number(_statistics.deferredUpdates),
+             milliseconds(averageTime),
+             milliseconds(_statistics.maxUpdateTime),
+             milliseconds(_statistics.maxFrameInterval));
+}
+
+void RenderScheduler::startFrameTimer()
+{
+    if (_frameTimer.isActive()) {
+        return;
+    }
+
+    // output arriving after an idle period is shown right away, output
+    // arriving in the middle of a frame waits for the next one
+    const qint64 interval = frameInterval();
+    const qint64 sinceLastFrame = _lastFrameTime < 0 ? interval : (_clock.nsecsElapsed() - _lastFrameTime) / 1000000;
+    _frameTimer.start(int(qBound<qint64>(0, interval - sinceLastFrame, interval)));
+}
+
+void RenderScheduler::renderFrame()
+{
+    const qint64 frameTime = _clock.nsecsElapsed();
+    if (_lastFrameTime >= 0) {
+        _statistics.maxFrameInterval = qMax(_statistics.maxFrameInterval, frameTime - _lastFrameTime);
+    }
+    _lastFrameTime = frameTime;
+
+    QList<Emulation *> emulations;
+    for (auto it = _pendingUpdates.begin(); it != _pendingUpdates.end(); ++it) {
+        PendingUpdate &update = it.value();
+        update.throughputMode = update.receivedBytes > ThroughputModeBytes;
+        update.receivedBytes = 0;
+
+        if (update.throughputMode && ++update.deferredFrames < ThroughputModeFrames) {
+            ++_statistics.deferredUpdates;
+            continue;
+        }
+        emulations << it.key();
+    }
+
+    // updating an emulation removes it from _pendingUpdates, and its views
+    // may schedule new updates, so the emulations are collected first
+    for (Emulation *emulation : qAsConst(emulations)) {
+        // skip emulations which were destroyed by the update of another one
+        if (_pendingUpdates.contains(emulation)) {
+            emulation->showBulk();
+        }
+    }
+
+    if (!emulations.isEmpty()) {
+        const qint64 updateTime = _clock.nsecsElapsed() - frameTime;
+        ++_statistics.frames;
+        _statistics.updates += emulations.count();
+        _statistics.totalUpdateTime += updateTime;
+        _statistics.maxUpdateTime = qMax(_statistics.maxUpdateTime, updateTime);
+    }
+
+    if (!_pendingUpdates.isEmpty()) {
+        startFrameTimer();
+    }
+}
@@ -0,0 +1,119 @@
+/*
+    SPDX-FileCopyrightText: 2022 Konsole Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef RENDERSCHEDULER_H
+#define RENDERSCHEDULER_H
+
+// Qt
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QTimer>
+
+// Konsole
+#include "konsoleprivate_export.h"
+
+namespace Konsole
+{
+class Emulation;
+
+/**
+ * Paces the updates of all terminal views.
+ *
+ * Instead of every emulation running its own timers, emulations with new
+ * output call scheduleUpdate(), and the scheduler updates all of them
+ * together once per frame of the display's refresh rate.  As the views of
+ * all sessions are updated in the same event loop iteration, their repaints
+ * are also combined into one paint of each window.
+ *
+ * An emulation which receives more than ThroughputModeBytes of input in a
+ * frame is in throughput mode, in which it is only updated every
+ * ThroughputModeFrames frames, until its input slows down again.
+ */
+class KONSOLEPRIVATE_EXPORT RenderScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    /** Input per frame above which an emulation is in throughput mode */
+    static const int ThroughputModeBytes = 64 * 1024;
+    /** Number of frames between updates of an emulation in throughput mode */
+    static const int ThroughputModeFrames = 4;
+
+    RenderScheduler();
+    ~RenderScheduler() override;
+
+    /** Returns the render scheduler instance */
+    static RenderScheduler *instance();
+
+    /**
+     * Schedules an update of the views of @p emulation with the next frame.
+     *
+     * @param emulation The emulation whose output changed
+     * @param receivedBytes The amount of input which caused the change, used
+     * to detect when to enter throughput mode
+     */
+    void scheduleUpdate(Emulation *emulation, int receivedBytes = 0);
+
+    /**
+     * Forgets the scheduled update of @p emulation, e.g. because it has
+     * just been updated directly or is being destroyed.
+     */
+    void cancelUpdate(Emulation *emulation);
+
+    /** Returns true if updates of @p emulation are currently being throttled */
+    bool isInThroughputMode(Emulation *emulation) const;
+
+    /**
+     * Returns the time between two frames in milliseconds, following the
+     * refresh rate of the primary screen.
+     */
+    int frameInterval() const;
+
+    /** Frame time statistics since the last call to resetStatistics() */
+    struct FrameStatistics {
+        int frames = 0; // frames in which at least one emulation was updated
+        int updates = 0; // emulation updates
+        int deferredUpdates = 0; // updates postponed by throughput mode
+        qint64 totalUpdateTime = 0; // nanoseconds spent updating the views
+        qint64 maxUpdateTime = 0; // longest time spent in a single frame
+        qint64 maxFrameInterval = 0; // longest time between two consecutive frames, in nanoseconds
+    };
+
+    /** Returns the frame time statistics, see FrameStatistics */
+    FrameStatistics statistics() const;
+
+    /** Resets the frame time statistics */
+    void resetStatistics();
+
+    /** Returns a human readable description of statistics() */
+    QString summary() const;
+
+private Q_SLOTS:
+    void renderFrame();
+
+private:
+    Q_DISABLE_COPY(RenderScheduler)
+
+    // starts the frame timer, so that it fires one frame interval after the
+    // previous frame
+    void startFrameTimer();
+
+    struct PendingUpdate {
+        qint64 receivedBytes = 0; // input received since the previous frame
+        int deferredFrames = 0; // frames skipped in throughput mode
+        bool throughputMode = false; // see isInThroughputMode()
+    };
+
+    QHash<Emulation *, PendingUpdate> _pendingUpdates;
+    QTimer _frameTimer;
+    QElapsedTimer _clock;
+    qint64 _lastFrameTime; // _clock time of the previous frame, -1 if none
+    FrameStatistics _statistics;
+};
+}
+
+#endif // RENDERSCHEDULER_H
@@ -60,12 +60,17 @@ Screen::Screen(int lines, int columns)
     , _screenLinesSize(_lines)
     , _scrolledLines(0)
     , _lastScrolledRegion(QRect())
+    , _dirtyLines(_lines, true)
     , _droppedLines(0)
+    , _totalDroppedLines(0)
     , _oldTotalLines(0)
     , _isResize(false)
     , _enableReflowLines(false)
     , _lineProperties(_lines + 1)
     , _history(std::make_unique<HistoryScrollNone>())
+    , _historyLineCache(2 * _lines)
+    , _historySearchIndexDirty(false)
+    , _historyGeneration(0)
     , _cuX(0)
     , _cuY(0)
     , _currentForeground(CharacterColor())
@@ -243,6 +248,7 @@ void Screen::eraseBlock(int y, int x, int height, int width)
     width = qBound(0, width, _columns - x - 1);
     int endCol = x + width;
     height = qBound(0, height, _lines - y - 1);
+    setLinesDirty(y, y + height - 1);
     Character chr(' ', CharacterColor(COLOR_SPACE_DEFAULT, DEFAULT_FORE_COLOR), CharacterColor(COLOR_SPACE_DEFAULT, DEFAULT_BACK_COLOR), RE_CONCEAL, false);
     for (int row = y; row < y + height; row++) {
         QVector<Character> &line = _screenLines[row];
@@ -280,6 +286,7 @@ void Screen::deleteChars(int n)
     Q_ASSERT(_cuX + n <= _screenLines.at(_cuY).count());
 
     _screenLines[_cuY].remove(_cuX, n);
+    setLinesDirty(_cuY, _cuY);
 
     // Append space(s) with current attributes
     Character spaceWithCurrentAttrs(' ', _effectiveForeground, _effectiveBackground, _effectiveRendition, false);
@@ -300,6 +307,7 @@ void Screen::insertChars(int n)
     }
 
     _screenLines[_cuY].insert(_cuX, n, Character(' '));
+    setLinesDirty(_cuY, _cuY);
 
     if (_screenLines.at(_cuY).count() > getScreenLineColumns(_cuY)) {
         _screenLines[_cuY].resize(getScreenLineColumns(_cuY));
@@ -349,6 +357,9 @@ void Screen::insertLines(int n)
 
 void Screen::setMode(int m)
 {
+    if (m == MODE_Screen && _currentModes[m] == 0) {
+        setLinesDirty(0, _lines - 1);
+    }
     _currentModes[m] = 1;
     switch (m) {
     case MODE_Origin:
@@ -360,6 +371,9 @@ void Screen::setMode(int m)
 
 void Screen::resetMode(int m)
 {
+    if (m == MODE_Screen && _currentModes[m] != 0) {
+        setLinesDirty(0, _lines - 1);
+    }
     _currentModes[m] = 0;
     switch (m) {
     case MODE_Origin:
@@ -376,6 +390,9 @@ void Screen::saveMode(int m)
 
 void Screen::restoreMode(int m)
 {
+    if (m == MODE_Screen && _currentModes[m] != _savedModes[m]) {
+        setLinesDirty(0, _lines - 1);
+    }
     _currentModes[m] = _savedModes[m];
 }
 
@@ -492,6 +509,7 @@ void Screen::resizeImage(int new_lines, int new_columns)
             --cursorLine;
         }
         auto removedLines = _history->reflowLines(new_columns);
+        invalidateHistorySearchIndex();
 
         // If _history size > max history size it will drop a line from _history.
         // We need to verify if we need to remove a URL.
@@ -571,6 +589,9 @@ void Screen::resizeImage(int new_lines, int new_columns)
             _screenLines.insert(_screenLines.begin(), std::move(histLine));
             _lineProperties.insert(_lineProperties.begin(), lineProperty);
             _history->removeCells();
+            if (!_historySearchIndexDirty) {
+                _historySearchIndex.removeLastLine();
+            }
             ++cursorLine;
         }
     }
@@ -584,6 +605,8 @@ void Screen::resizeImage(int new_lines, int new_columns)
     _screenLinesSize = new_lines;
     _lines = new_lines;
     _columns = new_columns;
+    _dirtyLines = QBitArray(_lines, true);
+    _historyLineCache = std::vector<HistoryLineCacheEntry>(2 * _lines);
     _cuX = qMin(_cuX, _columns - 1);
     cursorLine = qBound(0, cursorLine, _lines - 1);
     setCursorLine(cursorLine);
@@ -652,61 +675,60 @@ void Screen::updateEffectiveRendition()
     }
 }
 
-void Screen::copyFromHistory(Character *dest, int startLine, int count) const
+Screen::LineView Screen::getLineView(int line) const
 {
-    const int columns = _columns;
-
-    Q_ASSERT(startLine >= 0 && count > 0 && startLine + count <= _history->getLines());
+    Q_ASSERT(line >= 0 && line < _history->getLines() + _lines);
 
-    for (int line = startLine; line < startLine + count; ++line) {
-        const int length = qMin(columns, _history->getLineLen(line));
-        const int destLineOffset = (line - startLine) * columns;
-        const int lastColumn = (_history->getLineProperty(line) & LINE_DOUBLEWIDTH) ? columns / 2 : columns;
+    const int historyLines = _history->getLines();
 
-        _history->getCells(line, 0, length, dest + destLineOffset);
+    if (line >= historyLines) {
+        const int screenLine = line - historyLines;
+        const ImageLine &cells = _screenLines[screenLine];
+        const LineProperty property = screenLine < (int)_lineProperties.size() ? _lineProperties[screenLine] : LINE_DEFAULT;
+        return {cells.constData(), qMin(_columns, cells.size()), property};
+    }
 
-        if (length < columns) {
-            const int begin = destLineOffset + length;
-            const int end = destLineOffset + columns;
-            std::fill(dest + begin, dest + end, Screen::DefaultChar);
-        }
+    HistoryLineCacheEntry &entry = _historyLineCache[line % _historyLineCache.size()];
+    if (entry.line != line) {
+        const int length = qMin(_columns, _history->getLineLen(line));
+        entry.cells.resize(length);
+        _history->getCells(line, 0, length, entry.cells.data());
+        entry.property = _history->getLineProperty(line);
+        entry.line = line;
+    }
+    return {entry.cells.constData(), entry.cells.size(), entry.property};
+}
 
-        // invert selected text
-        if (_selBegin != -1) {
-            for (int column = 0; column < lastColumn; ++column) {
-                if (isSelected(column, line)) {
-                    dest[destLineOffset + column].rendition |= RE_SELECTED;
-                }
-            }
-        }
+void Screen::invalidateHistoryLineCache()
+{
+    for (HistoryLineCacheEntry &entry : _historyLineCache) {
+        entry.line = -1;
     }
 }
 
-void Screen::copyFromScreen(Character *dest, int startLine, int count) const
+void Screen::copyLines(Character *dest, int startLine, int count) const
 {
-    const int endLine = startLine + count;
     const int columns = _columns;
-    const int historyLines = _history->getLines();
 
-    Q_ASSERT(startLine >= 0 && count > 0 && endLine <= _lines);
+    Q_ASSERT(startLine >= 0 && count > 0 && startLine + count <= _history->getLines() + _lines);
 
-    for (int line = startLine; line < endLine; ++line) {
+    for (int line = startLine; line < startLine + count; ++line) {
+        const LineView view = getLineView(line);
         const int destLineOffset = (line - startLine) * columns;
-        const int lastColumn = (line < (int)_lineProperties.size() && _lineProperties[line] & LINE_DOUBLEWIDTH) ? columns / 2 : columns;
-        const ImageLine srcLine = _screenLines.at(line);
-        const int length = qMin(columns, srcLine.size());
+        const int lastColumn = (view.property & LINE_DOUBLEWIDTH) ? columns / 2 : columns;
 
-        std::copy(srcLine.cbegin(), srcLine.cbegin() + length, dest + destLineOffset);
+        std::copy(view.cells, view.cells + view.length, dest + destLineOffset);
 
-        if (length < columns) {
-            const int begin = destLineOffset + length;
+        if (view.length < columns) {
+            const int begin = destLineOffset + view.length;
             const int end = destLineOffset + columns;
             std::fill(dest + begin, dest + end, Screen::DefaultChar);
         }
 
+        // invert selected text
         if (_selBegin != -1) {
             for (int column = 0; column < lastColumn; ++column) {
-                if (isSelected(column, line + historyLines)) {
+                if (isSelected(column, line)) {
                     dest[destLineOffset + column].rendition |= RE_SELECTED;
                 }
             }
@@ -724,18 +746,7 @@ void Screen::getImage(Character *dest, int size, int startLine, int endLine) con
     Q_ASSERT(size >= mergedLines * _columns);
     Q_UNUSED(size)
 
-    const int linesInHistoryBuffer = qBound(0, _history->getLines() - startLine, mergedLines);
-    const int linesInScreenBuffer = mergedLines - linesInHistoryBuffer;
-
-    // copy _lines from history buffer
-    if (linesInHistoryBuffer > 0) {
-        copyFromHistory(dest, startLine, linesInHistoryBuffer);
-    }
-
-    // copy _lines from screen buffer
-    if (linesInScreenBuffer > 0) {
-        copyFromScreen(dest + linesInHistoryBuffer * _columns, startLine + linesInHistoryBuffer - _history->getLines(), linesInScreenBuffer);
-    }
+    copyLines(dest, startLine, mergedLines);
 
     // invert display when in screen mode
     if (getMode(MODE_Screen)) {
@@ -746,9 +757,9 @@ void Screen::getImage(Character *dest, int size, int startLine, int endLine) con
 
     int visX = qMin(_cuX, getScreenLineColumns(_cuY) - 1);
     // mark the character at the current cursor position
-    int cursorIndex = loc(visX, _cuY + linesInHistoryBuffer);
-    if (getMode(MODE_Cursor) && cursorIndex < _columns * mergedLines) {
-        dest[cursorIndex].rendition |= RE_CURSOR;
+    const int cursorLine = _cuY + _history->getLines() - startLine;
+    if (getMode(MODE_Cursor) && cursorLine >= 0 && cursorLine < mergedLines) {
+        dest[loc(visX, cursorLine)].rendition |= RE_CURSOR;
     }
 }
 
@@ -800,7 +811,6 @@ void Screen::reset(bool softReset, bool preservePrompt)
             _cuY = 0;
             if (_hasGraphics) {
                 delPlacements();
-                _currentTerminalDisplay->update();
             }
         } else {
             clearEntireScreen();
@@ -846,6 +856,7 @@ void Screen::backspace()
 
     if (_screenLines.at(_cuY).size() < _cuX + 1) {
         _screenLines[_cuY].resize(_cuX + 1);
+        setLinesDirty(_cuY, _cuY);
     }
 }
 
@@ -982,6 +993,8 @@ void Screen::displayCharacter(uint c)
             goto notcombine;
         }
 
+        setLinesDirty(charToCombineWithY, charToCombineWithY);
+
         if ((currentChar.rendition & RE_EXTENDED_CHAR) == 0) {
             const uint chars[2] = {currentChar.character, c};
             currentChar.rendition |= RE_EXTENDED_CHAR;
@@ -1012,12 +1025,15 @@ notcombine:
     if (_cuX + w > getScreenLineColumns(_cuY)) {
         if (getMode(MODE_Wrap)) {
             _lineProperties[_cuY] = static_cast<LineProperty>(_lineProperties.at(_cuY) | LINE_WRAPPED);
+            setLinesDirty(_cuY, _cuY);
             nextLine();
         } else {
             _cuX = qMax(getScreenLineColumns(_cuY) - w, 0);
         }
     }
 
+    setLinesDirty(_cuY, _cuY);
+
     // ensure current line vector has enough elements
     if (_screenLines[_cuY].size() < _cuX + w) {
         _screenLines[_cuY].resize(_cuX + w);
@@ -1067,6 +1083,63 @@ notcombine:
     }
 }
 
+void Screen::displayRun(const uint *chars, int count)
+{
+    int i = 0;
+    while (i < count) {
+        // Only runs of plain single width characters are written in bulk;
+        // everything else (wide and combining characters, insert mode,
+        // characters which are part of an escape sequence URL) takes the
+        // regular path.
+        if (Character::width(chars[i]) != 1 || getMode(MODE_Insert) || (_escapeSequenceUrlExtractor && _escapeSequenceUrlExtractor->reading())) {
+            displayCharacter(chars[i]);
+            ++i;
+            continue;
+        }
+
+        // Wrap BEFORE putting the characters, see displayCharacter()
+        if (_cuX + 1 > getScreenLineColumns(_cuY)) {
+            if (getMode(MODE_Wrap)) {
+                _lineProperties[_cuY] = static_cast<LineProperty>(_lineProperties.at(_cuY) | LINE_WRAPPED);
+                setLinesDirty(_cuY, _cuY);
+                nextLine();
+            } else {
+                _cuX = qMax(getScreenLineColumns(_cuY) - 1, 0);
+            }
+        }
+
+        // Take as many single width characters as fit on the current line
+        const int limit = i + qMax(getScreenLineColumns(_cuY) - _cuX, 1);
+        int end = i + 1;
+        while (end < count && end < limit && Character::width(chars[end]) == 1) {
+            ++end;
+        }
+        const int length = end - i;
+
+        setLinesDirty(_cuY, _cuY);
+
+        ImageLine &line = _screenLines[_cuY];
+        if (line.size() < _cuX + length) {
+            line.resize(_cuX + length);
+        }
+
+        // check if selection is still valid.
+        checkSelection(loc(_cuX, _cuY), loc(_cuX + length - 1, _cuY));
+
+        const Character format(' ', _effectiveForeground, _effectiveBackground, _effectiveRendition, true);
+        Character *cell = line.data() + _cuX;
+        for (int j = 0; j < length; ++j) {
+            cell[j] = format;
+            cell[j].character = chars[i + j];
+        }
+
+        _cuX += length;
+        _lastPos = loc(_cuX - 1, _cuY);
+        _lastDrawnChar = chars[end - 1];
+        i = end;
+    }
+}
+
 int Screen::scrolledLines() const
 {
     return _scrolledLines;
@@ -1079,10 +1152,33 @@ void Screen::resetDroppedLines()
 {
     _droppedLines = 0;
 }
+qint64 Screen::totalDroppedLines() const
+{
+    return _totalDroppedLines;
+}
 void Screen::resetScrolledLines()
 {
     _scrolledLines = 0;
 }
+const QBitArray &Screen::dirtyLines() const
+{
+    return _dirtyLines;
+}
+void Screen::resetDirtyLines()
+{
+    _dirtyLines.fill(false);
+}
+void Screen::setLinesDirty(int first, int last)
+{
+    first = qMax(first, 0);
+    last = qMin(last, _dirtyLines.size() - 1);
+    if (first == last) {
+        // the common case, a character written to the current line
+        _dirtyLines.setBit(first);
+    } else if (first < last) {
+        _dirtyLines.fill(true, first, last + 1);
+    }
+}
 
 void Screen::scrollUp(int n)
 {
@@ -1205,6 +1301,7 @@ void Screen::clearImage(int loca, int loce, char c, bool resetLineRendition)
 
     const int topLine = loca / _columns;
     const int bottomLine = loce / _columns;
+    setLinesDirty(topLine, bottomLine);
 
     Character clearCh(uint(c), _currentForeground, _currentBackground, DEFAULT_RENDITION, false);
 
@@ -1255,6 +1352,7 @@ void Screen::moveImage(int dest, int sourceBegin, int sourceEnd)
     //(search the web for 'memmove implementation' for details)
     const int destY = dest / _columns;
     const int srcY = sourceBegin / _columns;
+    setLinesDirty(qMin(destY, srcY), qMax(destY, srcY) + lines);
     if (dest < sourceBegin) {
         /**
          * This is basically a left rotate.
@@ -1342,7 +1440,6 @@ void Screen::clearEntireScreen()
     clearImage(loc(0, 0), loc(_columns - 1, _lines - 1), ' ');
     if (_hasGraphics) {
         delPlacements();
-        _currentTerminalDisplay->update();
     }
 }
 
@@ -1416,6 +1513,9 @@ void Screen::setBackColor(int space, int color)
 
 void Screen::clearSelection()
 {
+    if (_selBegin != -1 || _selTopLeft != -1) {
+        setLinesDirty(0, _lines - 1);
+    }
     _selBottomRight = -1;
     _selTopLeft = -1;
     _selBegin = -1;
@@ -1448,6 +1548,7 @@ void Screen::getSelectionEnd(int &column, int &line) const
 }
 void Screen::setSelectionStart(const int x, const int y, const bool blockSelectionMode)
 {
+    setLinesDirty(0, _lines - 1);
     _selBegin = loc(x, y);
     /* FIXME, HACK to correct for x too far to the right... */
     if (x == _columns) {
@@ -1464,6 +1565,7 @@ void Screen::setSelectionEnd(const int x, const int y, const bool trimTrailingWh
     if (_selBegin == -1) {
         return;
     }
+    setLinesDirty(0, _lines - 1);
 
     int endPos = loc(x, y);
 
@@ -1775,11 +1877,21 @@ void Screen::fastAddHistLine()
     const bool removeLine = _history->getLines() == _history->getMaxLines();
     _history->addCellsVector(_screenLines.at(0));
     _history->addLine(_lineProperties.at(0));
+    if (hasScroll() && !_historySearchIndexDirty) {
+        _historySearchIndex.addLine(_screenLines.at(0).constData(), _screenLines.at(0).size(), (_lineProperties.at(0) & LINE_WRAPPED) != 0);
+        _historySearchIndex.keepLastLines(_history->getLines());
+    }
 
     // If _history size > max history size it will drop a line from _history.
     // We need to verify if we need to remove a URL.
-    if (removeLine && _escapeSequenceUrlExtractor) {
-        _escapeSequenceUrlExtractor->historyLinesRemoved(1);
+    if (removeLine) {
+        // only counted for line numbers taken across the change, droppedLines()
+        // stays as it was for the scroll position of the windows
+        _totalDroppedLines++;
+        invalidateHistoryLineCache();
+        if (_escapeSequenceUrlExtractor) {
+            _escapeSequenceUrlExtractor->historyLinesRemoved(1);
+        }
     }
 
     // Rotate left + clear the last line
@@ -1789,6 +1901,7 @@ void Screen::fastAddHistLine()
     std::fill(last.begin(), last.end(), clearCh);
 
     _lineProperties.erase(_lineProperties.begin());
+    setLinesDirty(0, _lines - 1);
 }
 
 void Screen::addHistLine()
@@ -1804,10 +1917,17 @@ void Screen::addHistLine()
 
         newHistLines = _history->getLines();
 
+        if (!_historySearchIndexDirty) {
+            _historySearchIndex.addLine(_screenLines.at(0).constData(), _screenLines.at(0).size(), (_lineProperties.at(0) & LINE_WRAPPED) != 0);
+            _historySearchIndex.keepLastLines(newHistLines);
+        }
+
         // If the history is full, increment the count
         // of dropped _lines
         if (newHistLines <= oldHistLines) {
             _droppedLines += oldHistLines - newHistLines + 1;
+            _totalDroppedLines += oldHistLines - newHistLines + 1;
+            invalidateHistoryLineCache();
 
             // We removed some lines, we need to verify if we need to remove a URL.
             if (_escapeSequenceUrlExtractor) {
@@ -1871,6 +1991,8 @@ void Screen::setScroll(const HistoryType &t, bool copyPreviousScroll)
         auto oldHistory = std::move(_history);
         t.scroll(_history);
     }
+    invalidateHistoryLineCache();
+    invalidateHistorySearchIndex();
     _graphicsPlacements.clear();
 #ifdef HAVE_MALLOC_TRIM
 
@@ -1881,6 +2003,68 @@ void Screen::setScroll(const HistoryType &t, bool copyPreviousScroll)
 #endif
 }
 
+void Screen::invalidateHistorySearchIndex()
+{
+    // the index is only built again when it is used, as decoding the
+    // history takes a while and most histories are never searched
+    _historySearchIndex.clear();
+    _historySearchIndexDirty = true;
+    _historyGeneration++;
+}
+
+void Screen::updateHistorySearchIndex()
+{
+    if (!_historySearchIndexDirty) {
+        return;
+    }
+    _historySearchIndexDirty = false;
+
+    // start one line before the indexed ones, in case it wraps into them
+    const int historyLines = _history->getLines();
+    ImageLine cells;
+    for (int line = qMax(0, historyLines - HistorySearchIndex::MaxLines - 1); line < historyLines; ++line) {
+        cells.resize(_history->getLineLen(line));
+        _history->getCells(line, 0, cells.size(), cells.data());
+        _historySearchIndex.addLine(cells.constData(), cells.size(), _history->isWrappedLine(line));
+    }
+}
+
+QVector<int> Screen::searchCandidateLines(const HistorySearchIndex::Filter &filter, int firstLine, int lastLine)
+{
+    updateHistorySearchIndex();
+
+    const int historyLines = _history->getLines();
+    const int firstIndexedLine = historyLines - _historySearchIndex.lineCount();
+
+    QVector<int> lines;
+    for (int line = firstLine; line <= qMin(lastLine, firstIndexedLine - 1); ++line) {
+        lines << line;
+    }
+    const QVector<int> indexedLines = _historySearchIndex.candidateLines(filter, firstLine - firstIndexedLine, lastLine - firstIndexedLine);
+    for (int line : indexedLines) {
+        lines << firstIndexedLine + line;
+    }
+    for (int line = qMax(firstLine, historyLines); line <= lastLine; ++line) {
+        lines << line;
+    }
+    return lines;
+}
+
+bool Screen::getLineCells(int line, QVector<Character> &cells) const
+{
+    const int historyLines = _history->getLines();
+    if (line < historyLines) {
+        cells.resize(_history->getLineLen(line));
+        _history->getCells(line, 0, cells.size(), cells.data());
+        return _history->isWrappedLine(line);
+    }
+
+    const int screenLine = line - historyLines;
+    Q_ASSERT(screenLine < _screenLinesSize);
+    cells = _screenLines.at(screenLine);
+    return (_lineProperties.at(screenLine) & LINE_WRAPPED) != 0;
+}
+
 bool Screen::hasScroll() const
 {
     return _history->hasScroll();
@@ -1893,6 +2077,7 @@ const HistoryType &Screen::getScroll() const
 
 void Screen::setLineProperty(LineProperty property, bool enable)
 {
+    setLinesDirty(_cuY, _cuY);
     if (enable) {
         _lineProperties[_cuY] = static_cast<LineProperty>(_lineProperties.at(_cuY) | property);
     } else {
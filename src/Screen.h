@@ -20,6 +20,7 @@
 
 // Konsole
 #include "../characters/Character.h"
+#include "history/HistorySearchIndex.h"
 #include "konsoleprivate_export.h"
 
 #define MODE_Origin 0
@@ -378,6 +379,15 @@ public:
      */
     void displayCharacter(uint c);
 
+    /**
+     * Displays @p count characters starting at @p chars at the current cursor
+     * position, exactly as if displayCharacter() had been called for each of them.
+     *
+     * Runs of single width characters are written to the line in one go,
+     * which is considerably faster for large amounts of plain text.
+     */
+    void displayRun(const uint *chars, int count);
+
     /**
      * Resizes the image to a new fixed size of @p new_lines by @p new_columns.
      * In the case that @p new_columns is smaller than the current number of columns,
@@ -402,6 +412,28 @@ public:
      */
     void getImage(Character *dest, int size, int startLine, int endLine) const;
 
+    /**
+     * A read-only view onto the characters of a single line, see getLineView().
+     */
+    struct LineView {
+        const Character *cells; // the first @p length characters of the line
+        int length; // at most getColumns(), the remaining columns are blank
+        LineProperty property;
+    };
+
+    /**
+     * Returns a view onto the characters of @p line, where 0 is the first
+     * line in the history.  Unlike getImage(), the selection, the cursor and
+     * the reverse screen mode are not applied.
+     *
+     * Lines on the screen are not copied.  Lines in the history are decoded
+     * into a small cache, so that reading the same history lines again, e.g.
+     * while scrolling through them, does not decode them again.
+     *
+     * The view is only valid until the screen or its history is modified.
+     */
+    LineView getLineView(int line) const;
+
     /**
      * Returns the additional attributes associated with lines in the image.
      * The most important attribute is LINE_WRAPPED which specifies that the
@@ -432,6 +464,40 @@ public:
     void setScroll(const HistoryType &, bool copyPreviousScroll = true);
     /** Returns the type of storage used to keep lines in the history. */
     const HistoryType &getScroll() const;
+    /**
+     * Returns the search index over the last lines of the history, used to
+     * find the history lines which may contain a match of a search.
+     * The index is empty until searchCandidateLines() is first called after
+     * the history was replaced.
+     */
+    const HistorySearchIndex &historySearchIndex() const
+    {
+        return _historySearchIndex;
+    }
+    /**
+     * Returns the lines from @p firstLine to @p lastLine, where 0 is the
+     * first line in the history, which may contain a match of @p filter.
+     * Lines on the screen and history lines older than the ones in
+     * historySearchIndex() are always candidates.
+     *
+     * This builds the index first if the history was replaced since it was
+     * last used.
+     */
+    QVector<int> searchCandidateLines(const HistorySearchIndex::Filter &filter, int firstLine, int lastLine);
+    /**
+     * Copies the cells of @p line, where 0 is the first line in the history,
+     * into @p cells, and returns true if the line wraps into the next one.
+     */
+    bool getLineCells(int line, QVector<Character> &cells) const;
+    /**
+     * Returns a number which changes whenever the lines of the history are
+     * replaced, e.g. because they were reflowed or the type of the history
+     * changed, so that line numbers kept from before refer to other text.
+     */
+    int historyGeneration() const
+    {
+        return _historyGeneration;
+    }
     /**
      * Returns true if this screen keeps lines that are scrolled off the screen
      * in a history buffer.
@@ -559,6 +625,21 @@ public:
      */
     void resetScrolledLines();
 
+    /**
+     * Returns the lines of the screen image which have been modified
+     * since the last call to resetDirtyLines(), one bit per line.
+     *
+     * Besides their characters, a line is considered modified when its
+     * properties or selection change, or when it is scrolled. The cursor
+     * position is not tracked.
+     */
+    const QBitArray &dirtyLines() const;
+
+    /**
+     * Clears the set of modified lines, see dirtyLines()
+     */
+    void resetDirtyLines();
+
     /**
      * Returns the number of lines of output which have been
      * dropped from the history since the last call
@@ -576,6 +657,13 @@ public:
      */
     void resetDroppedLines();
 
+    /**
+     * Returns the number of lines dropped from the history since the
+     * screen was created. Unlike droppedLines(), it is never reset, so
+     * line numbers taken at different times can be compared.
+     */
+    qint64 totalDroppedLines() const;
+
     /**
      * Fills the buffer @p dest with @p count instances of the default (ie. blank)
      * Character style.
@@ -677,6 +765,9 @@ private:
     //
     // NOTE: moveImage() can only move whole lines
     void moveImage(int dest, int sourceBegin, int sourceEnd);
+
+    // marks lines first to last (inclusive) of the screen image as modified, see dirtyLines()
+    void setLinesDirty(int first, int last);
     // scroll up 'n' lines in current region, clearing the bottom 'n' lines
     void scrollUp(int from, int n);
     // scroll down 'n' lines in current region, clearing the top 'n' lines
@@ -698,12 +789,17 @@ private:
     // copies text from 'startIndex' to 'endIndex' to a stream
     // startIndex and endIndex are positions generated using the loc(x,y) macro
     void writeToStream(TerminalCharacterDecoder *decoder, int startIndex, int endIndex, const DecodingOptions options) const;
-    // copies 'count' lines from the screen buffer into 'dest',
-    // starting from 'startLine', where 0 is the first line in the screen buffer
-    void copyFromScreen(Character *dest, int startLine, int count) const;
-    // copies 'count' lines from the history buffer into 'dest',
+    // copies 'count' lines from the history and screen buffers into 'dest',
     // starting from 'startLine', where 0 is the first line in the history
-    void copyFromHistory(Character *dest, int startLine, int count) const;
+    void copyLines(Character *dest, int startLine, int count) const;
+    // forgets the history lines decoded by getLineView(), must be called
+    // whenever lines are removed from the history or the history is replaced
+    void invalidateHistoryLineCache();
+    // drops the search index after the lines of the history were reflowed
+    // or the history was replaced, it is built again on its next use
+    void invalidateHistorySearchIndex();
+    // indexes the lines of the history again if the index was invalidated
+    void updateHistorySearchIndex();
 
     // returns a buffer that can hold at most 'count' characters,
     // where the number of reallocations and object reinitializations
@@ -736,8 +832,10 @@ private:
 
     int _scrolledLines;
     QRect _lastScrolledRegion;
+    QBitArray _dirtyLines; // [lines]
 
     int _droppedLines;
+    qint64 _totalDroppedLines;
 
     int _oldTotalLines;
     bool _isResize;
@@ -748,6 +846,20 @@ private:
     // history buffer ---------------
     std::unique_ptr<HistoryScroll> _history;
 
+    // recently decoded history lines, see getLineView()
+    struct HistoryLineCacheEntry {
+        int line = -1; // history line held by this entry, -1 if unused
+        LineProperty property = LINE_DEFAULT;
+        ImageLine cells;
+    };
+    mutable std::vector<HistoryLineCacheEntry> _historyLineCache; // [2 * lines], indexed by line modulo size
+
+    // indexes the last lines of _history, see historySearchIndex()
+    HistorySearchIndex _historySearchIndex;
+    // true if _historySearchIndex has to be built from _history again
+    bool _historySearchIndexDirty;
+    int _historyGeneration;
+
     // cursor location
     int _cuX;
     int _cuY;
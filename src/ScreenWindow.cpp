@@ -17,6 +17,8 @@ ScreenWindow::ScreenWindow(Screen *screen, QObject *parent)
     , _windowBuffer(nullptr)
     , _windowBufferSize(0)
     , _bufferNeedsUpdate(true)
+    , _bufferScreenLine(-1)
+    , _bufferCursorLine(-1)
     , _windowLines(1)
     , _currentLine(0)
     , _currentResultLine(-1)
@@ -41,6 +43,8 @@ void ScreenWindow::setScreen(Screen *screen)
 
     Q_EMIT screenAboutToChange();
     _screen = screen;
+    _bufferNeedsUpdate = true;
+    _bufferScreenLine = -1;
 }
 
 Screen *ScreenWindow::screen() const
@@ -57,23 +61,62 @@ Character *ScreenWindow::getImage()
         _windowBufferSize = size;
         _windowBuffer = new Character[size];
         _bufferNeedsUpdate = true;
+        _bufferScreenLine = -1;
+    }
+
+    if (_changedLines.size() != windowLines()) {
+        _changedLines = QBitArray(windowLines(), true);
     }
 
     if (!_bufferNeedsUpdate) {
         return _windowBuffer;
     }
 
-    _screen->getImage(_windowBuffer, size, currentLine(), endWindowLine());
+    const int screenLine = currentLine() - _screen->getHistLines();
+    const int cursorLine = _screen->getCursorY() - screenLine;
+
+    // The buffer can be updated line by line as long as it still shows the
+    // same screen lines, without any history or unused area
+    if (screenLine >= 0 && screenLine == _bufferScreenLine && screenLine + windowLines() <= _screen->getLines()) {
+        const QBitArray dirtyLines = _dirtyLines | _screen->dirtyLines();
+        const int columns = windowColumns();
+
+        for (int line = 0; line < windowLines(); ++line) {
+            const int dirtyLine = screenLine + line;
+            if (dirtyLine >= dirtyLines.size() || dirtyLines.testBit(dirtyLine) || line == cursorLine || line == _bufferCursorLine) {
+                _screen->getImage(_windowBuffer + line * columns, columns, currentLine() + line, currentLine() + line);
+                _changedLines.setBit(line);
+            }
+        }
+    } else {
+        _screen->getImage(_windowBuffer, size, currentLine(), endWindowLine());
+
+        // this window may look beyond the end of the screen, in which
+        // case there will be an unused area which needs to be filled
+        // with blank characters
+        fillUnusedArea();
+
+        _changedLines.fill(true);
+    }
 
-    // this window may look beyond the end of the screen, in which
-    // case there will be an unused area which needs to be filled
-    // with blank characters
-    fillUnusedArea();
+    _bufferScreenLine = qMax(screenLine, -1);
+    _bufferCursorLine = cursorLine;
+    _dirtyLines.fill(false);
 
     _bufferNeedsUpdate = false;
     return _windowBuffer;
 }
 
+const QBitArray &ScreenWindow::changedLines() const
+{
+    return _changedLines;
+}
+
+void ScreenWindow::resetChangedLines()
+{
+    _changedLines.fill(false);
+}
+
 void ScreenWindow::fillUnusedArea()
 {
     int screenEndLine = _screen->getHistLines() + _screen->getLines() - 1;
@@ -323,6 +366,8 @@ void ScreenWindow::notifyOutputChanged()
         _currentLine = qMin(_currentLine, _screen->getHistLines());
     }
 
+    // the screen forgets its modified lines once all windows have been notified
+    _dirtyLines |= _screen->dirtyLines();
     _bufferNeedsUpdate = true;
 
     Q_EMIT outputChanged();
@@ -8,6 +8,7 @@
 #define SCREENWINDOW_H
 
 // Qt
+#include <QBitArray>
 #include <QObject>
 #include <QPoint>
 #include <QRect>
@@ -63,9 +64,25 @@ public:
      *
      * The returned buffer is managed by the ScreenWindow instance and does not need to be
      * deleted by the caller.
+     *
+     * While the window follows the bottom of the screen, only the lines which the
+     * screen reports as modified (see Screen::dirtyLines()) and the lines with the
+     * cursor are copied again.
      */
     Character *getImage();
 
+    /**
+     * Returns the lines of the image returned by getImage() which have been
+     * updated since the last call to resetChangedLines(), one bit per window line.
+     * The other lines of the image are unchanged.
+     */
+    const QBitArray &changedLines() const;
+
+    /**
+     * Clears the set of updated lines returned by changedLines()
+     */
+    void resetChangedLines();
+
     /**
      * Returns the line attributes associated with the lines of characters which
      * are currently visible through this window
@@ -261,6 +278,10 @@ private:
     Character *_windowBuffer;
     int _windowBufferSize;
     bool _bufferNeedsUpdate;
+    int _bufferScreenLine; // screen line shown at the top of _windowBuffer, -1 if the buffer shows history
+    int _bufferCursorLine; // window line of the cursor in _windowBuffer
+    QBitArray _dirtyLines; // screen lines modified since _windowBuffer was updated
+    QBitArray _changedLines; // see changedLines()
 
     int _windowLines;
     int _currentLine; // see scrollTo() , currentLine()
@@ -7,14 +7,110 @@
 
 #include "SearchHistoryTask.h"
 
-#include <QApplication>
 #include <QTextStream>
+#include <QThread>
+#include <QTimer>
 
 #include "../decoders/PlainTextDecoder.h"
 #include "Emulation.h"
+#include "Screen.h"
 
 namespace Konsole
 {
+// Number of blocks which may wait for the worker, so that reading the next
+// block overlaps with searching the previous one
+static const int MAX_PENDING_BLOCKS = 2;
+
+SearchHistoryWorker::SearchHistoryWorker(const QRegularExpression &regExp, Enum::SearchDirection direction)
+    // a separate copy, so that the pattern is not shared with the GUI thread
+    : _regExp(regExp.pattern(), regExp.patternOptions())
+    , _direction(direction)
+{
+}
+
+void SearchHistoryWorker::searchBlock(int block, const QString &text)
+{
+    const int position = _direction == Enum::ForwardsSearch ? text.indexOf(_regExp) : text.lastIndexOf(_regExp);
+    Q_EMIT blockSearched(block, position);
+}
+
+void SearchHistoryWorker::searchLiteralBlock(int block, const LiteralSearch &search)
+{
+    const int position = _direction == Enum::ForwardsSearch ? search.indexIn() : search.lastIndexIn();
+    Q_EMIT blockSearched(block, position);
+}
+
+void SearchHistoryWorker::searchAllMatches(int block, const QString &text, const QList<int> &linePositions)
+{
+    // the end of the text of a line, without its new-line
+    const auto lineEnd = [&](int line) {
+        int end = line + 1 < linePositions.count() ? linePositions[line + 1] : text.length();
+        if (end > linePositions[line] && text[end - 1] == QLatin1Char('\n')) {
+            end--;
+        }
+        return end;
+    };
+    const auto lineOf = [&](int position, int line) {
+        while (line + 1 < linePositions.count() && linePositions[line + 1] <= position) {
+            line++;
+        }
+        return line;
+    };
+    const auto column = [&](int line, int position) {
+        return Character::stringWidth(text.mid(linePositions[line], position - linePositions[line]));
+    };
+
+    QVector<int> matches;
+    int line = 0;
+    QRegularExpressionMatchIterator iterator = _regExp.globalMatch(text);
+    while (iterator.hasNext() && !linePositions.isEmpty()) {
+        const QRegularExpressionMatch match = iterator.next();
+        if (match.capturedLength() == 0) {
+            continue;
+        }
+
+        // a match may span wrapped lines, which are read without a new-line
+        line = lineOf(match.capturedStart(), line);
+        const int lastLine = lineOf(match.capturedEnd() - 1, line);
+        for (int matchLine = line; matchLine <= lastLine; ++matchLine) {
+            const int start = qMax(match.capturedStart(), linePositions[matchLine]);
+            const int end = qMin(match.capturedEnd(), lineEnd(matchLine));
+            if (end > start) {
+                matches << matchLine << column(matchLine, start) << column(matchLine, end);
+            }
+        }
+    }
+
+    Q_EMIT allMatchesFound(block, matches);
+}
+
+SearchHistoryTask::SearchHistoryTask(QObject *parent)
+    : SessionTask(parent)
+    , _direction(Enum::BackwardsSearch)
+    , _startLine(0)
+    , _thread(nullptr)
+    , _worker(nullptr)
+    , _screen(nullptr)
+    , _historyGeneration(0)
+    , _nextBlock(0)
+    , _searchStartLine(0)
+    , _searchLine(0)
+    , _searchEndLine(0)
+    , _searchLastLine(0)
+    , _blockSize(0)
+    , _hasWrapped(false)
+    , _allBlocksRead(true)
+    , _droppedLines(0)
+    , _searchedLines(0)
+    , _totalLines(0)
+{
+}
+
+SearchHistoryTask::~SearchHistoryTask()
+{
+    stopWorker();
+}
+
 void SearchHistoryTask::addScreenWindow(Session *session, ScreenWindow *searchWindow)
 {
     _windows.insert(session, searchWindow);
@@ -22,140 +118,348 @@ void SearchHistoryTask::addScreenWindow(Session *session, ScreenWindow *searchWi
 
 void SearchHistoryTask::execute()
 {
-    auto iter = QMapIterator<QPointer<Session>, ScreenWindowPtr>(_windows);
+    // a search which is still running is given up for the new one
+    stopWorker();
 
-    while (iter.hasNext()) {
-        iter.next();
-        executeOnScreenWindow(iter.key(), iter.value());
-    }
+    _filter = HistorySearchIndex::Filter(_regExp);
+    _literalSearch = LiteralSearch(_regExp);
+
+    _thread = new QThread();
+    _worker = new SearchHistoryWorker(_regExp, _direction);
+    _worker->moveToThread(_thread);
+    connect(_worker, &Konsole::SearchHistoryWorker::blockSearched, this, &Konsole::SearchHistoryTask::blockSearched);
+    _thread->start();
+
+    searchNextWindow();
+}
+
+void SearchHistoryTask::cancel()
+{
+    stopWorker();
+    _windows.clear();
 
     if (autoDelete()) {
         deleteLater();
     }
 }
 
-void SearchHistoryTask::executeOnScreenWindow(const QPointer<Session> &session, const ScreenWindowPtr &window)
+void SearchHistoryTask::stopWorker()
 {
-    Q_ASSERT(session);
-    Q_ASSERT(window);
+    // the worker finishes the block it is searching, if any, and is then
+    // deleted along with its thread; the blocks still queued are dropped
+    if (_thread != nullptr) {
+        _thread->quit();
+        _thread->wait();
+        delete _worker;
+        delete _thread;
+        _thread = nullptr;
+        _worker = nullptr;
+    }
+    _pendingBlocks.clear();
+}
 
-    Emulation *emulation = session->emulation();
+void SearchHistoryTask::searchNextWindow()
+{
+    while (!_windows.isEmpty()) {
+        auto iter = _windows.begin();
+        _session = iter.key();
+        _window = iter.value();
+        _windows.erase(iter);
+
+        Q_ASSERT(_session);
+        Q_ASSERT(_window);
+
+        if (_regExp.pattern().isEmpty()) {
+            Q_EMIT completed(false);
+            continue;
+        }
 
-    if (!_regExp.pattern().isEmpty()) {
-        int pos = -1;
         const bool forwards = (_direction == Enum::ForwardsSearch);
-        const int lastLine = window->lineCount() - 1;
+        _searchLastLine = _window->lineCount() - 1;
 
-        int startLine;
-        if (forwards && (_startLine == lastLine)) {
-            startLine = 0;
+        if (forwards && (_startLine == _searchLastLine)) {
+            _searchStartLine = 0;
         } else if (!forwards && (_startLine == 0)) {
-            startLine = lastLine;
+            _searchStartLine = _searchLastLine;
         } else {
-            startLine = _startLine + (forwards ? 1 : -1);
+            _searchStartLine = _startLine + (forwards ? 1 : -1);
+        }
+
+        _searchLine = _searchStartLine;
+        _searchEndLine = _searchLine;
+        _blockSize = qMin(_window->lineCount(), _filter.isValid() ? IndexedBlockLines : BlockLines);
+        _hasWrapped = false; // set to true when we reach the top/bottom
+        // of the output and continue from the other end
+        _allBlocksRead = false;
+        _screen = _window->screen();
+        _historyGeneration = _screen->historyGeneration();
+        _droppedLines = _screen->totalDroppedLines();
+        _searchedLines = 0;
+        _totalLines = _window->lineCount();
+
+        searchNextBlock();
+        return;
+    }
+
+    stopWorker();
+    if (autoDelete()) {
+        deleteLater();
+    }
+}
+
+bool SearchHistoryTask::isWindowValid() const
+{
+    return _session && _window && _window->screen() == _screen && _screen->historyGeneration() == _historyGeneration;
+}
+
+void SearchHistoryTask::adjustForDroppedLines()
+{
+    const int dropped = int(_screen->totalDroppedLines() - _droppedLines);
+    _droppedLines += dropped;
+
+    // the window may also have fewer lines now, e.g. after a resize
+    const int lastLine = qMax(0, _window->lineCount() - 1);
+    _searchStartLine = qBound(0, _searchStartLine - dropped, lastLine);
+    _searchLine = qBound(0, _searchLine - dropped, lastLine);
+    _searchEndLine = qBound(0, _searchEndLine - dropped, lastLine);
+    _searchLastLine = qBound(0, _searchLastLine - dropped, lastLine);
+}
+
+QString SearchHistoryTask::readLines(const Screen *screen, const QVector<int> &lines, QList<int> &linePositions, QVector<int> &lineNumbers)
+{
+    QString string;
+    QTextStream searchStream(&string);
+
+    PlainTextDecoder decoder;
+    decoder.setRecordLinePositions(true);
+
+    for (int i = 0; i < lines.size();) {
+        int end = i + 1;
+        while (end < lines.size() && lines[end] == lines[end - 1] + 1) {
+            end++;
         }
 
-        QString string;
+        decoder.begin(&searchStream);
+        screen->writeLinesToStream(&decoder, lines[i], lines[end - 1]);
+        decoder.end();
+        searchStream << QLatin1Char('\n');
 
+        const QList<int> positions = decoder.linePositions();
+        for (int line = 0; line < positions.count(); ++line) {
+            linePositions << positions[line];
+            lineNumbers << lines[i] + qMin(line, end - 1 - i);
+        }
+        i = end;
+    }
+    searchStream.flush();
+
+    return string;
+}
+
+// Reads the code points of lines into search, the same text readLines() reads
+static void readLiteralLines(const Screen *screen, const QVector<int> &lines, LiteralSearch &search, QList<int> &linePositions, QVector<int> &lineNumbers)
+{
+    search.clear();
+
+    QVector<Character> cells;
+    for (int i = 0; i < lines.size(); ++i) {
+        const bool wrapped = screen->getLineCells(lines[i], cells);
+        linePositions << search.textLength();
+        lineNumbers << lines[i];
+        search.appendLine(cells.constData(), cells.size());
+
+        // a wrapped line continues on the next line, if that is read too
+        if (!wrapped || i + 1 == lines.size() || lines[i + 1] != lines[i] + 1) {
+            search.appendLineBreak();
+        }
+    }
+}
+
+void SearchHistoryTask::searchNextBlock()
+{
+    if (_worker == nullptr || _allBlocksRead || _pendingBlocks.size() >= MAX_PENDING_BLOCKS) {
+        return;
+    }
+    if (!isWindowValid()) {
+        finishWindow(false);
+        return;
+    }
+
+    adjustForDroppedLines();
+
+    // calculate lines to search in this iteration
+    const bool forwards = _direction == Enum::ForwardsSearch;
+    const bool wasWrapped = _hasWrapped;
+    const int delta = forwards ? _blockSize : -_blockSize;
+    if (_hasWrapped) {
+        if (_searchEndLine == _searchLastLine) {
+            _searchLine = 0;
+        } else if (_searchEndLine == 0) {
+            _searchLine = _searchLastLine;
+        }
+
+        _searchEndLine += delta;
+
+        if (forwards) {
+            _searchEndLine = qMin(_searchStartLine, _searchEndLine);
+        } else {
+            _searchEndLine = qMax(_searchStartLine, _searchEndLine);
+        }
+    } else {
+        _searchEndLine += delta;
+
+        if (_searchEndLine > _searchLastLine) {
+            _hasWrapped = true;
+            _searchEndLine = _searchLastLine;
+        } else if (_searchEndLine < 0) {
+            _hasWrapped = true;
+            _searchEndLine = 0;
+        }
+    }
+
+    QVector<int> lines;
+    if (_filter.isValid()) {
+        lines = _screen->searchCandidateLines(_filter, qMin(_searchEndLine, _searchLine), qMax(_searchEndLine, _searchLine));
+
+        // read no more than BlockLines lines at once, the rest of the lines
+        // are left for the next block
+        if (lines.size() > BlockLines) {
+            if (forwards) {
+                lines.resize(BlockLines);
+                _searchEndLine = lines.last();
+            } else {
+                lines.remove(0, lines.size() - BlockLines);
+                _searchEndLine = lines.first();
+            }
+            _hasWrapped = wasWrapped || _searchEndLine == (forwards ? _searchLastLine : 0);
+        }
+    } else if (_literalSearch.isValid()) {
+        for (int line = qMin(_searchEndLine, _searchLine); line <= qMax(_searchEndLine, _searchLine); ++line) {
+            lines << line;
+        }
+    }
+
+    QString string;
+    Block block{0, _droppedLines, QList<int>(), QVector<int>()};
+    // each block gets its own copy of the text, as the worker searches it
+    // while the next block is read
+    LiteralSearch literalSearch = _literalSearch;
+    if (_literalSearch.isValid()) {
+        readLiteralLines(_screen, lines, literalSearch, block.linePositions, block.lineNumbers);
+    } else if (_filter.isValid()) {
+        string = readLines(_screen, lines, block.linePositions, block.lineNumbers);
+    } else {
         // text stream to read history into string for pattern or regular expression searching
         QTextStream searchStream(&string);
 
         PlainTextDecoder decoder;
         decoder.setRecordLinePositions(true);
 
-        // setup first and last lines depending on search direction
-        int line = startLine;
-
-        // read through and search history in blocks of 10K lines.
-        // this balances the need to retrieve lots of data from the history each time
-        //(for efficient searching)
-        // without using silly amounts of memory if the history is very large.
-        const int maxDelta = qMin(window->lineCount(), 10000);
-        int delta = forwards ? maxDelta : -maxDelta;
-
-        int endLine = line;
-        bool hasWrapped = false; // set to true when we reach the top/bottom
-        // of the output and continue from the other
-        // end
-
-        // loop through history in blocks of <delta> lines.
-        do {
-            // ensure that application does not appear to hang
-            // if searching through a lengthy output
-            QApplication::processEvents();
-
-            // calculate lines to search in this iteration
-            if (hasWrapped) {
-                if (endLine == lastLine) {
-                    line = 0;
-                } else if (endLine == 0) {
-                    line = lastLine;
-                }
-
-                endLine += delta;
-
-                if (forwards) {
-                    endLine = qMin(startLine, endLine);
-                } else {
-                    endLine = qMax(startLine, endLine);
-                }
-            } else {
-                endLine += delta;
-
-                if (endLine > lastLine) {
-                    hasWrapped = true;
-                    endLine = lastLine;
-                } else if (endLine < 0) {
-                    hasWrapped = true;
-                    endLine = 0;
-                }
-            }
+        const int firstLine = qMin(_searchEndLine, _searchLine);
+        decoder.begin(&searchStream);
+        _session->emulation()->writeToStream(&decoder, firstLine, qMax(_searchEndLine, _searchLine));
+        decoder.end();
 
-            decoder.begin(&searchStream);
-            emulation->writeToStream(&decoder, qMin(endLine, line), qMax(endLine, line));
-            decoder.end();
+        // line number search below assumes that the buffer ends with a new-line
+        string.append(QLatin1Char('\n'));
 
-            // line number search below assumes that the buffer ends with a new-line
-            string.append(QLatin1Char('\n'));
+        block.linePositions = decoder.linePositions();
+        for (int line = 0; line < block.linePositions.count(); ++line) {
+            block.lineNumbers << firstLine + line;
+        }
+    }
+    block.lineCount = qAbs(_searchEndLine - _searchLine) + 1;
+
+    // move to the next block
+    _searchLine = _searchEndLine;
+    _allBlocksRead = (_searchStartLine == _searchEndLine);
+
+    const int blockId = _nextBlock++;
+    _pendingBlocks.insert(blockId, block);
+    if (_literalSearch.isValid()) {
+        QMetaObject::invokeMethod(
+            _worker,
+            [worker = _worker, blockId, literalSearch] {
+                worker->searchLiteralBlock(blockId, literalSearch);
+            },
+            Qt::QueuedConnection);
+    } else {
+        QMetaObject::invokeMethod(
+            _worker,
+            [worker = _worker, blockId, string] {
+                worker->searchBlock(blockId, string);
+            },
+            Qt::QueuedConnection);
+    }
 
-            if (forwards) {
-                pos = string.indexOf(_regExp);
-            } else {
-                pos = string.lastIndexOf(_regExp);
-            }
+    // read the next block in the next event loop iteration, so that the
+    // terminal stays responsive while searching a long history
+    QTimer::singleShot(0, this, &Konsole::SearchHistoryTask::searchNextBlock);
+}
 
-            // if a match is found, position the cursor on that line and update the screen
-            if (pos != -1) {
-                int newLines = 0;
-                QList<int> linePositions = decoder.linePositions();
-                while (newLines < linePositions.count() && linePositions[newLines] <= pos) {
-                    newLines++;
-                }
+void SearchHistoryTask::blockSearched(int block, int position)
+{
+    if (!_pendingBlocks.contains(block)) {
+        return;
+    }
+    const Block searched = _pendingBlocks.take(block);
 
-                // ignore the new line at the start of the buffer
-                newLines--;
+    if (!isWindowValid()) {
+        finishWindow(false);
+        return;
+    }
 
-                int findPos = qMin(line, endLine) + newLines;
+    if (!finishBlock(searched, position)) {
+        searchNextBlock();
+    }
+}
 
-                highlightResult(window, findPos);
+bool SearchHistoryTask::finishBlock(const Block &searched, int position)
+{
+    // if a match is found, position the cursor on that line and update the screen
+    if (position != -1) {
+        int newLines = 0;
+        while (newLines < searched.linePositions.count() && searched.linePositions[newLines] <= position) {
+            newLines++;
+        }
 
-                Q_EMIT completed(true);
+        // ignore the new line at the start of the buffer
+        newLines--;
 
-                return;
-            }
+        // lines may have been dropped from the history since the block was read
+        const int dropped = int(_screen->totalDroppedLines() - searched.droppedLines);
+        const int line = searched.lineNumbers.isEmpty() ? 0 : searched.lineNumbers[qBound(0, newLines, searched.lineNumbers.size() - 1)];
+        const int findPos = qMax(0, line - dropped);
 
-            // clear the current block of text and move to the next one
-            string.clear();
-            line = endLine;
-        } while (startLine != endLine);
+        highlightResult(_window, findPos);
+        finishWindow(true);
+        return true;
+    }
+
+    _searchedLines = qMin(_totalLines, _searchedLines + searched.lineCount);
+    Q_EMIT progress(_searchedLines, _totalLines);
 
+    if (_allBlocksRead && _pendingBlocks.isEmpty()) {
         // if no match was found, clear selection to indicate this
-        window->clearSelection();
-        window->notifyOutputChanged();
+        _window->clearSelection();
+        _window->notifyOutputChanged();
+        finishWindow(false);
+        return true;
     }
+    return false;
+}
 
-    Q_EMIT completed(false);
+void SearchHistoryTask::finishWindow(bool found)
+{
+    // blocks still waiting for the worker belong to the finished window
+    _pendingBlocks.clear();
+    _allBlocksRead = true;
+
+    Q_EMIT completed(found);
+
+    searchNextWindow();
 }
+
 void SearchHistoryTask::highlightResult(const ScreenWindowPtr &window, int findPos)
 {
     // work out how many lines into the current block of text the search result was found
@@ -178,13 +482,6 @@ void SearchHistoryTask::highlightResult(const ScreenWindowPtr &window, int findP
     window->setCurrentResultLine(findPos);
 }
 
-SearchHistoryTask::SearchHistoryTask(QObject *parent)
-    : SessionTask(parent)
-    , _direction(Enum::BackwardsSearch)
-    , _startLine(0)
-{
-}
-
 void SearchHistoryTask::setSearchDirection(Enum::SearchDirection direction)
 {
     _direction = direction;
@@ -12,14 +12,67 @@
 #include <QPointer>
 #include <QRegularExpression>
 
+class QThread;
+
 #include "Enumeration.h"
 #include "ScreenWindow.h"
+#include "history/HistorySearchIndex.h"
+#include "history/LiteralSearch.h"
 #include "session/Session.h"
 #include "session/SessionTask.h"
 
 namespace Konsole
 {
-// class SearchHistoryThread;
+/**
+ * Searches blocks of text for the regular expression of a SearchHistoryTask,
+ * or for its plain string in the code points read into a LiteralSearch.
+ *
+ * The worker lives in a thread of its own, so that matching a long history
+ * does not block the user interface.
+ */
+class SearchHistoryWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    SearchHistoryWorker(const QRegularExpression &regExp, Enum::SearchDirection direction);
+
+public Q_SLOTS:
+    /**
+     * Searches @p text and reports the position of the first match, or of
+     * the last one when searching backwards, with blockSearched().
+     */
+    void searchBlock(int block, const QString &text);
+
+    /**
+     * Searches the text appended to @p search like searchBlock() does,
+     * without a regular expression.
+     */
+    void searchLiteralBlock(int block, const LiteralSearch &search);
+
+    /**
+     * Searches @p text for all matches and reports them with allMatchesFound().
+     * @p linePositions are the positions in @p text where its lines start.
+     */
+    void searchAllMatches(int block, const QString &text, const QList<int> &linePositions);
+
+Q_SIGNALS:
+    /** Emitted when @p block has been searched, @p position is -1 if it has no match */
+    void blockSearched(int block, int position);
+
+    /**
+     * Emitted when @p block has been searched for all matches. @p matches
+     * holds three values for each line of each match: the index of the line
+     * in the linePositions of the block, and the first and last column (not
+     * included) of the match on that line.
+     */
+    void allMatchesFound(int block, const QVector<int> &matches);
+
+private:
+    QRegularExpression _regExp;
+    Enum::SearchDirection _direction;
+};
+
 /**
  * A task which searches through the output of sessions for matches for a given regular expression.
  * SearchHistoryTask operates on ScreenWindow instances rather than sessions added by addSession().
@@ -28,21 +81,40 @@ namespace Konsole
  * When execute() is called, the search begins in the direction specified by searchDirection(),
  * starting at the position of the current selection.
  *
+ * The search is asynchronous: blocks of lines are read from the history on
+ * the GUI thread, one block per event loop iteration, and matched against the
+ * regular expression by a SearchHistoryWorker in another thread. progress()
+ * and completed() are emitted as the search proceeds.
+ *
+ * If the regular expression requires a literal, only the lines which the
+ * screen's HistorySearchIndex reports as candidates are read and matched.
+ * If it is a plain string, the code points of the lines are copied into a
+ * LiteralSearch instead, without decoding them, which the worker searches.
+ *
  * FIXME - This is not a proper implementation of SessionTask, in that it ignores sessions specified
  * with addSession()
- *
- * TODO - Implementation requirements:
- *          May provide progress feedback to the user when searching very large output logs.
  */
 class SearchHistoryTask : public SessionTask
 {
     Q_OBJECT
 
 public:
+    /**
+     * Number of lines read from the output at once. Reading a block is done
+     * on the GUI thread, so it is kept small enough not to delay the next frame.
+     */
+    static constexpr int BlockLines = 2000;
+    /**
+     * Number of lines checked against the history search index at once, of
+     * which at most BlockLines candidate lines are read
+     */
+    static constexpr int IndexedBlockLines = 100000;
+
     /**
      * Constructs a new search task.
      */
     explicit SearchHistoryTask(QObject *parent = nullptr);
+    ~SearchHistoryTask() override;
 
     /** Adds a screen window to the list to search when execute() is called. */
     void addScreenWindow(Session *session, ScreenWindow *searchWindow);
@@ -61,27 +133,102 @@ public:
     void setStartLine(int line);
 
     /**
-     * Performs a search through the session's history, starting at the position
-     * of the current selection, in the direction specified by setSearchDirection().
+     * Starts a search through the session's history, starting at the position
+     * of the current selection, in the direction specified by setSearchDirection(),
+     * and returns immediately.
      *
      * If it finds a match, the ScreenWindow specified in the constructor is
      * scrolled to the position where the match occurred and the selection
-     * is set to the matching text.  execute() then returns immediately.
+     * is set to the matching text, then completed() is emitted.
      *
      * To continue the search looking for further matches, call execute() again.
      */
     void execute() override;
 
+    /**
+     * Stops the search, e.g. because the search text changed. completed()
+     * is not emitted, and the task is deleted if autoDelete() is set.
+     */
+    void cancel();
+
+    /**
+     * Reads the text of @p lines of @p screen to be searched. Each run of
+     * consecutive lines is followed by a new-line.
+     *
+     * @param linePositions Set to where each line starts in the text
+     * @param lineNumbers Set to the line of each of @p linePositions
+     */
+    static QString readLines(const Screen *screen, const QVector<int> &lines, QList<int> &linePositions, QVector<int> &lineNumbers);
+
+Q_SIGNALS:
+    /**
+     * Emitted after each block of lines has been searched in the current
+     * screen window, with the number of lines searched so far out of
+     * @p totalLines.
+     */
+    void progress(int searchedLines, int totalLines);
+
+private Q_SLOTS:
+    void searchNextBlock();
+    void blockSearched(int block, int position);
+
 private:
     using ScreenWindowPtr = QPointer<ScreenWindow>;
 
-    void executeOnScreenWindow(const QPointer<Session> &session, const ScreenWindowPtr &window);
+    // starts searching the next screen window, or finishes the task
+    void searchNextWindow();
+    // finishes the search in the current screen window
+    void finishWindow(bool found);
+    // returns false if the lines to search are gone, because the history
+    // was replaced or the window shows another screen now
+    bool isWindowValid() const;
+    // moves the lines still to be searched up by the lines dropped from the
+    // history, and keeps them within the lines of the window
+    void adjustForDroppedLines();
     void highlightResult(const ScreenWindowPtr &window, int findPos);
+    void stopWorker();
 
     QMap<QPointer<Session>, ScreenWindowPtr> _windows;
     QRegularExpression _regExp;
+    HistorySearchIndex::Filter _filter;
+    LiteralSearch _literalSearch;
     Enum::SearchDirection _direction;
     int _startLine;
+
+    QThread *_thread;
+    SearchHistoryWorker *_worker;
+
+    // the screen window being searched
+    QPointer<Session> _session;
+    ScreenWindowPtr _window;
+    // the screen of _window and its history, which the lines to search refer to
+    Screen *_screen;
+    int _historyGeneration;
+
+    // a block of lines handed to the worker
+    struct Block {
+        int lineCount; // lines covered by the block, including the ones not read
+        qint64 droppedLines; // Screen::totalDroppedLines() when the block was read
+        QList<int> linePositions; // where each line read starts in the text
+        QVector<int> lineNumbers; // the line at each of linePositions
+    };
+    QMap<int, Block> _pendingBlocks;
+    // handles the result of searching a block, returns true if the search
+    // in the current screen window is finished
+    bool finishBlock(const Block &block, int position);
+    int _nextBlock;
+
+    // lines still to be searched in the current screen window, see searchNextBlock()
+    int _searchStartLine;
+    int _searchLine;
+    int _searchEndLine;
+    int _searchLastLine;
+    int _blockSize;
+    bool _hasWrapped;
+    bool _allBlocksRead;
+    qint64 _droppedLines; // Screen::totalDroppedLines() the lines above refer to
+    int _searchedLines;
+    int _totalLines;
 };
 
 }
@@ -0,0 +1,314 @@
+/*
+    SPDX-FileCopyrightText: 2022 Konsole Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+// Own
+#include "SearchMatches.h"
+
+// STD
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+// Qt
+#include <QThread>
+#include <QTimer>
+
+// Konsole
+#include "Screen.h"
+#include "ScreenWindow.h"
+#include "SearchHistoryTask.h"
+
+using namespace Konsole;
+
+// Min time between two matchesChanged() signals, in milliseconds
+static const int MATCHES_CHANGED_DELAY = 100;
+
+SearchMatches::SearchMatches(ScreenWindow *window, QObject *parent)
+    : QObject(parent)
+    , _window(window)
+    , _screen(nullptr)
+    , _historyGeneration(0)
+    , _thread(nullptr)
+    , _worker(nullptr)
+    , _changedTimer(new QTimer(this))
+    , _changedFirstLine(std::numeric_limits<qint64>::max())
+    , _changedLastLine(std::numeric_limits<qint64>::min())
+    , _block(-1)
+    , _nextBlock(0)
+    , _blockFirstLine(0)
+    , _blockLastLine(0)
+    , _blockHistoryEnd(0)
+    , _searchedLines(0)
+    , _outputChanged(false)
+{
+    connect(window, &Konsole::ScreenWindow::outputChanged, this, &Konsole::SearchMatches::outputChanged);
+
+    _changedTimer->setSingleShot(true);
+    _changedTimer->setInterval(MATCHES_CHANGED_DELAY);
+    connect(_changedTimer, &QTimer::timeout, this, &Konsole::SearchMatches::emitMatchesChanged);
+}
+
+SearchMatches::~SearchMatches()
+{
+    stopWorker();
+}
+
+void SearchMatches::setRegExp(const QRegularExpression &regExp)
+{
+    if (regExp == _regExp) {
+        return;
+    }
+
+    _regExp = regExp;
+    _filter = HistorySearchIndex::Filter(regExp);
+    restart();
+}
+
+QRegularExpression SearchMatches::regExp() const
+{
+    return _regExp;
+}
+
+int SearchMatches::count() const
+{
+    return int(_matches.size());
+}
+
+bool SearchMatches::isComplete() const
+{
+    if (_worker == nullptr || _window.isNull()) {
+        return true;
+    }
+    return _block == -1 && !_outputChanged && _searchedLines >= _screen->totalDroppedLines() + _screen->getHistLines();
+}
+
+QVector<SearchMatches::Match> SearchMatches::matches(int firstLine, int lastLine) const
+{
+    QVector<Match> result;
+    if (_window.isNull() || _screen == nullptr) {
+        return result;
+    }
+
+    const qint64 droppedLines = _screen->totalDroppedLines();
+    for (auto it = lowerBound(droppedLines + firstLine); it != _matches.cend() && it->line <= droppedLines + lastLine; ++it) {
+        result << Match{int(it->line - droppedLines), it->startColumn, it->endColumn};
+    }
+    return result;
+}
+
+bool SearchMatches::hasMatches(int firstLine, int lastLine) const
+{
+    if (_window.isNull() || _screen == nullptr || firstLine > lastLine) {
+        return false;
+    }
+
+    const qint64 droppedLines = _screen->totalDroppedLines();
+    const auto it = lowerBound(droppedLines + firstLine);
+    return it != _matches.cend() && it->line <= droppedLines + lastLine;
+}
+
+void SearchMatches::restart()
+{
+    stopWorker();
+    _matches.clear();
+    _block = -1;
+    _changedTimer->stop();
+    _changedFirstLine = std::numeric_limits<qint64>::max();
+    _changedLastLine = std::numeric_limits<qint64>::min();
+
+    if (!_window.isNull() && !_regExp.pattern().isEmpty() && _regExp.isValid()) {
+        _screen = _window->screen();
+        _historyGeneration = _screen->historyGeneration();
+        _searchedLines = _screen->totalDroppedLines();
+        _outputChanged = true;
+
+        _thread = new QThread();
+        _worker = new SearchHistoryWorker(_regExp, Enum::ForwardsSearch);
+        _worker->moveToThread(_thread);
+        connect(_worker, &Konsole::SearchHistoryWorker::allMatchesFound, this, &Konsole::SearchMatches::blockSearched);
+        _thread->start();
+
+        searchNextBlock();
+    }
+
+    Q_EMIT matchesChanged(0, -1);
+}
+
+void SearchMatches::stopWorker()
+{
+    // the worker finishes the block it is searching, if any, and is then
+    // deleted along with its thread
+    if (_thread != nullptr) {
+        _thread->quit();
+        _thread->wait();
+        delete _worker;
+        delete _thread;
+        _thread = nullptr;
+        _worker = nullptr;
+    }
+}
+
+void SearchMatches::dropOldMatches()
+{
+    const qint64 droppedLines = _screen->totalDroppedLines();
+    while (!_matches.empty() && _matches.front().line < droppedLines) {
+        _matches.pop_front();
+    }
+
+    if (_matches.size() > size_t(MaxMatches)) {
+        const qint64 firstLine = _matches.front().line;
+        _matches.erase(_matches.begin(), _matches.end() - MaxMatches);
+        notifyMatchesChanged(firstLine, _matches.front().line);
+    }
+}
+
+void SearchMatches::notifyMatchesChanged(qint64 firstLine, qint64 lastLine)
+{
+    _changedFirstLine = qMin(_changedFirstLine, firstLine);
+    _changedLastLine = qMax(_changedLastLine, lastLine);
+    if (!_changedTimer->isActive()) {
+        _changedTimer->start();
+    }
+}
+
+void SearchMatches::emitMatchesChanged()
+{
+    if (_changedFirstLine > _changedLastLine || _window.isNull() || _screen == nullptr) {
+        return;
+    }
+
+    const qint64 droppedLines = _screen->totalDroppedLines();
+    const int firstLine = int(qMax<qint64>(0, _changedFirstLine - droppedLines));
+    const int lastLine = int(qMax<qint64>(0, _changedLastLine - droppedLines));
+    _changedFirstLine = std::numeric_limits<qint64>::max();
+    _changedLastLine = std::numeric_limits<qint64>::min();
+
+    Q_EMIT matchesChanged(firstLine, lastLine);
+}
+
+std::deque<SearchMatches::StoredMatch>::const_iterator SearchMatches::lowerBound(qint64 line) const
+{
+    return std::lower_bound(_matches.cbegin(), _matches.cend(), line, [](const StoredMatch &match, qint64 line) {
+        return match.line < line;
+    });
+}
+
+void SearchMatches::outputChanged()
+{
+    if (_worker == nullptr || _window.isNull()) {
+        return;
+    }
+
+    // the positions of the matches are of no use once the lines they were
+    // found on are gone
+    if (_window->screen() != _screen || _screen->historyGeneration() != _historyGeneration) {
+        restart();
+        return;
+    }
+
+    dropOldMatches();
+    _outputChanged = true;
+    searchNextBlock();
+}
+
+void SearchMatches::searchNextBlock()
+{
+    if (_worker == nullptr || _block != -1 || _window.isNull()) {
+        return;
+    }
+
+    // only the lines added to the history since the last block, and the
+    // lines on the screen if they changed, are left to search
+    const qint64 droppedLines = _screen->totalDroppedLines();
+    const int historyLines = _screen->getHistLines();
+    const int firstLine = int(qMax<qint64>(0, _searchedLines - droppedLines));
+    const int lastLine = historyLines + _screen->getLines() - 1;
+    if (firstLine > lastLine || (firstLine >= historyLines && !_outputChanged)) {
+        return;
+    }
+
+    int endLine = qMin(lastLine, firstLine + (_filter.isValid() ? SearchHistoryTask::IndexedBlockLines : SearchHistoryTask::BlockLines) - 1);
+    QVector<int> lines = _screen->searchCandidateLines(_filter, firstLine, endLine);
+    if (lines.size() > SearchHistoryTask::BlockLines) {
+        lines.resize(SearchHistoryTask::BlockLines);
+        endLine = lines.last();
+    }
+    if (endLine == lastLine) {
+        _outputChanged = false;
+    }
+
+    QList<int> linePositions;
+    QVector<int> lineNumbers;
+    const QString text = SearchHistoryTask::readLines(_screen, lines, linePositions, lineNumbers);
+
+    _block = _nextBlock++;
+    _blockFirstLine = droppedLines + firstLine;
+    _blockLastLine = droppedLines + endLine;
+    _blockHistoryEnd = droppedLines + historyLines;
+    _blockLines.clear();
+    for (int line : qAsConst(lineNumbers)) {
+        _blockLines << droppedLines + line;
+    }
+
+    QMetaObject::invokeMethod(
+        _worker,
+        [worker = _worker, block = _block, text, linePositions] {
+            worker->searchAllMatches(block, text, linePositions);
+        },
+        Qt::QueuedConnection);
+}
+
+void SearchMatches::blockSearched(int block, const QVector<int> &matches)
+{
+    if (block != _block || _window.isNull()) {
+        return;
+    }
+    _block = -1;
+
+    QVector<StoredMatch> found;
+    for (int i = 0; i + 2 < matches.size(); i += 3) {
+        found << StoredMatch{_blockLines[matches[i]], matches[i + 1], matches[i + 2]};
+    }
+
+    // replace the matches on the lines of the block, and find the lines
+    // whose matches changed
+    const auto first = lowerBound(_blockFirstLine);
+    const auto last = lowerBound(_blockLastLine + 1);
+    const auto firstChange = std::mismatch(first, last, found.cbegin(), found.cend());
+    if (firstChange.first != last || firstChange.second != found.cend()) {
+        const auto storedEnd = std::make_reverse_iterator(first);
+        const auto lastChange = std::mismatch(std::make_reverse_iterator(last), storedEnd, found.crbegin(), found.crend());
+
+        qint64 firstLine = std::numeric_limits<qint64>::max();
+        qint64 lastLine = std::numeric_limits<qint64>::min();
+        if (firstChange.first != last) {
+            firstLine = qMin(firstLine, firstChange.first->line);
+        }
+        if (firstChange.second != found.cend()) {
+            firstLine = qMin(firstLine, firstChange.second->line);
+        }
+        if (lastChange.first != storedEnd) {
+            lastLine = qMax(lastLine, lastChange.first->line);
+        }
+        if (lastChange.second != found.crend()) {
+            lastLine = qMax(lastLine, lastChange.second->line);
+        }
+
+        const auto position = _matches.erase(first, last);
+        _matches.insert(position, found.cbegin(), found.cend());
+
+        notifyMatchesChanged(firstLine, lastLine);
+    }
+    dropOldMatches();
+
+    // lines which were on the screen when the block was read may have
+    // changed before they were added to the history
+    _searchedLines = qMin(_blockLastLine + 1, _blockHistoryEnd);
+
+    if (_outputChanged || _searchedLines < _screen->totalDroppedLines() + _screen->getHistLines()) {
+        QTimer::singleShot(0, this, &Konsole::SearchMatches::searchNextBlock);
+    }
+}
@@ -0,0 +1,150 @@
+/*
+    SPDX-FileCopyrightText: 2022 Konsole Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef SEARCHMATCHES_H
+#define SEARCHMATCHES_H
+
+// STD
+#include <deque>
+
+// Qt
+#include <QObject>
+#include <QPointer>
+#include <QRegularExpression>
+#include <QVector>
+
+// Konsole
+#include "history/HistorySearchIndex.h"
+#include "konsoleprivate_export.h"
+
+class QThread;
+class QTimer;
+
+namespace Konsole
+{
+class Screen;
+class ScreenWindow;
+class SearchHistoryWorker;
+
+/**
+ * All matches of a regular expression in the history and on the screen of
+ * a ScreenWindow, for highlighting them.
+ *
+ * The lines are searched once, in blocks, by a SearchHistoryWorker in another
+ * thread.  After that, only the lines added to the history and the lines on
+ * the screen are searched again when the output of the window changes; the
+ * matches found in older history lines are kept until the lines are dropped
+ * from the history.  The whole search starts over if the history is
+ * replaced, e.g. because its lines were reflowed.
+ *
+ * At most MaxMatches matches are kept; once there are more, the matches on
+ * the oldest lines are forgotten.  Changes of the matches are reported at
+ * most every few milliseconds, for all blocks searched in between.
+ */
+class KONSOLEPRIVATE_EXPORT SearchMatches : public QObject
+{
+    Q_OBJECT
+
+public:
+    /** Max number of matches which are kept */
+    static const int MaxMatches = 100000;
+
+    struct Match {
+        int line; // window line, 0 is the first line in the history
+        int startColumn;
+        int endColumn; // not included
+    };
+
+    explicit SearchMatches(ScreenWindow *window, QObject *parent = nullptr);
+    ~SearchMatches() override;
+
+    /** Sets the regular expression to search for, and starts searching */
+    void setRegExp(const QRegularExpression &regExp);
+    /** Returns the regular expression which is searched for */
+    QRegularExpression regExp() const;
+
+    /** Returns the number of matches found so far, at most MaxMatches */
+    int count() const;
+
+    /** Returns true if there is no output left to search */
+    bool isComplete() const;
+
+    /** Returns the matches on the lines from @p firstLine to @p lastLine, in order */
+    QVector<Match> matches(int firstLine, int lastLine) const;
+
+    /** Returns true if any of the lines from @p firstLine to @p lastLine has a match */
+    bool hasMatches(int firstLine, int lastLine) const;
+
+Q_SIGNALS:
+    /**
+     * Emitted when the matches on the lines from @p firstLine to
+     * @p lastLine changed, or when all matches changed if @p lastLine is -1.
+     */
+    void matchesChanged(int firstLine, int lastLine);
+
+private Q_SLOTS:
+    void outputChanged();
+    void searchNextBlock();
+    void blockSearched(int block, const QVector<int> &matches);
+    void emitMatchesChanged();
+
+private:
+    // a match, with its line counted from the first line ever added to the
+    // history, so that it stays the same as lines are dropped
+    struct StoredMatch {
+        qint64 line;
+        int startColumn;
+        int endColumn;
+
+        bool operator==(const StoredMatch &other) const
+        {
+            return line == other.line && startColumn == other.startColumn && endColumn == other.endColumn;
+        }
+    };
+
+    // forgets all matches and searches all lines again
+    void restart();
+    void stopWorker();
+    // forgets the matches on lines which were dropped from the history, and
+    // the oldest matches beyond MaxMatches
+    void dropOldMatches();
+    // emits matchesChanged() for the lines from firstLine to lastLine, counted
+    // like StoredMatch::line, once the changes of the next blocks are added
+    void notifyMatchesChanged(qint64 firstLine, qint64 lastLine);
+    // returns the first stored match on line or after it
+    std::deque<StoredMatch>::const_iterator lowerBound(qint64 line) const;
+
+    QPointer<ScreenWindow> _window;
+    Screen *_screen; // the screen of _window which was searched
+    int _historyGeneration;
+
+    QRegularExpression _regExp;
+    HistorySearchIndex::Filter _filter;
+
+    QThread *_thread;
+    SearchHistoryWorker *_worker;
+
+    std::deque<StoredMatch> _matches;
+
+    // the lines whose matches changed since matchesChanged() was last emitted
+    QTimer *_changedTimer;
+    qint64 _changedFirstLine;
+    qint64 _changedLastLine;
+
+    int _block; // the block handed to the worker, -1 if none
+    int _nextBlock;
+    qint64 _blockFirstLine; // the lines covered by _block
+    qint64 _blockLastLine;
+    qint64 _blockHistoryEnd; // the end of the history when _block was read
+    QVector<qint64> _blockLines; // the line of each line position of _block
+
+    qint64 _searchedLines; // the lines before this one have been searched for good
+    bool _outputChanged; // lines after _searchedLines changed since they were searched
+};
+
+}
+
+#endif // SEARCHMATCHES_H
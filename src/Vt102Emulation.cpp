@@ -9,6 +9,7 @@
 #include "config-konsole.h"
 
 // Standard
+#include <array>
 #include <cstdio>
 #include <unistd.h>
 
@@ -16,6 +17,7 @@
 #include <QEvent>
 #include <QKeyEvent>
 #include <QTimer>
+#include <QVarLengthArray>
 #include <QtEndian>
 
 // KDE
@@ -258,16 +260,258 @@ const int MAX_ARGUMENT = 40960;
 
 // Tokenizer --------------------------------------------------------------- --
 
+/* The tokenizer is a state machine in the style of the DEC ANSI parser
+   (see https://vt100.net/emu/dec_ansi_parser).
+
+   Every incoming code point is first mapped to a small category
+   (control, digit, intermediate, ...). The pair (state, category) is
+   then looked up in a transition table which is computed at compile
+   time, and yields the action to perform and the next state. This
+   way the prefix of a sequence never has to be re-examined while it
+   is being scanned; the token buffer is only consulted again once a
+   complete sequence is dispatched to processToken().
+*/
+
+namespace
+{
+// States of the parser. The state is kept in Vt102Emulation::parserState.
+enum ParserState : quint8 {
+    Ground, // Plain text
+    Escape, // ESC
+    EscapeCharset, // ESC ( ) * + %
+    EscapeHash, // ESC #
+    CsiEntry, // ESC [
+    CsiParam, // ESC [ ... parameters, private markers and intermediates
+    CsiBang, // ESC [ !
+    CsiBangSpace, // ESC [ ! SP
+    CsiSpace, // ESC [ SP
+    CsiSpaceSpace, // ESC [ SP SP
+    CsiParamSpace, // ESC [ Pn SP
+    OscString, // ESC ] ...
+    PmString, // ESC ^ ...
+    ApcString, // ESC _ ...
+    DcsString, // ESC P ...
+    Vt52Escape, // ESC (VT52 mode)
+    Vt52CursorRow, // ESC Y (VT52 mode)
+    Vt52CursorColumn, // ESC Y Pr (VT52 mode)
+    ParserStateCount,
+};
+
+// Categories the incoming code points are sorted into
+enum CharCategory : quint8 {
+    CatControl, // C0 controls not listed below
+    CatBell, // BEL
+    CatCancel, // CAN, SUB
+    CatEscape, // ESC
+    CatSpace, // SP
+    CatBang, // !
+    CatHash, // #
+    CatCharset, // ( ) * + %
+    CatIntermediate, // Remaining intermediate bytes 0x20..0x2f
+    CatDigit, // 0..9
+    CatSemicolon, // ;
+    CatPrivate, // ? = >
+    CatCsi, // [
+    CatOsc, // ]
+    CatPm, // ^
+    CatApc, // _
+    CatDcs, // P
+    CatCursor, // Y
+    CatCsi8, // 8-bit CSI (0x9b)
+    CatOther, // Everything else, including all code points >= 256
+    CharCategoryCount,
+};
+
+enum ParserAction : quint8 {
+    ActIgnore, // Drop the character
+    ActPrint, // Printable character (VT52 mode)
+    ActExecute, // Execute a C0 control, keeping the current sequence
+    ActCancel, // CAN/SUB: abort the current sequence and execute
+    ActStartEscape, // Start a new escape sequence
+    ActStartCsi8, // 8-bit CSI
+    ActCollect, // Append the character to the token and change state
+    ActEscDispatch,
+    ActCharsetDispatch,
+    ActHashDispatch,
+    ActParam, // Digit of the current CSI argument
+    ActNextParam, // Start the next CSI argument
+    ActCsiSpace, // SP inside of CSI parameters
+    ActCsiDispatch,
+    ActCsiBangDispatch,
+    ActCsiSpaceDispatch,
+    ActCsiParamSpaceDispatch,
+    ActOscPut,
+    ActPmPut,
+    ActApcPut,
+    ActDcsPut,
+    ActVt52Dispatch,
+    ActVt52CursorDispatch,
+};
+
+struct Transition {
+    quint8 action = ActIgnore;
+    quint8 next = Ground;
+};
+
+using CategoryTable = std::array<quint8, 256>;
+using TransitionTable = std::array<std::array<Transition, CharCategoryCount>, ParserStateCount>;
+
+constexpr CategoryTable buildCategoryTable()
+{
+    CategoryTable table{};
+    for (int i = 0; i < 256; ++i) {
+        table[i] = CatOther;
+    }
+    for (int i = 0; i < 0x20; ++i) {
+        table[i] = CatControl;
+    }
+    table[0x07] = CatBell;
+    table[0x18] = CatCancel;
+    table[0x1a] = CatCancel;
+    table[0x1b] = CatEscape;
+    for (int i = 0x20; i < 0x30; ++i) {
+        table[i] = CatIntermediate;
+    }
+    table[' '] = CatSpace;
+    table['!'] = CatBang;
+    table['#'] = CatHash;
+    table['('] = CatCharset;
+    table[')'] = CatCharset;
+    table['*'] = CatCharset;
+    table['+'] = CatCharset;
+    table['%'] = CatCharset;
+    for (int i = '0'; i <= '9'; ++i) {
+        table[i] = CatDigit;
+    }
+    table[';'] = CatSemicolon;
+    table['?'] = CatPrivate;
+    table['='] = CatPrivate;
+    table['>'] = CatPrivate;
+    table['['] = CatCsi;
+    table[']'] = CatOsc;
+    table['^'] = CatPm;
+    table['_'] = CatApc;
+    table['P'] = CatDcs;
+    table['Y'] = CatCursor;
+    table[0x9b] = CatCsi8;
+    return table;
+}
+
+// Sets the transition for all printable (non-control) categories of 'state'
+constexpr void setPrintable(TransitionTable &table, int state, quint8 action, quint8 next)
+{
+    for (int category = CatSpace; category < CharCategoryCount; ++category) {
+        table[state][category] = Transition{action, next};
+    }
+}
+
+constexpr TransitionTable buildTransitionTable()
+{
+    TransitionTable table{};
+
+    for (int state = 0; state < ParserStateCount; ++state) {
+        // DEC HACK ALERT! Control Characters are allowed *within* esc sequences in VT100
+        // This means, they do neither a resetTokenizer() nor a pushToToken(). Some of them, do
+        // of course. Guess this originates from a weakly layered handling of the X-on
+        // X-off protocol, which comes really below this level.
+        table[state][CatControl] = Transition{ActExecute, quint8(state)};
+        table[state][CatBell] = Transition{ActExecute, quint8(state)};
+        table[state][CatCancel] = Transition{ActCancel, Ground};
+        table[state][CatEscape] = Transition{ActStartEscape, Escape};
+    }
+
+    // Ground: printable characters normally never get here, see receiveChars()
+    setPrintable(table, Ground, ActPrint, Ground);
+    table[Ground][CatCsi8] = Transition{ActStartCsi8, CsiEntry};
+
+    setPrintable(table, Escape, ActEscDispatch, Ground);
+    table[Escape][CatCsi] = Transition{ActCollect, CsiEntry};
+    table[Escape][CatOsc] = Transition{ActCollect, OscString};
+    table[Escape][CatPm] = Transition{ActCollect, PmString};
+    table[Escape][CatApc] = Transition{ActCollect, ApcString};
+    table[Escape][CatDcs] = Transition{ActCollect, DcsString};
+    table[Escape][CatCharset] = Transition{ActCollect, EscapeCharset};
+    table[Escape][CatHash] = Transition{ActCollect, EscapeHash};
+
+    setPrintable(table, EscapeCharset, ActCharsetDispatch, Ground);
+    setPrintable(table, EscapeHash, ActHashDispatch, Ground);
+
+    setPrintable(table, CsiEntry, ActCsiDispatch, Ground);
+    table[CsiEntry][CatPrivate] = Transition{ActCollect, CsiParam};
+    table[CsiEntry][CatBang] = Transition{ActCollect, CsiBang};
+    table[CsiEntry][CatSpace] = Transition{ActCollect, CsiSpace};
+    table[CsiEntry][CatHash] = Transition{ActCollect, CsiParam};
+    table[CsiEntry][CatCharset] = Transition{ActCollect, CsiParam};
+    table[CsiEntry][CatIntermediate] = Transition{ActCollect, CsiParam};
+    table[CsiEntry][CatDigit] = Transition{ActParam, CsiParam};
+    table[CsiEntry][CatSemicolon] = Transition{ActNextParam, CsiParam};
+
+    setPrintable(table, CsiParam, ActCsiDispatch, Ground);
+    table[CsiParam][CatSpace] = Transition{ActCsiSpace, CsiParam};
+    table[CsiParam][CatBang] = Transition{ActCollect, CsiParam};
+    table[CsiParam][CatHash] = Transition{ActCollect, CsiParam};
+    table[CsiParam][CatCharset] = Transition{ActCollect, CsiParam};
+    table[CsiParam][CatIntermediate] = Transition{ActCollect, CsiParam};
+    table[CsiParam][CatDigit] = Transition{ActParam, CsiParam};
+    table[CsiParam][CatSemicolon] = Transition{ActNextParam, CsiParam};
+
+    setPrintable(table, CsiBang, ActCsiBangDispatch, Ground);
+    table[CsiBang][CatSpace] = Transition{ActCollect, CsiBangSpace};
+    setPrintable(table, CsiBangSpace, ActCsiBangDispatch, Ground);
+
+    setPrintable(table, CsiSpace, ActCsiSpaceDispatch, Ground);
+    table[CsiSpace][CatSpace] = Transition{ActCollect, CsiSpaceSpace};
+    setPrintable(table, CsiSpaceSpace, ActCsiSpaceDispatch, Ground);
+
+    setPrintable(table, CsiParamSpace, ActCsiParamSpaceDispatch, Ground);
+
+    // ignore control characters in the text part of osc (aka OSC) "ESC]"
+    // escape sequences; this matches what XTERM docs say
+    // Allow BEL and ESC here, it will either end the text or be removed later.
+    setPrintable(table, OscString, ActOscPut, OscString);
+    table[OscString][CatControl] = Transition{ActIgnore, OscString};
+    table[OscString][CatCancel] = Transition{ActIgnore, OscString};
+    table[OscString][CatBell] = Transition{ActOscPut, OscString};
+    table[OscString][CatEscape] = Transition{ActOscPut, OscString};
+
+    setPrintable(table, ApcString, ActApcPut, ApcString);
+    table[ApcString][CatControl] = Transition{ActIgnore, ApcString};
+    table[ApcString][CatCancel] = Transition{ActIgnore, ApcString};
+    table[ApcString][CatBell] = Transition{ActApcPut, ApcString};
+    table[ApcString][CatEscape] = Transition{ActApcPut, ApcString};
+
+    setPrintable(table, PmString, ActPmPut, PmString);
+    setPrintable(table, DcsString, ActDcsPut, DcsString);
+
+    setPrintable(table, Vt52Escape, ActVt52Dispatch, Ground);
+    table[Vt52Escape][CatCursor] = Transition{ActCollect, Vt52CursorRow};
+    setPrintable(table, Vt52CursorRow, ActCollect, Vt52CursorColumn);
+    setPrintable(table, Vt52CursorColumn, ActVt52CursorDispatch, Ground);
+
+    return table;
+}
+
+constexpr CategoryTable categoryTable = buildCategoryTable();
+constexpr TransitionTable transitionTable = buildTransitionTable();
+
+inline quint8 charCategory(uint cc)
+{
+    return cc < 256 ? categoryTable[cc] : quint8(CatOther);
+}
+}
+
 /* The tokenizer's state
 
    The state is represented by the buffer (tokenBuffer, tokenBufferPos),
-   and accompanied by decoded arguments kept in (argv,argc).
+   the current state of the parser (parserState), and accompanied by
+   decoded arguments kept in (argv,argc).
    Note that they are kept internal in the tokenizer.
 */
 
 void Vt102Emulation::resetTokenizer()
 {
     tokenBufferPos = 0;
+    parserState = Ground;
     argc = 0;
     argv[0] = 0;
     argv[1] = 0;
@@ -293,12 +537,8 @@ void Vt102Emulation::addToCurrentToken(uint cc)
 }
 
 // Character Class flags used while decoding
-const int CTL = 1; // Control character
-const int CHR = 2; // Printable character
 const int CPN = 4; // TODO: Document me
 const int DIG = 8; // Digit
-const int SCS = 16; // Select Character Set
-const int GRP = 32; // TODO: Document me
 const int CPS = 64; // Character which indicates end of window resize
 const int INT = 128; // Intermediate Byte (ECMA 48 5.4 -> CSI P..P I..I F)
 
@@ -309,12 +549,6 @@ void Vt102Emulation::initTokenizer()
     for (i = 0; i < 256; ++i) {
         charClass[i] = 0;
     }
-    for (i = 0; i < 32; ++i) {
-        charClass[i] |= CTL;
-    }
-    for (i = 32; i < 256; ++i) {
-        charClass[i] |= CHR;
-    }
     for (i = 0x20; i < 0x30; ++i) {
         charClass[i] |= INT;
     }
@@ -328,158 +562,236 @@ void Vt102Emulation::initTokenizer()
     for (s = (quint8 *)"0123456789"; *s != 0U; ++s) {
         charClass[*s] |= DIG;
     }
-    for (s = (quint8 *)"()+*%"; *s != 0U; ++s) {
-        charClass[*s] |= SCS;
-    }
-    for (s = (quint8 *)"()+*#[]%"; *s != 0U; ++s) {
-        charClass[*s] |= GRP;
-    }
 
     resetTokenizer();
 }
 
-/* Ok, here comes the nasty part of the decoder.
-
-   Instead of keeping an explicit state, we deduce it from the
-   token scanned so far. It is then immediately combined with
-   the current character to form a scanning decision.
+/* The macros below are used while dispatching a complete CSI sequence
+   and by the Sixel decoder. See receiveChars() for the state machine
+   which drives the tokenizer.
 
-   This is done by the following defines.
-
-   - P is the length of the token scanned so far.
-   - L (often P-1) is the position on which contents we base a decision.
    - C is a character or a group of characters (taken from 'charClass').
 
    - 'cc' is the current character
    - 's' is a pointer to the start of the token buffer
    - 'p' is the current position within the token buffer
-
-   Note that they need to applied in proper order.
 */
 
 /* clang-format off */
-#define lec(P,L,C) (p == (P) && s[(L)] == (C))
-#define les(P,L,C) (p == (P) && s[L] < 256 && (charClass[s[(L)]] & (C)) == (C))
-#define eec(C)     (p >=  3  && cc == (C))
 #define ccc(C)     (cc < 256 && (charClass[cc] & (C)) == (C))
-#define ees(C)     (p >=  3  && cc < 256 && (charClass[cc] & (C)) == (C))
 #define eps(C)     (p >=  3  && s[2] != '?' && s[2] != '!' && s[2] != '=' && s[2] != '>' && cc < 256 && (charClass[cc] & (C)) == (C) && (charClass[s[p-2]] & (INT)) != (INT) )
 #define epp( )     (p >=  3  && s[2] == '?')
-#define epe( )     (p >=  3  && s[2] == '!')
 #define eeq( )     (p >=  3  && s[2] == '=')
 #define egt( )     (p >=  3  && s[2] == '>')
-#define esp( )     (p >=  4  && s[2] == SP )
-#define epsp( )    (p >=  5  && s[3] == SP )
-#define osc        (tokenBufferPos >= 2 && tokenBuffer[1] == ']')
-//#define apc(C)     (p >= 3 && s[1] == '_' && s[2] == C)
-#define pm         (tokenBufferPos >= 2 && tokenBuffer[1] == '^')
-#define apc        (tokenBufferPos >= 2 && tokenBuffer[1] == '_')
 #define ces(C)     (cc < 256 && (charClass[cc] & (C)) == (C))
-#define dcs        (p >= 2   && s[0] == ESC && s[1] == 'P')
 #define sixel( )   (p == 1 && cc >= '?' && cc <= '~')
 
 /* clang-format on */
 
-#define CNTL(c) ((c) - '@')
 const int ESC = 27;
 const int DEL = 127;
-const int SP = 32;
+
+// Characters which are displayed as-is while no sequence is being parsed
+static inline bool isPrintable(uint cc)
+{
+    return cc >= 32 && cc != DEL && cc != (ESC + 128);
+}
 
 // process an incoming unicode character
 void Vt102Emulation::receiveChars(const QVector<uint> &chars)
 {
-    for (uint cc : chars) {
+    const uint *data = chars.constData();
+    const int count = chars.size();
+
+    for (int i = 0; i < count; ++i) {
+        const uint cc = data[i];
+
         if (cc == DEL) {
             continue; // VT100: ignore.
         }
 
-        // early out for displayable characters
-        if (!getMode(MODE_Sixel) && getMode(MODE_Ansi) && tokenBufferPos == 0 && cc >= 32 && cc != (ESC + 128)) {
-            _currentScreen->displayCharacter(applyCharset(cc));
+        if (getMode(MODE_Sixel)) {
+            // ST must always be able to terminate the image, even when it follows
+            // an incomplete sixel command
+            if (cc == ESC) {
+                resetTokenizer();
+            }
+            addToCurrentToken(cc);
+            if (!processSixel(cc) && !(tokenBufferPos == 1 && tokenBuffer[0] == ESC)) {
+                resetTokenizer();
+            }
             continue;
         }
 
-        if (!getMode(MODE_Sixel) && ces(CTL)) {
-            // ignore control characters in the text part of osc (aka OSC) "ESC]"
-            // escape sequences; this matches what XTERM docs say
-            // Allow BEL and ESC here, it will either end the text or be removed later.
-            if ((osc || apc) && cc != 0x1b && cc != 0x07) {
-                continue;
+        // early out for runs of displayable characters
+        if (parserState == Ground && isPrintable(cc) && getMode(MODE_Ansi)) {
+            int end = i + 1;
+            while (end < count && isPrintable(data[end])) {
+                ++end;
             }
+            displayRun(data + i, end - i);
+            i = end - 1;
+            continue;
+        }
 
-            if (!osc && !apc) {
-                // DEC HACK ALERT! Control Characters are allowed *within* esc sequences in VT100
-                // This means, they do neither a resetTokenizer() nor a pushToToken(). Some of them, do
-                // of course. Guess this originates from a weakly layered handling of the X-on
-                // X-off protocol, which comes really below this level.
-                if (cc == CNTL('X') || cc == CNTL('Z') || cc == ESC) {
-                    resetTokenizer(); // VT100: CAN or SUB
-                }
-                if (cc != ESC) {
-                    processToken(token_ctl(cc + '@'), 0, 0);
-                    continue;
-                }
+        const Transition transition = transitionTable[parserState][charCategory(cc)];
+
+        switch (transition.action) {
+        case ActIgnore:
+            continue;
+        case ActPrint:
+            processToken(token_chr(), cc, 0);
+            continue;
+        case ActExecute:
+            processToken(token_ctl(cc + '@'), 0, 0);
+            continue;
+        case ActCancel:
+            resetTokenizer(); // VT100: CAN or SUB
+            processToken(token_ctl(cc + '@'), 0, 0);
+            continue;
+        case ActStartEscape:
+            resetTokenizer();
+            addToCurrentToken(cc);
+            parserState = getMode(MODE_Ansi) ? Escape : Vt52Escape;
+            continue;
+        case ActStartCsi8:
+            if (!getMode(MODE_Ansi)) {
+                processToken(token_chr(), cc, 0);
+                continue;
             }
+            addToCurrentToken(ESC);
+            addToCurrentToken('[');
+            parserState = CsiEntry;
+            continue;
+        default:
+            break;
         }
+
         // advance the state
         addToCurrentToken(cc);
+        parserState = transition.next;
 
         uint *s = tokenBuffer;
         const int p = tokenBufferPos;
 
-        if (getMode(MODE_Sixel) && processSixel(cc)) {
-            continue;
-        }
-
-        if (getMode(MODE_Ansi)) {
-            if (lec(1, 0, ESC)) {
-                continue;
-            }
-            if (lec(1, 0, ESC + 128)) {
-                s[0] = ESC;
-                receiveChars(QVector<uint>{'['});
-                continue;
+        /* clang-format off */
+        switch (transition.action) {
+        case ActCollect:
+            break;
+        case ActEscDispatch:     processToken(token_esc(cc), 0, 0);           resetTokenizer(); break;
+        case ActCharsetDispatch: processToken(token_esc_cs(s[1], cc), 0, 0);  resetTokenizer(); break;
+        case ActHashDispatch:    processToken(token_esc_de(cc), 0, 0);        resetTokenizer(); break;
+        case ActParam:           addDigit(cc - '0'); break;
+        case ActNextParam:       addArgument();      break;
+        case ActCsiSpace:
+            // <ESC> '[' Pn SP ...
+            if (p == 4) {
+                parserState = CsiParamSpace;
             }
-            if (les(2, 1, GRP)) {
-                continue;
+            break;
+        case ActCsiBangDispatch:       processToken(token_csi_pe(cc), 0, 0);           resetTokenizer(); break;
+        case ActCsiSpaceDispatch:      processToken(token_csi_sp(cc), 0, 0);           resetTokenizer(); break;
+        case ActCsiParamSpaceDispatch: processToken(token_csi_psp(cc, argv[0]), 0, 0); resetTokenizer(); break;
+        case ActCsiDispatch:
+            if (eps(CPN)) {
+                processToken(token_csi_pn(cc), argv[0], argv[1]);
+            } else if (eps(CPS)) {
+                // resize = \e[8;<row>;<col>t
+                processToken(token_csi_ps(cc, argv[0]), argv[1], argv[2]);
+            } else if (cc == 'y' && s[p - 2] == '*') {
+                processChecksumRequest(argc, argv);
+            } else {
+                for (int i = 0; i <= argc; i++) {
+                    if (epp()) {
+                        processToken(token_csi_pr(cc,argv[i]), i, 0);
+                    } else if (eeq()) {
+                        processToken(token_csi_pq(cc), 0, 0); // spec. case for ESC[=0c or ESC[=c
+                    } else if (egt()) {
+                        processToken(token_csi_pg(cc), 0, 0); // spec. case for ESC[>0c or ESC[>c
+                    } else if (cc == 'm' && argc - i >= 4 && (argv[i] == 38 || argv[i] == 48) && argv[i+1] == 2)
+                    {
+                        // ESC[ ... 48;2;<red>;<green>;<blue> ... m -or- ESC[ ... 38;2;<red>;<green>;<blue> ... m
+                        i += 2;
+                        processToken(token_csi_ps(cc, argv[i-2]), COLOR_SPACE_RGB, (argv[i] << 16) | (argv[i+1] << 8) | argv[i+2]);
+                        i += 2;
+                    } else if (cc == 'm' && argc - i >= 2 && (argv[i] == 38 || argv[i] == 48) && argv[i+1] == 5) {
+                        // ESC[ ... 48;5;<index> ... m -or- ESC[ ... 38;5;<index> ... m
+                        i += 2;
+                        processToken(token_csi_ps(cc, argv[i-2]), COLOR_SPACE_256, argv[i]);
+                    } else if ((charClass[s[p-2]] & (INT)) != (INT)) {
+                        processToken(token_csi_ps(cc,argv[i]), 0, 0);
+                    }
+                }
             }
+            resetTokenizer();
+            break;
+        /* clang-format on */
+        case ActOscPut:
             // Operating System Command
-            if (p > 2 && s[1] == ']') {
-                // <ESC> ']' ... <ESC> '\'
-                if (s[p - 2] == ESC && s[p - 1] == '\\') {
-                    // This runs two times per link, the first prepares the link to be read,
-                    // the second finalizes it. The escape sequence is in two parts
-                    //  start: '\e ] 8 ; <id-path> ; <url-part> \e \\'
-                    //  end:   '\e ] 8 ; ; \e \\'
-                    // GNU libtextstyle inserts the IDs, for instance; many examples
-                    // do not.
-                    if (s[2] == XTERM_EXTENDED::URL_LINK) {
-                        // printf '\e]8;;https://example.com\e\\This is a link\e]8;;\e\\\n'
-                        emit toggleUrlExtractionRequest();
-                    }
-                    processSessionAttributeRequest(p - 1);
-                    resetTokenizer();
-                    continue;
+            // <ESC> ']' ... <ESC> '\'
+            if (s[p - 2] == ESC && s[p - 1] == '\\') {
+                // This runs two times per link, the first prepares the link to be read,
+                // the second finalizes it. The escape sequence is in two parts
+                //  start: '\e ] 8 ; <id-path> ; <url-part> \e \\'
+                //  end:   '\e ] 8 ; ; \e \\'
+                // GNU libtextstyle inserts the IDs, for instance; many examples
+                // do not.
+                if (s[2] == XTERM_EXTENDED::URL_LINK) {
+                    // printf '\e]8;;https://example.com\e\\This is a link\e]8;;\e\\\n'
+                    emit toggleUrlExtractionRequest();
                 }
-                // <ESC> ']' ... <ESC> + one character for reprocessing
-                if (s[p - 2] == ESC) {
-                    processSessionAttributeRequest(p - 1);
-                    resetTokenizer();
-                    receiveChars(QVector<uint>{cc});
-                    continue;
+                processSessionAttributeRequest(p - 1);
+                resetTokenizer();
+                break;
+            }
+            // <ESC> ']' ... <ESC> + one character for reprocessing
+            if (s[p - 2] == ESC) {
+                processSessionAttributeRequest(p - 1);
+                resetTokenizer();
+                receiveChars(QVector<uint>{cc});
+                break;
+            }
+            // <ESC> ']' ... <BEL>
+            if (s[p - 1] == 0x07) {
+                processSessionAttributeRequest(p);
+                resetTokenizer();
+                break;
+            }
+            // Special case: iterm file protocol is a long escape sequence
+            if (tokenState == -1) {
+                tokenStateChange = "1337;File=:";
+                tokenState = 0;
+            }
+            if (tokenState >= 0) {
+                if ((uint)tokenStateChange[tokenState] == s[p - 1]) {
+                    tokenState++;
+                    tokenPos = p;
+                    if ((uint)tokenState == strlen(tokenStateChange)) {
+                        tokenState = -2;
+                        tokenData.clear();
+                    }
                 }
-                // <ESC> ']' ... <BEL>
-                if (s[p - 1] == 0x07) {
-                    processSessionAttributeRequest(p);
-                    resetTokenizer();
-                    continue;
+            } else if (tokenState == -2) {
+                if (p - tokenPos == 4) {
+                    tokenData.append(QByteArray::fromBase64(QString::fromUcs4(&tokenBuffer[tokenPos], 4).toLocal8Bit()));
+                    tokenBufferPos -= 4;
                 }
-                // Special case: iterm file protocol is a long escape sequence
+            }
+            break;
+        case ActPmPut:
+            // Privacy Message
+            if (s[p - 1] == 0x07 || (s[p - 2] == ESC && s[p - 1] == '\\')) {
+                resetTokenizer();
+            }
+            break;
+        case ActApcPut:
+            // Application Program Command
+            // <ESC> '_' ... <ESC> '\'
+            if (p > 3 && s[2] == 'G') {
                 if (tokenState == -1) {
-                    tokenStateChange = "1337;File=:";
+                    tokenStateChange = ";";
                     tokenState = 0;
-                }
-                if (tokenState >= 0) {
+                } else if (tokenState >= 0) {
                     if ((uint)tokenStateChange[tokenState] == s[p - 1]) {
                         tokenState++;
                         tokenPos = p;
@@ -487,152 +799,49 @@ void Vt102Emulation::receiveChars(const QVector<uint> &chars)
                             tokenState = -2;
                             tokenData.clear();
                         }
-                        continue;
+                        break;
                     }
                 } else if (tokenState == -2) {
                     if (p - tokenPos == 4) {
                         tokenData.append(QByteArray::fromBase64(QString::fromUcs4(&tokenBuffer[tokenPos], 4).toLocal8Bit()));
                         tokenBufferPos -= 4;
-                        continue;
+                        break;
                     }
                 }
             }
-            // Privacy Message
-            if (p > 2 && s[1] == '^') {
-                if (s[p - 1] == 0x07 || (s[p - 2] == ESC && s[p - 1] == '\\')) {
-                    resetTokenizer();
-                    continue;
-                }
-            }
-            // Application Program Command
-            if (p > 2 && s[1] == '_') {
-                // <ESC> '_' ... <ESC> '\'
-                if (p > 3 && s[2] == 'G') {
-                    if (tokenState == -1) {
-                        tokenStateChange = ";";
-                        tokenState = 0;
-                    } else if (tokenState >= 0) {
-                        if ((uint)tokenStateChange[tokenState] == s[p - 1]) {
-                            tokenState++;
-                            tokenPos = p;
-                            if ((uint)tokenState == strlen(tokenStateChange)) {
-                                tokenState = -2;
-                                tokenData.clear();
-                            }
-                            continue;
-                        }
-                    } else if (tokenState == -2) {
-                        if (p - tokenPos == 4) {
-                            tokenData.append(QByteArray::fromBase64(QString::fromUcs4(&tokenBuffer[tokenPos], 4).toLocal8Bit()));
-                            tokenBufferPos -= 4;
-                            continue;
-                        }
-                    }
-                }
-                if (s[p - 1] == 0x07 || (s[p - 2] == ESC && s[p - 1] == '\\')) {
-                    if (s[2] == 'G') {
-                        // Graphics command
-                        processGraphicsToken(p);
-                    }
-                    resetTokenizer();
-                    continue;
+            if (s[p - 1] == 0x07 || (s[p - 2] == ESC && s[p - 1] == '\\')) {
+                if (s[2] == 'G') {
+                    // Graphics command
+                    processGraphicsToken(p);
                 }
-            }
-
-            /* clang-format off */
-        // <ESC> ']' ...
-        if (osc         ) { continue; }
-        if (pm          ) { continue; }
-        if (apc         ) { continue; }
-        if (p >= 3 && s[1] == '[') { // parsing a CSI sequence
-            if (lec(3,2,'?')) { continue; }
-            if (lec(3,2,'=')) { continue; }
-            if (lec(3,2,'>')) { continue; }
-            if (lec(3,2,'!')) { continue; }
-            if (lec(3,2,SP )) { continue; }
-            if (lec(4,3,SP )) { continue; }
-            if (eps(    CPN)) { processToken(token_csi_pn(cc), argv[0],argv[1]);  resetTokenizer(); continue; }
-
-            // resize = \e[8;<row>;<col>t
-            if (eps(CPS)) {
-                processToken(token_csi_ps(cc, argv[0]), argv[1], argv[2]);
                 resetTokenizer();
-                continue;
-            }
-
-            if (epe(   )) { processToken(token_csi_pe(cc), 0, 0); resetTokenizer(); continue; }
-
-            if (esp (   )) { processToken(token_csi_sp(cc), 0, 0);           resetTokenizer(); continue; }
-            if (epsp(   )) { processToken(token_csi_psp(cc, argv[0]), 0, 0); resetTokenizer(); continue; }
-
-            if (ees(DIG)) { addDigit(cc-'0'); continue; }
-            if (eec(';')) { addArgument();    continue; }
-            if (ees(INT)) { continue; }
-            if (p >= 3 && cc == 'y' && s[p - 2] == '*') { processChecksumRequest(argc, argv); resetTokenizer(); continue; }
-            for (int i = 0; i <= argc; i++) {
-                if (epp()) {
-                    processToken(token_csi_pr(cc,argv[i]), i, 0);
-                } else if (eeq()) {
-                    processToken(token_csi_pq(cc), 0, 0); // spec. case for ESC[=0c or ESC[=c
-                } else if (egt()) {
-                    processToken(token_csi_pg(cc), 0, 0); // spec. case for ESC[>0c or ESC[>c
-                } else if (cc == 'm' && argc - i >= 4 && (argv[i] == 38 || argv[i] == 48) && argv[i+1] == 2)
-                {
-                    // ESC[ ... 48;2;<red>;<green>;<blue> ... m -or- ESC[ ... 38;2;<red>;<green>;<blue> ... m
-                    i += 2;
-                    processToken(token_csi_ps(cc, argv[i-2]), COLOR_SPACE_RGB, (argv[i] << 16) | (argv[i+1] << 8) | argv[i+2]);
-                    i += 2;
-                } else if (cc == 'm' && argc - i >= 2 && (argv[i] == 38 || argv[i] == 48) && argv[i+1] == 5) {
-                    // ESC[ ... 48;5;<index> ... m -or- ESC[ ... 38;5;<index> ... m
-                    i += 2;
-                    processToken(token_csi_ps(cc, argv[i-2]), COLOR_SPACE_256, argv[i]);
-                } else if (p < 2 || (charClass[s[p-2]] & (INT)) != (INT)) {
-                    processToken(token_csi_ps(cc,argv[i]), 0, 0);
-                }
             }
-        } else {
-            if (dcs) {
-                // Check for Sixel DCS q
-                if (p > 2 && cc == 'q') {
-                    setMode(MODE_Sixel);
-                    // This parameter appears to be ignored
-                    // m_preserveBackground = argv[2] == 1;
-                    resetTokenizer();
-                }
-                if (ccc(DIG)) { addDigit(cc-'0');}
-                if (cc == ';') { addArgument();}
-                continue;
-            }
-            if (lec(2,0,ESC)) { processToken(token_esc(s[1]), 0, 0);              resetTokenizer(); continue; }
-            if (les(3,1,SCS)) { processToken(token_esc_cs(s[1],s[2]), 0, 0);      resetTokenizer(); continue; }
-            if (lec(3,1,'#')) { processToken(token_esc_de(s[2]), 0, 0);           resetTokenizer(); continue; }
-        }
-        resetTokenizer();
-        /* clang-format on */
-        } else {
-            // VT52 Mode
-            if (lec(1, 0, ESC)) {
-                continue;
-            }
-            if (les(1, 0, CHR)) {
-                processToken(token_chr(), s[0], 0);
+            break;
+        case ActDcsPut:
+            // Check for Sixel DCS q
+            if (cc == 'q') {
+                setMode(MODE_Sixel);
+                // This parameter appears to be ignored
+                // m_preserveBackground = argv[2] == 1;
                 resetTokenizer();
-                continue;
-            }
-            if (lec(2, 1, 'Y')) {
-                continue;
             }
-            if (lec(3, 1, 'Y')) {
-                continue;
+            if (ccc(DIG)) {
+                addDigit(cc - '0');
             }
-            if (p < 4) {
-                processToken(token_vt52(s[1]), 0, 0);
-                resetTokenizer();
-                continue;
+            if (cc == ';') {
+                addArgument();
             }
+            break;
+        case ActVt52Dispatch:
+            processToken(token_vt52(cc), 0, 0);
+            resetTokenizer();
+            break;
+        case ActVt52CursorDispatch:
             processToken(token_vt52(s[1]), s[2], s[3]);
             resetTokenizer();
-            continue;
+            break;
+        default:
+            break;
         }
     }
 }
@@ -1934,6 +2143,22 @@ void Vt102Emulation::sendKeyEvent(QKeyEvent *event)
 
 #define CHARSET _charset[_currentScreen == _screen[1]]
 
+// Display a run of printable characters, applying the current character map.
+
+void Vt102Emulation::displayRun(const uint *chars, int count)
+{
+    if (!CHARSET.graphic && !CHARSET.pound) {
+        _currentScreen->displayRun(chars, count);
+        return;
+    }
+
+    QVarLengthArray<uint, 512> mapped(count);
+    for (int i = 0; i < count; ++i) {
+        mapped[i] = applyCharset(chars[i]);
+    }
+    _currentScreen->displayRun(mapped.constData(), count);
+}
+
 // Apply current character map.
 
 unsigned int Vt102Emulation::applyCharset(uint c)
@@ -2306,11 +2531,13 @@ void Vt102Emulation::SixelModeEnable(int width, int height)
 
 void Vt102Emulation::SixelModeAbort()
 {
+    // leave sixel mode even before the image was started, so that the
+    // characters which aborted it are not handed back to processSixel()
+    resetMode(MODE_Sixel);
+    resetTokenizer();
     if (!m_SixelStarted) {
         return;
     }
-    resetMode(MODE_Sixel);
-    resetTokenizer();
     m_SixelStarted = false;
     m_currentImage = QImage();
 }
@@ -2513,11 +2740,13 @@ bool Vt102Emulation::processSixel(uint cc)
             resetTokenizer();
             receiveChars(QVector<uint>{s[1]}); // re-send the actual character
             return true;
-        default:
+        default: {
+            const QVector<uint> sequence{s[0], s[1]};
             SixelModeAbort();
-            receiveChars(QVector<uint>{s[0], s[1]}); // re-send the actual character
+            receiveChars(sequence); // re-send the actual character
             return true;
         }
+        }
     }
     if (!m_SixelStarted && (sixel() || s[0] == '!' || s[0] == '#')) {
         m_aspect = qMakePair(1, 1);
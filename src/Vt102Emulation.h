@@ -99,6 +99,7 @@ private Q_SLOTS:
 
 private:
     unsigned int applyCharset(uint c);
+    void displayRun(const uint *chars, int count);
     void setCharset(int n, int cs);
     void useCharset(int n);
     void setAndUseCharset(int n, int cs);
@@ -135,6 +136,8 @@ private:
     int argv[MAXARGS] = {};
     int argc;
     void initTokenizer();
+    // Current state of the table driven tokenizer (see receiveChars())
+    int parserState;
     // State machine for escape sequences containing large amount of data
     int tokenState;
     const char *tokenStateChange;
@@ -0,0 +1,163 @@
+/*
+    SPDX-FileCopyrightText: 2022 Konsole Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+// Own
+#include "EmulationBenchmark.h"
+
+// Qt
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextCodec>
+
+#include "qtest.h"
+
+// Konsole
+#include "../Vt102Emulation.h"
+#include "../history/compact/CompactHistoryType.h"
+
+using namespace Konsole;
+
+// Size of each generated stream
+static const int STREAM_SIZE = 4 * 1024 * 1024;
+// Size of the chunks handed to receiveData(), matching what Pty delivers
+static const int CHUNK_SIZE = 4096;
+
+static QByteArray repeatToSize(const QByteArray &pattern)
+{
+    QByteArray stream;
+    stream.reserve(STREAM_SIZE + pattern.size());
+    while (stream.size() < STREAM_SIZE) {
+        stream.append(pattern);
+    }
+    return stream;
+}
+
+// Plain ASCII, like `yes` or compiler output
+static QByteArray asciiStream()
+{
+    QByteArray pattern;
+    for (int line = 0; line < 64; ++line) {
+        pattern.append("/usr/include/c++/lib/some_header.h:" + QByteArray::number(line * 7) + ": note: in instantiation of template\r\n");
+    }
+    return repeatToSize(pattern);
+}
+
+// Many short runs of text with SGR colors, like `ls --color` or htop
+static QByteArray sgrStream()
+{
+    QByteArray pattern;
+    for (int i = 0; i < 256; ++i) {
+        pattern.append("\033[0;" + QByteArray::number(30 + i % 8) + "m" + "file" + QByteArray::number(i));
+        pattern.append("\033[1;38;5;" + QByteArray::number(i) + "m" + "*");
+        pattern.append("\033[48;2;" + QByteArray::number(i) + ";40;80m" + " 12.5K ");
+        pattern.append("\033[m");
+        if (i % 8 == 7) {
+            pattern.append("\r\n");
+        }
+    }
+    return repeatToSize(pattern);
+}
+
+// Double width CJK text
+static QByteArray cjkStream()
+{
+    const QString line = QStringLiteral("终端模拟器的吞吐量测试。日本語のテキストも表示します。한국어 텍스트도 있습니다.\r\n");
+    return repeatToSize(line.toUtf8());
+}
+
+// Text with a lot of combining characters
+static QByteArray combiningStream()
+{
+    const QString line = QStringLiteral("éàôüñ Z͓͑͒a͛͜l͠͡g҉o̴ ");
+    return repeatToSize((line + line + line + QStringLiteral("\r\n")).toUtf8());
+}
+
+// Cursor motion and erasing, like vttest or a full screen editor redrawing
+static QByteArray cursorStream()
+{
+    QByteArray pattern;
+    for (int i = 0; i < 200; ++i) {
+        pattern.append("\033[" + QByteArray::number(i % 40 + 1) + ";" + QByteArray::number(i % 70 + 1) + "H");
+        pattern.append("\033[K\033[1@x\033[2P\033[3C\033[1A\033[2B");
+        pattern.append("\0337\033[10;20r\033[5S\033[2T\033[r\0338");
+        pattern.append("\033[?25l\033[?7h\033[?25h\033[2J\033[H");
+    }
+    return repeatToSize(pattern);
+}
+
+// A sixel image
+static QByteArray sixelStream()
+{
+    QByteArray pattern("\033Pq\"1;1;256;96#0;2;0;0;0#1;2;100;0;0#2;2;0;100;0");
+    for (int band = 0; band < 16; ++band) {
+        for (int color = 0; color < 3; ++color) {
+            pattern.append("#" + QByteArray::number(color));
+            for (int x = 0; x < 32; ++x) {
+                pattern.append(char('?' + (x + band + color) % 64));
+                pattern.append("!7" + QByteArray(1, char('?' + x % 64)));
+            }
+            pattern.append("$");
+        }
+        pattern.append("-");
+    }
+    pattern.append("\033\\\r\n");
+    return repeatToSize(pattern);
+}
+
+void EmulationBenchmark::benchmarkReceiveData_data()
+{
+    QTest::addColumn<QByteArray>("stream");
+
+    QTest::newRow("ascii") << asciiStream();
+    QTest::newRow("sgr") << sgrStream();
+    QTest::newRow("cjk") << cjkStream();
+    QTest::newRow("combining") << combiningStream();
+    QTest::newRow("cursor") << cursorStream();
+    QTest::newRow("sixel") << sixelStream();
+
+    const QString dataDir = qEnvironmentVariable("KONSOLE_BENCHMARK_DATA");
+    if (!dataDir.isEmpty()) {
+        const QDir dir(dataDir);
+        const QStringList files = dir.entryList(QDir::Files, QDir::Name);
+        for (const QString &fileName : files) {
+            QFile file(dir.filePath(fileName));
+            if (file.open(QIODevice::ReadOnly)) {
+                QTest::newRow(qPrintable(fileName)) << file.readAll();
+            }
+        }
+    }
+}
+
+void EmulationBenchmark::benchmarkReceiveData()
+{
+    QFETCH(QByteArray, stream);
+
+    Vt102Emulation emulation;
+    emulation.setCodec(QTextCodec::codecForName("UTF-8"));
+    emulation.setHistory(CompactHistoryType(10000));
+    emulation.setImageSize(50, 200);
+
+    qint64 bytes = 0;
+    QElapsedTimer timer;
+    timer.start();
+
+    QBENCHMARK {
+        for (int pos = 0; pos < stream.size(); pos += CHUNK_SIZE) {
+            emulation.receiveData(stream.constData() + pos, qMin(CHUNK_SIZE, stream.size() - pos));
+        }
+        bytes += stream.size();
+    }
+
+    const qint64 elapsed = timer.nsecsElapsed();
+    QVERIFY(bytes > 0);
+    qInfo("%s: %.1f MB/s, %.2f ns/byte",
+          QTest::currentDataTag(),
+          (bytes / (1024.0 * 1024.0)) / (elapsed / 1e9),
+          double(elapsed) / bytes);
+}
+
+QTEST_GUILESS_MAIN(EmulationBenchmark)
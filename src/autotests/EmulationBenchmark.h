@@ -0,0 +1,34 @@
+/*
+    SPDX-FileCopyrightText: 2022 Konsole Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef EMULATIONBENCHMARK_H
+#define EMULATIONBENCHMARK_H
+
+#include <QObject>
+
+namespace Konsole
+{
+/**
+ * Measures the throughput of the path from Emulation::receiveData() through
+ * Vt102Emulation and Screen into a CompactHistoryScroll.
+ *
+ * Each data row replays a byte stream typical of some kind of terminal
+ * output.  Streams recorded with e.g. `script` can be replayed as well by
+ * pointing KONSOLE_BENCHMARK_DATA at a directory containing them; every
+ * file in it becomes an additional data row.
+ */
+class EmulationBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void benchmarkReceiveData_data();
+    void benchmarkReceiveData();
+};
+
+}
+
+#endif // EMULATIONBENCHMARK_H
@@ -9,8 +9,12 @@
 
 #include "qtest.h"
 
+// Qt
+#include <QTextStream>
+
 // Konsole
 #include "../Emulation.h"
+#include "../decoders/PlainTextDecoder.h"
 #include "../session/Session.h"
 
 using namespace Konsole;
@@ -51,6 +55,84 @@ void HistoryTest::testCompactHistory()
     QCOMPARE(historyTypeCompact->maximumLineCount(), 42);
 }
 
+void HistoryTest::testCompactHistoryWrap()
+{
+    // the contents of history line n, some of them wide, wrapped or larger
+    // than a chunk
+    const auto lineLength = [](int n) {
+        return n == 1234 ? 20000 : 1 + n % 120;
+    };
+    const auto cellAt = [](int n, int column) {
+        const uint character = n % 3 == 0 ? 0x263a + (n + column) % 7 : 'a' + (n + column) % 26;
+        return Character(character, CharacterColor(COLOR_SPACE_256, n % 16), CharacterColor(), RenditionFlags(column % 2 == 0 ? RE_BOLD : 0));
+    };
+    const auto isWrapped = [](int n) {
+        return n % 4 == 0;
+    };
+
+    const auto addLines = [&](CompactHistoryScroll &history, int first, int last) {
+        for (int n = first; n < last; n++) {
+            QVector<Character> line(lineLength(n));
+            for (int column = 0; column < line.size(); column++) {
+                line[column] = cellAt(n, column);
+            }
+            history.addCellsVector(line);
+            history.addLine(isWrapped(n) ? LINE_WRAPPED : LINE_DEFAULT);
+        }
+    };
+
+    const auto verifyLines = [&](const CompactHistoryScroll &history, int lastLine) {
+        const int firstLine = lastLine - history.getLines();
+        for (int i = 0; i < history.getLines(); i++) {
+            const int n = firstLine + i;
+            QCOMPARE(history.getLineLen(i), lineLength(n));
+            QCOMPARE(history.isWrappedLine(i), isWrapped(n));
+
+            QVector<Character> cells(history.getLineLen(i));
+            history.getCells(i, 0, cells.size(), cells.data());
+            for (int column = 0; column < cells.size(); column++) {
+                QCOMPARE(cells[column], cellAt(n, column));
+            }
+
+            // a part of the line, starting in the middle of an attribute run
+            const int startColumn = cells.size() / 2;
+            QVector<Character> part(cells.size() - startColumn);
+            history.getCells(i, startColumn, part.size(), part.data());
+            for (int column = 0; column < part.size(); column++) {
+                QCOMPARE(part[column], cellAt(n, startColumn + column));
+            }
+        }
+    };
+
+    // many more lines than the history holds, so the line index wraps
+    // around several times and the chunks of the dropped lines are released
+    CompactHistoryScroll history(50);
+    addLines(history, 0, 20000);
+    QCOMPARE(history.getLines(), 50);
+    verifyLines(history, 20000);
+
+    // a line larger than a chunk
+    history.setMaxNbLines(1000);
+    addLines(history, 20000, 20100);
+    QCOMPARE(history.getLines(), 150);
+    addLines(history, 1234, 1235);
+    QCOMPARE(history.getLineLen(150), 20000);
+    QVector<Character> largeLine(20000);
+    history.getCells(150, 0, largeLine.size(), largeLine.data());
+    QCOMPARE(largeLine.last(), cellAt(1234, 19999));
+    history.removeCells();
+    QCOMPARE(history.getLines(), 150);
+    verifyLines(history, 20100);
+
+    // shrinking the history drops the oldest lines
+    history.setMaxNbLines(30);
+    QCOMPARE(history.getLines(), 30);
+    verifyLines(history, 20100);
+    addLines(history, 20100, 20175);
+    QCOMPARE(history.getLines(), 30);
+    verifyLines(history, 20175);
+}
+
 void HistoryTest::testEmulationHistory()
 {
     auto session = new Session();
@@ -229,4 +311,431 @@ void HistoryTest::testHistoryTypeChange()
     delete[] testImage;
 }
 
+void HistoryTest::testHistoryAttributes()
+{
+    // Cells with many different colors and renditions have to survive being
+    // stored in the history
+    const int lineLength = 40;
+    QVector<Character> line(lineLength);
+    for (int i = 0; i < lineLength; i++) {
+        const CharacterColor foreground(i % 3 == 0 ? COLOR_SPACE_RGB : COLOR_SPACE_SYSTEM, i * 0x10305);
+        const CharacterColor background(i % 4 == 0 ? COLOR_SPACE_256 : COLOR_SPACE_DEFAULT, i / 4);
+        line[i] = Character('a' + i % 26, foreground, background, RenditionFlags(i / 5), i % 7 != 0);
+    }
+    line[lineLength - 1] = Character(0xdeadbeef, CharacterColor(COLOR_SPACE_RGB, 0x123456), CharacterColor(), RE_EXTENDED_CHAR | RE_BOLD);
+
+    std::vector<std::unique_ptr<HistoryScroll>> scrolls;
+    scrolls.emplace_back(new HistoryScrollFile());
+    scrolls.emplace_back(new CompactHistoryScroll(10));
+    scrolls.emplace_back(new CompressedHistoryScroll());
+
+    for (const auto &historyScroll : scrolls) {
+        historyScroll->addCells(line.constData(), lineLength);
+        historyScroll->addLine(LINE_DEFAULT);
+        historyScroll->addCellsVector(line);
+        historyScroll->addLine(LINE_WRAPPED);
+        QCOMPARE(historyScroll->getLines(), 2);
+
+        for (int lineNumber = 0; lineNumber < 2; lineNumber++) {
+            QCOMPARE(historyScroll->getLineLen(lineNumber), lineLength);
+            QVector<Character> result(lineLength);
+            historyScroll->getCells(lineNumber, 0, lineLength, result.data());
+            for (int i = 0; i < lineLength; i++) {
+                QCOMPARE(result[i], line[i]);
+                QCOMPARE(result[i].isRealCharacter, line[i].isRealCharacter);
+            }
+        }
+
+        Character cell;
+        historyScroll->getCells(1, 5, 1, &cell);
+        QCOMPARE(cell, line[5]);
+        QVERIFY(historyScroll->isWrappedLine(1));
+
+        // Latin-1 only text with a couple of long attribute runs
+        QVector<Character> plainLine(lineLength, Character('x'));
+        for (int i = 10; i < 20; i++) {
+            plainLine[i] = Character(0xe9, CharacterColor(COLOR_SPACE_SYSTEM, 2), CharacterColor(), RE_UNDERLINE);
+        }
+        historyScroll->addCellsVector(plainLine);
+        historyScroll->addLine(LINE_DEFAULT);
+        QCOMPARE(historyScroll->getLineLen(2), lineLength);
+
+        QVector<Character> result(lineLength);
+        historyScroll->getCells(2, 5, 20, result.data());
+        for (int i = 0; i < 20; i++) {
+            QCOMPARE(result[i], plainLine[i + 5]);
+        }
+    }
+}
+
+void HistoryTest::testAttributeTableLimits()
+{
+    // attributes which are no longer used by any line are dropped as lines
+    // are dropped from a bounded history
+    const int lineLength = 40;
+    CompactHistoryScroll history(10);
+    QVector<Character> line(lineLength);
+    for (int lineNumber = 0; lineNumber < 1000; lineNumber++) {
+        for (int i = 0; i < lineLength; i++) {
+            line[i] = Character('a' + i % 26, CharacterColor(COLOR_SPACE_RGB, lineNumber * lineLength + i), CharacterColor(), RE_BOLD, i % 7 != 0);
+        }
+        history.addCellsVector(line);
+        history.addLine(LINE_DEFAULT);
+    }
+    QCOMPARE(history.getLines(), 10);
+    QVERIFY(history.attributeCount() < 4 * 1024);
+
+    QVector<Character> result(lineLength);
+    history.getCells(9, 0, lineLength, result.data());
+    for (int i = 0; i < lineLength; i++) {
+        QCOMPARE(result[i], line[i]);
+        QCOMPARE(result[i].isRealCharacter, line[i].isRealCharacter);
+    }
+
+    // once the table is full, new attributes are kept without their colors,
+    // and their index does not reach the place holder flag
+    CharacterAttributeTable table;
+    for (int i = 0; i < CharacterAttributeTable::MAX_SIZE; i++) {
+        table.intern(Character('a', CharacterColor(COLOR_SPACE_RGB, i)));
+    }
+    QCOMPARE(table.size(), CharacterAttributeTable::MAX_SIZE);
+
+    const Character colored('a', CharacterColor(COLOR_SPACE_RGB, 0x123456), CharacterColor(COLOR_SPACE_RGB, 0x654321), RE_UNDERLINE, false);
+    const PackedCharacter packed(colored, table);
+    QCOMPARE(table.size(), CharacterAttributeTable::MAX_SIZE + 1);
+    QVERIFY(!packed.isRealCharacter());
+
+    const Character unpacked = packed.unpack(table);
+    QCOMPARE(unpacked.rendition, RenditionFlags(RE_UNDERLINE));
+    QCOMPARE(unpacked.foregroundColor, CharacterColor(COLOR_SPACE_DEFAULT, DEFAULT_FORE_COLOR));
+    QCOMPARE(unpacked.backgroundColor, CharacterColor(COLOR_SPACE_DEFAULT, DEFAULT_BACK_COLOR));
+
+    // attributes which are already in the table keep their colors
+    const Character known('b', CharacterColor(COLOR_SPACE_RGB, 42));
+    QCOMPARE(PackedCharacter(known, table).unpack(table), known);
+    QCOMPARE(table.size(), CharacterAttributeTable::MAX_SIZE + 1);
+}
+
+void HistoryTest::testHistoryFileSegments()
+{
+    // the data written is mirrored in expected, every read is compared to it
+    HistoryFile file;
+    QByteArray expected;
+    int seed = 0;
+    auto add = [&](qint64 count) {
+        QByteArray data(int(count), Qt::Uninitialized);
+        for (int i = 0; i < data.size(); i++) {
+            data[i] = char((seed++ * 131) >> 3);
+        }
+        file.add(data.constData(), count);
+        expected.append(data);
+    };
+    auto get = [&](qint64 loc, qint64 size) {
+        QByteArray data(int(size), Qt::Uninitialized);
+        file.get(data.data(), size, loc);
+        return data == expected.mid(int(loc), int(size));
+    };
+    auto removeLast = [&](qint64 loc) {
+        file.removeLast(loc);
+        expected.truncate(int(loc));
+    };
+
+    // data is written in whole write buffers, the rest stays pending
+    const qint64 quarter = HistoryFile::WRITE_BUFFER_SIZE / 4;
+    while (expected.size() < 2 * HistoryFile::SEGMENT_SIZE + HistoryFile::WRITE_BUFFER_SIZE) {
+        add(quarter);
+    }
+    const qint64 fileLength = expected.size();
+    add(2 * quarter);
+    add(1000);
+    QCOMPARE(file.len(), qint64(expected.size()));
+
+    // reads within and across the mapped segments
+    QVERIFY(get(0, 100));
+    QVERIFY(get(HistoryFile::SEGMENT_SIZE - 500, 1000));
+    QVERIFY(get(HistoryFile::SEGMENT_SIZE - 10, HistoryFile::SEGMENT_SIZE + 20));
+    // across the last mapped segment and the partial one, which is read
+    QVERIFY(get(2 * HistoryFile::SEGMENT_SIZE - 500, 1000));
+    // across the data in the file and the pending data
+    QVERIFY(get(fileLength - 100, 200));
+    QVERIFY(get(fileLength - HistoryFile::SEGMENT_SIZE, expected.size() - fileLength + HistoryFile::SEGMENT_SIZE));
+
+    // removing pending data only
+    removeLast(expected.size() - 500);
+    add(300);
+    QVERIFY(get(fileLength - 100, expected.size() - fileLength + 100));
+
+    // removing data which was written to the file, the data added after it
+    // is read back from the pending data and then from the file
+    removeLast(fileLength - 1000);
+    add(3000);
+    QVERIFY(get(fileLength - 2000, 3000));
+    add(HistoryFile::WRITE_BUFFER_SIZE);
+    QVERIFY(get(fileLength - 2000, 3000));
+
+    // a mapped segment sees the data written after removing part of it
+    QVERIFY(get(HistoryFile::SEGMENT_SIZE, 1000));
+    removeLast(HistoryFile::SEGMENT_SIZE + 100);
+    while (expected.size() < 2 * HistoryFile::SEGMENT_SIZE + HistoryFile::WRITE_BUFFER_SIZE) {
+        add(quarter - 7);
+    }
+    QVERIFY(get(HistoryFile::SEGMENT_SIZE, 1000));
+    QVERIFY(get(0, expected.size()));
+}
+
+void HistoryTest::testCompressedHistoryColors()
+{
+    // more distinct colors than a single attribute table holds, as a long
+    // true color session in an unlimited history may produce
+    const int lineLength = 256;
+    const int lineCount = CharacterAttributeTable::MAX_SIZE / lineLength + 10;
+    auto lineCells = [](int lineNumber) {
+        QVector<Character> line(lineLength);
+        for (int i = 0; i < lineLength; i++) {
+            const int color = lineNumber * lineLength + i;
+            line[i] = Character('a' + i % 26, CharacterColor(COLOR_SPACE_RGB, color), CharacterColor(COLOR_SPACE_RGB, color ^ 0xffffff), RE_BOLD);
+        }
+        return line;
+    };
+
+    CompressedHistoryScroll history;
+    for (int lineNumber = 0; lineNumber < lineCount; lineNumber++) {
+        history.addCellsVector(lineCells(lineNumber));
+        history.addLine(LINE_DEFAULT);
+    }
+    QCOMPARE(history.getLines(), lineCount);
+
+    QVector<Character> result(lineLength);
+    for (int lineNumber : {0, lineCount / 2, lineCount - 2, lineCount - 1}) {
+        history.getCells(lineNumber, 0, lineLength, result.data());
+        QCOMPARE(result, lineCells(lineNumber));
+    }
+
+    // the last compressed block keeps its colors when it is read back
+    while (history.getLines() > lineCount - lineCount % 256 - 1) {
+        history.removeCells();
+    }
+    history.addCellsVector(lineCells(lineCount));
+    history.addLine(LINE_DEFAULT);
+    history.getCells(history.getLines() - 2, 0, lineLength, result.data());
+    QCOMPARE(result, lineCells(history.getLines() - 2));
+    history.getCells(history.getLines() - 1, 0, lineLength, result.data());
+    QCOMPARE(result, lineCells(lineCount));
+}
+
+void HistoryTest::testCompressedHistory()
+{
+    // Enough lines for a few compressed blocks
+    const int lineCount = 1000;
+    auto lineText = [](int lineNumber) {
+        return QStringLiteral("line %1 %2").arg(lineNumber).arg(QString(lineNumber % 50, QLatin1Char('x'))).toUcs4();
+    };
+
+    auto historyScroll = std::unique_ptr<CompressedHistoryScroll>(new CompressedHistoryScroll());
+    QCOMPARE(historyScroll->getType().maximumLineCount(), -1);
+
+    for (int i = 0; i < lineCount; i++) {
+        const QVector<uint> text = lineText(i);
+        QVector<Character> line;
+        for (uint c : text) {
+            line.append(Character(c, CharacterColor(COLOR_SPACE_256, i % 256)));
+        }
+        historyScroll->addCellsVector(line);
+        historyScroll->addLine(i % 3 == 0 ? LINE_WRAPPED : LINE_DEFAULT);
+    }
+    QCOMPARE(historyScroll->getLines(), lineCount);
+
+    auto compareLine = [&](int lineNumber) {
+        const QVector<uint> text = lineText(lineNumber);
+        QCOMPARE(historyScroll->getLineLen(lineNumber), text.size());
+        QCOMPARE(historyScroll->isWrappedLine(lineNumber), lineNumber % 3 == 0);
+        QVector<Character> cells(text.size());
+        historyScroll->getCells(lineNumber, 0, text.size(), cells.data());
+        for (int i = 0; i < text.size(); i++) {
+            QCOMPARE(cells[i], Character(text[i], CharacterColor(COLOR_SPACE_256, lineNumber % 256)));
+        }
+    };
+
+    // Read back in an order which does not fit in the block cache
+    for (int i = 0; i < lineCount; i += 7) {
+        compareLine(i);
+    }
+    for (int i = lineCount - 1; i >= 0; i -= 13) {
+        compareLine(i);
+    }
+
+    // Remove lines across a block boundary
+    for (int i = 0; i < lineCount - 500; i++) {
+        historyScroll->removeCells();
+    }
+    QCOMPARE(historyScroll->getLines(), 500);
+    for (int i = 0; i < 500; i++) {
+        compareLine(i);
+    }
+
+    // Reflowing keeps all the text
+    int cellCount = 0;
+    for (int i = 0; i < historyScroll->getLines(); i++) {
+        cellCount += historyScroll->getLineLen(i);
+    }
+    QCOMPARE(historyScroll->reflowLines(5), 0);
+    int reflowedCellCount = 0;
+    for (int i = 0; i < historyScroll->getLines(); i++) {
+        QVERIFY(historyScroll->getLineLen(i) <= 5);
+        reflowedCellCount += historyScroll->getLineLen(i);
+    }
+    QCOMPARE(reflowedCellCount, cellCount);
+}
+
+void HistoryTest::testSearchIndexLiteral()
+{
+    auto literal = [](const QString &pattern, QRegularExpression::PatternOptions options = QRegularExpression::NoPatternOption) {
+        return HistorySearchIndex::requiredLiteral(QRegularExpression(pattern, options));
+    };
+
+    QCOMPARE(literal(QRegularExpression::escape(QStringLiteral("foo.bar(baz)"))), QStringLiteral("foo.bar(baz)"));
+    QCOMPARE(literal(QStringLiteral("^error: .*not found$")), QStringLiteral("not found"));
+    QCOMPARE(literal(QStringLiteral("colou?r value")), QStringLiteral("r value"));
+    QCOMPARE(literal(QStringLiteral("ab+cdef")), QStringLiteral("cdef"));
+    QCOMPARE(literal(QStringLiteral("x{2,3}yz\\d")), QStringLiteral("yz"));
+    QCOMPARE(literal(QStringLiteral("[abc]+defg\\d+")), QStringLiteral("defg"));
+    QCOMPARE(literal(QStringLiteral("(optional)?text")), QStringLiteral("text"));
+    QCOMPARE(literal(QStringLiteral("\\x41bcd")), QStringLiteral("bcd"));
+    QCOMPARE(literal(QStringLiteral("grüße"), QRegularExpression::CaseInsensitiveOption), QStringLiteral("gr"));
+
+    // nothing is required by alternatives or patterns with inline options
+    QCOMPARE(literal(QStringLiteral("foo|bar")), QString());
+    QCOMPARE(literal(QStringLiteral("(?i)foobar")), QString());
+    QCOMPARE(HistorySearchIndex::Filter(QRegularExpression(QStringLiteral("ab"))).isValid(), false);
+
+    // matches which may continue on the next line cannot be filtered by line
+    auto isFiltered = [](const QString &pattern, QRegularExpression::PatternOptions options = QRegularExpression::NoPatternOption) {
+        return HistorySearchIndex::Filter(QRegularExpression(pattern, options)).isValid();
+    };
+    QVERIFY(isFiltered(QStringLiteral("^error: .*not found$")));
+    QVERIFY(isFiltered(QStringLiteral("[abc]+defg\\d+\\S\\w")));
+    QVERIFY(isFiltered(QRegularExpression::escape(QStringLiteral("foo.bar(baz) 1+1"))));
+    QVERIFY(!isFiltered(QStringLiteral("error\\s+foo")));
+    QVERIFY(!isFiltered(QStringLiteral("foo\\nbar")));
+    QVERIFY(!isFiltered(QStringLiteral("foo\nbar")));
+    QVERIFY(!isFiltered(QStringLiteral("foo[^x]bar")));
+    QVERIFY(!isFiltered(QStringLiteral("foo[\\t-z]bar")));
+    QVERIFY(!isFiltered(QStringLiteral("foo[[:space:]]bar")));
+    QVERIFY(!isFiltered(QStringLiteral("foo\\Wbar")));
+    QVERIFY(!isFiltered(QStringLiteral("foo\\x0abar")));
+    QVERIFY(!isFiltered(QStringLiteral("foo.bar"), QRegularExpression::DotMatchesEverythingOption));
+}
+
+void HistoryTest::testSearchIndex()
+{
+    HistorySearchIndex index;
+    auto addLine = [&](const QString &text, bool wrapped = false) {
+        QVector<Character> cells;
+        for (uint c : text.toUcs4()) {
+            cells.append(Character(c));
+        }
+        index.addLine(cells.constData(), cells.size(), wrapped);
+    };
+    auto candidates = [&](const QString &pattern) {
+        return index.candidateLines(HistorySearchIndex::Filter(QRegularExpression(pattern, QRegularExpression::CaseInsensitiveOption)), 0, index.lineCount() - 1);
+    };
+
+    for (int i = 0; i < 1000; i++) {
+        addLine(QStringLiteral("line %1").arg(i));
+    }
+    addLine(QStringLiteral("a long line which wra"), true);
+    addLine(QStringLiteral("ps into the next one"));
+    QCOMPARE(index.lineCount(), 1002);
+
+    QVERIFY(candidates(QStringLiteral("line 123")).contains(123));
+    QVERIFY(candidates(QStringLiteral("LINE 999")).contains(999));
+    QVERIFY(candidates(QStringLiteral("line 123")).size() < 100);
+    QVERIFY(candidates(QStringLiteral("no such text")).size() < 100);
+
+    // a match spanning a wrapped line is found on both of its lines
+    QCOMPARE(candidates(QStringLiteral("which wraps into")), QVector<int>({1000, 1001}));
+
+    // a pattern without a literal matches everywhere
+    QCOMPARE(candidates(QStringLiteral("\\d+")).size(), 1002);
+
+    // dropping lines keeps the newest ones
+    index.keepLastLines(2);
+    QCOMPARE(index.lineCount(), 2);
+    QCOMPARE(candidates(QStringLiteral("which wraps into")), QVector<int>({0, 1}));
+
+    // the line after a removed wrapped line is always a candidate
+    index.removeLastLine();
+    addLine(QStringLiteral("ps into the next one"));
+    QCOMPARE(candidates(QStringLiteral("xyzzy plugh")), QVector<int>({0, 1}));
+
+    index.clear();
+    QCOMPARE(index.lineCount(), 0);
+    QVERIFY(candidates(QStringLiteral("line 123")).isEmpty());
+}
+
+void HistoryTest::testLiteralSearch()
+{
+    auto literal = [](const QString &pattern, QRegularExpression::PatternOptions options = QRegularExpression::NoPatternOption) {
+        return LiteralSearch::literal(QRegularExpression(pattern, options));
+    };
+
+    // what the search bar searches for when regular expressions are off
+    QCOMPARE(literal(QRegularExpression::escape(QStringLiteral("foo.bar(baz) 1+1"))), QStringLiteral("foo.bar(baz) 1+1"));
+    QCOMPARE(literal(QStringLiteral("grüße")), QStringLiteral("grüße"));
+    QCOMPARE(literal(QStringLiteral("grüße"), QRegularExpression::CaseInsensitiveOption), QString());
+    QCOMPARE(literal(QStringLiteral("foo.bar")), QString());
+    QCOMPARE(literal(QStringLiteral("foo\\d")), QString());
+    QCOMPARE(literal(QStringLiteral("(?i)foo")), QString());
+    QCOMPARE(literal(QStringLiteral("foo bar"), QRegularExpression::ExtendedPatternSyntaxOption), QString());
+
+    auto appendLine = [](LiteralSearch &search, const QString &text) {
+        QVector<Character> cells;
+        for (uint c : text.toUcs4()) {
+            cells.append(Character(c));
+        }
+        search.appendLine(cells.constData(), cells.size());
+        search.appendLineBreak();
+    };
+
+    LiteralSearch search(QRegularExpression(QRegularExpression::escape(QStringLiteral("line 1"))));
+    QVERIFY(search.isValid());
+    for (int i = 0; i < 20; i++) {
+        appendLine(search, QStringLiteral("line %1").arg(i));
+    }
+    QCOMPARE(search.indexIn(), 7);
+    QCOMPARE(search.lastIndexIn(), 142);
+    search.clear();
+    QCOMPARE(search.indexIn(), -1);
+    appendLine(search, QStringLiteral("lin"));
+    QCOMPARE(search.indexIn(), -1);
+
+    LiteralSearch caseInsensitive(QRegularExpression(QStringLiteral("ERROR"), QRegularExpression::CaseInsensitiveOption));
+    appendLine(caseInsensitive, QStringLiteral("no errors, but an Error"));
+    QCOMPARE(caseInsensitive.indexIn(), 3);
+    QCOMPARE(caseInsensitive.lastIndexIn(), 18);
+
+    QVERIFY(!LiteralSearch(QRegularExpression(QStringLiteral("line \\d+"))).isValid());
+
+    // place holders are only part of the text before the last real character,
+    // which is not a new-line, as in the text the PlainTextDecoder produces
+    const Character cells[] = {Character('a'),
+                               Character(' ', CharacterColor(), CharacterColor(), DEFAULT_RENDITION, false),
+                               Character('b'),
+                               Character('y', CharacterColor(), CharacterColor(), DEFAULT_RENDITION, false),
+                               Character('\n')};
+    QString decoded;
+    QTextStream stream(&decoded);
+    PlainTextDecoder decoder;
+    decoder.begin(&stream);
+    decoder.decodeLine(cells, 5, LINE_DEFAULT);
+    decoder.end();
+    stream.flush();
+    QCOMPARE(decoded, QStringLiteral("a b\n"));
+
+    LiteralSearch placeHolders(QRegularExpression(QStringLiteral("a b")));
+    placeHolders.appendLine(cells, 5);
+    QCOMPARE(placeHolders.textLength(), decoded.size());
+    QCOMPARE(placeHolders.indexIn(), 0);
+}
+
 QTEST_MAIN(HistoryTest)
@@ -12,10 +12,14 @@
 #include "../characters/Character.h"
 #include "../history/HistoryScrollFile.h"
 #include "../history/HistoryScrollNone.h"
+#include "../history/HistorySearchIndex.h"
 #include "../history/HistoryTypeFile.h"
 #include "../history/HistoryTypeNone.h"
+#include "../history/LiteralSearch.h"
 #include "../history/compact/CompactHistoryScroll.h"
 #include "../history/compact/CompactHistoryType.h"
+#include "../history/compressed/CompressedHistoryScroll.h"
+#include "../history/compressed/CompressedHistoryType.h"
 
 namespace Konsole
 {
@@ -29,10 +33,19 @@ private Q_SLOTS:
     void testHistoryNone();
     void testHistoryFile();
     void testCompactHistory();
+    void testCompactHistoryWrap();
     void testEmulationHistory();
     void testHistoryScroll();
     void testHistoryReflow();
     void testHistoryTypeChange();
+    void testHistoryAttributes();
+    void testAttributeTableLimits();
+    void testHistoryFileSegments();
+    void testCompressedHistory();
+    void testCompressedHistoryColors();
+    void testSearchIndexLiteral();
+    void testSearchIndex();
+    void testLiteralSearch();
 
 private:
     static constexpr const char testString[] = "abcdefghijklmnopqrstuvwxyz1234567890";
@@ -7,6 +7,12 @@
 #include "HotSpotFilterTest.h"
 #include <QTest>
 
+#include "../Screen.h"
+#include "../filterHotSpots/TerminalImageFilterChain.h"
+#include "../history/compact/CompactHistoryType.h"
+
+using namespace Konsole;
+
 QTEST_GUILESS_MAIN(HotSpotFilterTest)
 
 void HotSpotFilterTest::testUrlFilterRegex_data()
@@ -80,3 +86,57 @@ void HotSpotFilterTest::testUrlFilterRegex()
         QCOMPARE(match.capturedView(0), expectedUrl);
     }
 }
+
+void HotSpotFilterTest::testIncrementalProcessing()
+{
+    Screen screen(4, 40);
+    screen.setScroll(CompactHistoryType(10));
+
+    const auto writeLine = [&screen](const QString &text) {
+        for (const QChar &c : text) {
+            screen.displayCharacter(c.unicode());
+        }
+        screen.nextLine();
+    };
+
+    writeLine(QStringLiteral("https://kde.org/1"));
+    writeLine(QStringLiteral("no link"));
+    writeLine(QStringLiteral("https://kde.org/2"));
+
+    TerminalImageFilterChain filterChain(nullptr);
+    filterChain.addFilter(new UrlFilter());
+
+    filterChain.setImage(&screen, 0, screen.getLines());
+    filterChain.process();
+
+    const QList<QSharedPointer<HotSpot>> hotSpots = filterChain.hotSpots();
+    QCOMPARE(hotSpots.size(), 2);
+    QCOMPARE(hotSpots[0]->startLine(), 0);
+    QCOMPARE(hotSpots[1]->startLine(), 2);
+
+    // the first line scrolls out of the image, the hotspot of the third
+    // line is kept and moved up, and the new line is processed
+    writeLine(QStringLiteral("https://kde.org/3"));
+    QCOMPARE(screen.getHistLines(), 1);
+
+    filterChain.setImage(&screen, screen.getHistLines(), screen.getLines());
+    filterChain.process();
+
+    const QList<QSharedPointer<HotSpot>> scrolledHotSpots = filterChain.hotSpots();
+    QCOMPARE(scrolledHotSpots.size(), 2);
+    QCOMPARE(scrolledHotSpots[0], hotSpots[1]);
+    QCOMPARE(scrolledHotSpots[0]->startLine(), 1);
+    QCOMPARE(scrolledHotSpots[0]->endLine(), 1);
+    QCOMPARE(scrolledHotSpots[1]->startLine(), 2);
+    QCOMPARE(scrolledHotSpots[1]->startColumn(), 0);
+    QCOMPARE(scrolledHotSpots[1]->endColumn(), 17);
+
+    // a changed line is processed again
+    screen.setCursorYX(3, 1);
+    screen.clearEntireLine();
+    filterChain.setImage(&screen, screen.getHistLines(), screen.getLines());
+    filterChain.process();
+
+    QCOMPARE(filterChain.hotSpots().size(), 1);
+    QCOMPARE(filterChain.hotSpots()[0], hotSpots[1]);
+}
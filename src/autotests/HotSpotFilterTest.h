@@ -16,6 +16,8 @@ class HotSpotFilterTest : public QObject
 private Q_SLOTS:
     void testUrlFilterRegex_data();
     void testUrlFilterRegex();
+
+    void testIncrementalProcessing();
 };
 
 #endif // HOTSPOTFILTERTEST_H
@@ -0,0 +1,105 @@
+/*
+    SPDX-FileCopyrightText: 2022 Konsole Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+// Own
+#include "RenderSchedulerTest.h"
+
+// Qt
+#include <QSignalSpy>
+
+#include "qtest.h"
+
+// Konsole
+#include "../RenderScheduler.h"
+#include "../Vt102Emulation.h"
+
+using namespace Konsole;
+
+void RenderSchedulerTest::testCoalescedUpdates()
+{
+    RenderScheduler *scheduler = RenderScheduler::instance();
+    Vt102Emulation first;
+    Vt102Emulation second;
+    QSignalSpy firstSpy(&first, &Emulation::outputChanged);
+    QSignalSpy secondSpy(&second, &Emulation::outputChanged);
+
+    // input received in the same frame results in a single update per
+    // emulation, and both emulations are updated in the same frame
+    scheduler->resetStatistics();
+    for (int i = 0; i < 10; ++i) {
+        first.receiveData("abc", 3);
+        second.receiveData("abc", 3);
+    }
+    QCOMPARE(firstSpy.count(), 0);
+
+    QTRY_COMPARE(firstSpy.count(), 1);
+    QCOMPARE(secondSpy.count(), 1);
+    QCOMPARE(scheduler->statistics().frames, 1);
+    QCOMPARE(scheduler->statistics().updates, 2);
+    QVERIFY(scheduler->summary().startsWith(QLatin1String("scheduler: 1 frames, 2 updates, 0 deferred")));
+
+    // no more updates without new input
+    QTest::qWait(5 * scheduler->frameInterval());
+    QCOMPARE(firstSpy.count(), 1);
+}
+
+void RenderSchedulerTest::testThroughputMode()
+{
+    RenderScheduler *scheduler = RenderScheduler::instance();
+    Vt102Emulation emulation;
+    QSignalSpy spy(&emulation, &Emulation::outputChanged);
+    const QByteArray input(RenderScheduler::ThroughputModeBytes + 1, 'x');
+
+    // the update is deferred for the frame which received too much input,
+    // and sent in the next frame, as the input stopped
+    scheduler->resetStatistics();
+    emulation.receiveData(input.constData(), input.size());
+    QTRY_COMPARE(spy.count(), 1);
+    QCOMPARE(scheduler->statistics().deferredUpdates, 1);
+    QCOMPARE(scheduler->statistics().frames, 1);
+    QVERIFY(!scheduler->isInThroughputMode(&emulation));
+}
+
+void RenderSchedulerTest::testOutputBacklog()
+{
+    Vt102Emulation emulation;
+    QSignalSpy backlogSpy(&emulation, &Emulation::outputBackloggedChanged);
+    QSignalSpy changedSpy(&emulation, &Emulation::outputChanged);
+    QSignalSpy skippedSpy(&emulation, &Emulation::outputSkipped);
+    const QByteArray chunk(4096, 'x');
+
+    // a few large chunks are just a burst of output
+    for (int i = 0; i < 4; ++i) {
+        emulation.receiveData(chunk.constData(), chunk.size());
+    }
+    QVERIFY(!emulation.isOutputBacklogged());
+    QTRY_COMPARE(changedSpy.count(), 1);
+
+    // a sustained stream of them skips the updates until it stops,
+    // and is then displayed once
+    changedSpy.clear();
+    for (int i = 0; i < 64; ++i) {
+        emulation.receiveData(chunk.constData(), chunk.size());
+    }
+    QVERIFY(emulation.isOutputBacklogged());
+    QCOMPARE(backlogSpy.count(), 1);
+
+    QTRY_COMPARE(changedSpy.count(), 1);
+    QCOMPARE(skippedSpy.count(), 1);
+    QVERIFY(!emulation.isOutputBacklogged());
+    QCOMPARE(backlogSpy.count(), 2);
+    QCOMPARE(backlogSpy.at(1).at(0).toBool(), false);
+
+    // a small chunk ends the backlog right away
+    for (int i = 0; i < 64; ++i) {
+        emulation.receiveData(chunk.constData(), chunk.size());
+    }
+    QVERIFY(emulation.isOutputBacklogged());
+    emulation.receiveData("x", 1);
+    QVERIFY(!emulation.isOutputBacklogged());
+}
+
+QTEST_GUILESS_MAIN(RenderSchedulerTest)
@@ -0,0 +1,26 @@
+/*
+    SPDX-FileCopyrightText: 2022 Konsole Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef RENDERSCHEDULERTEST_H
+#define RENDERSCHEDULERTEST_H
+
+#include <QObject>
+
+namespace Konsole
+{
+class RenderSchedulerTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testCoalescedUpdates();
+    void testThroughputMode();
+    void testOutputBacklog();
+};
+
+}
+
+#endif // RENDERSCHEDULERTEST_H
@@ -13,6 +13,9 @@
 // KDE
 #include <qtest.h>
 
+// Konsole
+#include "../history/compact/CompactHistoryType.h"
+
 using namespace Konsole;
 
 void ScreenTest::doLargeScreenCopyVerification(const QString &putToScreen, const QString &expectedSelection)
@@ -191,4 +194,111 @@ void ScreenTest::testCursorPosition()
     delete screen;
 }
 
+// displayRun() must leave the screen in the same state as displaying
+// the characters one by one
+void ScreenTest::testDisplayRun()
+{
+    const int lines = 4;
+    const int columns = 10;
+    Screen bulkScreen(lines, columns);
+    Screen singleScreen(lines, columns);
+
+    // Plain text wrapping at the right margin, a double width character
+    // which has to wrap early and a combining accent
+    const QVector<uint> input = QStringLiteral("0123456789abcdefghi\u4e2dxe\u0301z").toUcs4();
+
+    bulkScreen.displayRun(input.constData(), input.size());
+    for (uint c : input) {
+        singleScreen.displayCharacter(c);
+    }
+
+    QCOMPARE(bulkScreen.text(0, lines * columns - 1, Screen::PreserveLineBreaks),
+             singleScreen.text(0, lines * columns - 1, Screen::PreserveLineBreaks));
+    doComparePosition(&bulkScreen, singleScreen.getCursorY(), singleScreen.getCursorX());
+}
+
+void ScreenTest::testDirtyLines()
+{
+    const int lines = 4;
+    const int columns = 10;
+    Screen screen(lines, columns);
+
+    // a new screen has to be drawn entirely
+    QCOMPARE(screen.dirtyLines(), QBitArray(lines, true));
+
+    screen.resetDirtyLines();
+    QCOMPARE(screen.dirtyLines(), QBitArray(lines, false));
+
+    screen.setCursorYX(2, 1);
+    screen.displayCharacter('a');
+    QBitArray expected(lines, false);
+    expected.setBit(1);
+    QCOMPARE(screen.dirtyLines(), expected);
+
+    screen.setCursorYX(4, 1);
+    screen.clearEntireLine();
+    expected.setBit(3);
+    QCOMPARE(screen.dirtyLines(), expected);
+
+    // scrolling moves every line of the scroll region
+    screen.resetDirtyLines();
+    screen.setMargins(2, 3);
+    screen.scrollUp(1);
+    QVERIFY(!screen.dirtyLines().testBit(0));
+    QVERIFY(screen.dirtyLines().testBit(1));
+    QVERIFY(screen.dirtyLines().testBit(2));
+
+    // the cursor is marked when copying a single line of the image
+    QVector<Character> image(columns);
+    screen.setMargins(1, lines);
+    screen.setCursorYX(3, 5);
+    screen.getImage(image.data(), columns, 1, 1);
+    QVERIFY(!(image.at(4).rendition & RE_CURSOR));
+    screen.getImage(image.data(), columns, 2, 2);
+    QVERIFY(image.at(4).rendition & RE_CURSOR);
+}
+
+void ScreenTest::testLineView()
+{
+    const int lines = 2;
+    const int columns = 10;
+    Screen screen(lines, columns);
+    screen.setScroll(CompactHistoryType(2), false);
+
+    const auto writeLine = [&screen](char c) {
+        screen.nextLine();
+        screen.displayCharacter(c);
+    };
+
+    // history: a, screen: b c
+    screen.displayCharacter('a');
+    writeLine('b');
+    writeLine('c');
+    QCOMPARE(screen.getHistLines(), 1);
+
+    Screen::LineView view = screen.getLineView(0);
+    QVERIFY(view.length >= 1 && view.length <= columns);
+    QCOMPARE(view.cells[0].character, uint('a'));
+    view = screen.getLineView(2);
+    QCOMPARE(view.cells[0].character, uint('c'));
+
+    // the full history drops 'a', which must not be read from the cache
+    // of decoded history lines anymore
+    writeLine('d');
+    writeLine('e');
+    QCOMPARE(screen.getHistLines(), 2);
+    QCOMPARE(screen.getLineView(0).cells[0].character, uint('b'));
+    QCOMPARE(screen.getLineView(1).cells[0].character, uint('c'));
+    QCOMPARE(screen.getLineView(3).cells[0].character, uint('e'));
+
+    // the view has the same characters as the image, without the cursor
+    QVector<Character> image(columns);
+    screen.toStartOfLine();
+    screen.getImage(image.data(), columns, 3, 3);
+    view = screen.getLineView(3);
+    QVERIFY(image.at(0).rendition & RE_CURSOR);
+    QVERIFY(!(view.cells[0].rendition & RE_CURSOR));
+    QCOMPARE(image.at(0).character, view.cells[0].character);
+}
+
 QTEST_GUILESS_MAIN(ScreenTest)
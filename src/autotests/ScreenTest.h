@@ -23,6 +23,9 @@ private Q_SLOTS:
     void testLargeScreenCopyLongLine();
     void testBlockSelection();
     void testCursorPosition();
+    void testDisplayRun();
+    void testDirtyLines();
+    void testLineView();
 
 private:
     void doLargeScreenCopyVerification(const QString &putToScreen, const QString &expectedSelection);
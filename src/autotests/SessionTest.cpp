@@ -8,9 +8,12 @@
 #include "SessionTest.h"
 
 #include "qtest.h"
+#include <QSignalSpy>
 
 // Konsole
 #include "../Emulation.h"
+#include "../SearchHistoryTask.h"
+#include "../SearchMatches.h"
 #include "../session/Session.h"
 
 using namespace Konsole;
@@ -42,4 +45,158 @@ void SessionTest::testEmulation()
     delete session;
 }
 
+static void writeLines(Emulation *emulation, int count)
+{
+    for (int i = 0; i < count; i++) {
+        const QByteArray line = "line " + QByteArray::number(i) + "\r\n";
+        emulation->receiveData(line.constData(), line.size());
+    }
+}
+
+// Returns a session with lines "line 0" to "line 4999", of which most are
+// in the history, and a window on them in @p window
+static Session *createSessionWithLines(ScreenWindow *&window)
+{
+    auto session = new Session();
+    session->setHistorySize(10000);
+    writeLines(session->emulation(), 5000);
+    window = session->emulation()->createWindow();
+    return session;
+}
+
+void SessionTest::testSearchHistory()
+{
+    ScreenWindow *window = nullptr;
+    Session *session = createSessionWithLines(window);
+
+    // the history is searched in several blocks, in the background
+    auto task = new SearchHistoryTask();
+    QSignalSpy completedSpy(task, &SessionTask::completed);
+    QSignalSpy progressSpy(task, &SearchHistoryTask::progress);
+    task->setRegExp(QRegularExpression(QStringLiteral("line 4321(?!\\d)")));
+    task->setSearchDirection(Enum::ForwardsSearch);
+    task->setStartLine(0);
+    task->addScreenWindow(session, window);
+    task->execute();
+    QCOMPARE(completedSpy.count(), 0);
+
+    QVERIFY(completedSpy.wait());
+    QCOMPARE(completedSpy.first().first().toBool(), true);
+    QCOMPARE(window->currentResultLine(), 4321);
+    QVERIFY(progressSpy.count() > 0);
+
+    // searching backwards from the match finds nothing before it but wraps around
+    task->setSearchDirection(Enum::BackwardsSearch);
+    task->setStartLine(4321);
+    task->setRegExp(QRegularExpression(QStringLiteral("line 4999(?!\\d)")));
+    task->addScreenWindow(session, window);
+    completedSpy.clear();
+    task->execute();
+    QVERIFY(completedSpy.wait());
+    QCOMPARE(completedSpy.first().first().toBool(), true);
+    QCOMPARE(window->currentResultLine(), 4999);
+
+    // executing the task again while it searches starts a new search
+    task->setSearchDirection(Enum::ForwardsSearch);
+    task->setStartLine(0);
+    task->setRegExp(QRegularExpression(QStringLiteral("no such line")));
+    task->addScreenWindow(session, window);
+    completedSpy.clear();
+    task->execute();
+    task->setRegExp(QRegularExpression(QStringLiteral("line 1234(?!\\d)")));
+    task->addScreenWindow(session, window);
+    task->execute();
+    QVERIFY(completedSpy.wait());
+    QCOMPARE(completedSpy.count(), 1);
+    QCOMPARE(completedSpy.first().first().toBool(), true);
+    QCOMPARE(window->currentResultLine(), 1234);
+
+    delete task;
+    delete session;
+}
+
+void SessionTest::testSearchIndexedHistory()
+{
+    ScreenWindow *window = nullptr;
+    Session *session = createSessionWithLines(window);
+
+    // a literal is looked up in the history search index, and only the
+    // candidate lines are read
+    auto task = new SearchHistoryTask();
+    QSignalSpy completedSpy(task, &SessionTask::completed);
+    task->setRegExp(QRegularExpression(QRegularExpression::escape(QStringLiteral("line 4321"))));
+    task->setSearchDirection(Enum::ForwardsSearch);
+    task->setStartLine(0);
+    task->addScreenWindow(session, window);
+    task->execute();
+    QVERIFY(completedSpy.wait());
+    QCOMPARE(completedSpy.first().first().toBool(), true);
+    QCOMPARE(window->currentResultLine(), 4321);
+
+    // lines on the screen are not indexed, but searched as well
+    task->setSearchDirection(Enum::BackwardsSearch);
+    task->setStartLine(4321);
+    task->setRegExp(QRegularExpression(QStringLiteral("line 4999")));
+    task->addScreenWindow(session, window);
+    completedSpy.clear();
+    task->execute();
+    QVERIFY(completedSpy.wait());
+    QCOMPARE(completedSpy.first().first().toBool(), true);
+    QCOMPARE(window->currentResultLine(), 4999);
+
+    delete task;
+    delete session;
+}
+
+void SessionTest::testSearchMatches()
+{
+    ScreenWindow *window = nullptr;
+    Session *session = createSessionWithLines(window);
+
+    // line 42, lines 420 to 429 and lines 4200 to 4299
+    auto matches = new SearchMatches(window);
+    matches->setRegExp(QRegularExpression(QStringLiteral("line 42")));
+    QTRY_VERIFY(matches->isComplete());
+    QCOMPARE(matches->count(), 111);
+
+    const QVector<SearchMatches::Match> lineMatches = matches->matches(42, 42);
+    QCOMPARE(lineMatches.size(), 1);
+    QCOMPARE(lineMatches.first().line, 42);
+    QCOMPARE(lineMatches.first().startColumn, 0);
+    QCOMPARE(lineMatches.first().endColumn, 7);
+    QVERIFY(matches->hasMatches(0, 42));
+    QVERIFY(!matches->hasMatches(43, 419));
+    QVERIFY(matches->hasMatches(429, 4200));
+    QVERIFY(!matches->hasMatches(4300, 4999));
+
+    // only the new output is searched
+    const QByteArray line("line 42 again\r\n");
+    session->emulation()->receiveData(line.constData(), line.size());
+    QTRY_COMPARE(matches->count(), 112);
+    QTRY_VERIFY(matches->isComplete());
+    QCOMPARE(matches->count(), 112);
+
+    delete matches;
+    delete session;
+}
+
+void SessionTest::testCancelSearchHistory()
+{
+    ScreenWindow *window = nullptr;
+    Session *session = createSessionWithLines(window);
+
+    auto task = new SearchHistoryTask();
+    QSignalSpy completedSpy(task, &SessionTask::completed);
+    task->setRegExp(QRegularExpression(QStringLiteral("no such line")));
+    task->setSearchDirection(Enum::ForwardsSearch);
+    task->addScreenWindow(session, window);
+    task->execute();
+    task->cancel();
+
+    QVERIFY(!completedSpy.wait(500));
+
+    delete task;
+    delete session;
+}
+
 QTEST_MAIN(SessionTest)
@@ -18,6 +18,10 @@ class SessionTest : public QObject
 private Q_SLOTS:
     void testNoProfile();
     void testEmulation();
+    void testSearchHistory();
+    void testSearchIndexedHistory();
+    void testSearchMatches();
+    void testCancelSearchHistory();
 
 private:
 };
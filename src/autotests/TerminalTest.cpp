@@ -10,6 +10,7 @@
 #include "qtest.h"
 
 // Konsole
+#include "../terminalDisplay/RenderStatistics.h"
 #include "../terminalDisplay/TerminalColor.h"
 #include "../terminalDisplay/TerminalDisplay.h"
 #include "../terminalDisplay/TerminalScrollBar.h"
@@ -72,4 +73,30 @@ void TerminalTest::testSize()
     delete display;
 }
 
+void TerminalTest::testRenderStatistics()
+{
+    RenderStatistics statistics;
+    QCOMPARE(statistics.frames().size(), 0);
+    QCOMPARE(statistics.lastFrame().totalTime(), qint64(0));
+
+    // only the last HistorySize frames are kept, oldest first
+    const int frameCount = RenderStatistics::HistorySize + 10;
+    for (int i = 0; i < frameCount; i++) {
+        statistics.currentFrame().dirtyLines = i;
+        statistics.currentFrame().paintTime = 1000000;
+        statistics.finishFrame();
+    }
+    QCOMPARE(statistics.currentFrame().dirtyLines, 0);
+
+    const QVector<RenderStatistics::Frame> frames = statistics.frames();
+    QCOMPARE(frames.size(), RenderStatistics::HistorySize);
+    QCOMPARE(frames.first().dirtyLines, frameCount - RenderStatistics::HistorySize);
+    QCOMPARE(frames.last().dirtyLines, frameCount - 1);
+    QCOMPARE(statistics.lastFrame().dirtyLines, frameCount - 1);
+    QVERIFY(statistics.summary().contains(QLatin1String("average 1.00 ms")));
+
+    statistics.clear();
+    QCOMPARE(statistics.frames().size(), 0);
+}
+
 QTEST_MAIN(TerminalTest)
@@ -19,6 +19,7 @@ private Q_SLOTS:
     void testScrollBarPositions();
     void testColorTable();
     void testSize();
+    void testRenderStatistics();
 
 private:
 };
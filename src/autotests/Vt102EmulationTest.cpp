@@ -113,6 +113,21 @@ void Vt102EmulationTest::testParse()
     sendAndCompare(&em, tertiaryDeviceAttributes, sizeof tertiaryDeviceAttributes, QStringLiteral(""), "\033P!|00000000\033\\");
 }
 
+void Vt102EmulationTest::testReceiveSplitUtf8()
+{
+    TestEmulation em;
+    em.setCodec(TestEmulation::Utf8Codec);
+    em._currentScreen->clearEntireScreen();
+
+    // U+4E2D split across two reads, followed by an invalid byte
+    em.receiveData("a\xe4\xb8", 3);
+    em.receiveData("\xad\xff" "b", 3);
+
+    QString printed = em._currentScreen->text(0, em._currentScreen->getColumns(), Screen::PlainText);
+    printed.chop(2); // Remove trailing space and newline
+    QCOMPARE(printed, QStringLiteral("a\u4e2d\ufffdb"));
+}
+
 Q_DECLARE_METATYPE(std::vector<TestEmulation::Item>)
 
 struct ItemToString {
@@ -280,6 +295,12 @@ void Vt102EmulationTest::testTokenizing_data()
     QTest::newRow("ESC [!p") << C{ESC, '[', '!', 'p'} << I{ProcessToken{token_csi_pe('p'), 0, 0}};
     QTest::newRow("ESC [=c") << C{ESC, '[', '=', 'p'} << I{ProcessToken{token_csi_pq('p'), 0, 0}};
     QTest::newRow("ESC [>c") << C{ESC, '[', '>', 'p'} << I{ProcessToken{token_csi_pg('p'), 0, 0}};
+
+    QTest::newRow("CSI 1m")    << C{ESC + 128, '1', 'm'} << I{ProcessToken{token_csi_ps('m', 1), 0, 0}};
+    QTest::newRow("ESC [1 LF m") << C{ESC, '[', '1', '\n', 'm'} << I{ProcessToken{token_ctl('J'), 0, 0}, ProcessToken{token_csi_ps('m', 1), 0, 0}};
+    QTest::newRow("ESC [1 CAN m") << C{ESC, '[', '1', 'X' - '@'} << I{ProcessToken{token_ctl('X'), 0, 0}};
+    QTest::newRow("ESC [1 ESC 7") << C{ESC, '[', '1', ESC, '7'} << I{ProcessToken{token_esc('7'), 0, 0}};
+    QTest::newRow("ESC [?1$p") << C{ESC, '[', '?', '1', '$', 'p'} << I{ProcessToken{token_csi_pr('p', 1), 0, 0}};
     /* clang-format on */
 }
 
@@ -389,6 +410,40 @@ void Vt102EmulationTest::testTokenizingVT52()
     QCOMPARE(em.items, expectedItems);
 }
 
+void Vt102EmulationTest::testSixelAbort_data()
+{
+    QTest::addColumn<QVector<uint>>("input");
+    QTest::addColumn<std::vector<TestEmulation::Item>>("expectedItems");
+
+    using ProcessToken = TestEmulation::ProcessToken;
+
+    using C = QVector<uint>;
+    using I = std::vector<TestEmulation::Item>;
+
+    // an escape sequence before the first sixel aborts the image, and is
+    // then processed as usual
+    /* clang-format off */
+    QTest::newRow("ESC P q ESC [ m")   << C{ESC, 'P', 'q', ESC, '[', 'm'}      << I{ProcessToken{token_csi_ps('m', 0), 0, 0}};
+    QTest::newRow("ESC P q ESC [ 0 m") << C{ESC, 'P', 'q', ESC, '[', '0', 'm'} << I{ProcessToken{token_csi_ps('m', 0), 0, 0}};
+    QTest::newRow("ESC P q ESC x")     << C{ESC, 'P', 'q', ESC, 'x'}           << I{ProcessToken{token_esc('x'), 0, 0}};
+    /* clang-format on */
+}
+
+void Vt102EmulationTest::testSixelAbort()
+{
+    QFETCH(QVector<uint>, input);
+    QFETCH(std::vector<TestEmulation::Item>, expectedItems);
+
+    TestEmulation em;
+    em.reset();
+    em.blockFurtherProcessing = true;
+
+    em.receiveChars(input);
+
+    QVERIFY(!em.getMode(MODE_Sixel));
+    QCOMPARE(em.items, expectedItems);
+}
+
 void Vt102EmulationTest::testTokenFunctions()
 {
     QCOMPARE(token_construct(0, 0, 0), TY_CONSTRUCT(0, 0, 0));
@@ -26,12 +26,16 @@ private Q_SLOTS:
     void testTokenFunctions();
 
     void testParse();
+    void testReceiveSplitUtf8();
     void testTokenizing_data();
     void testTokenizing();
 
     void testTokenizingVT52_data();
     void testTokenizingVT52();
 
+    void testSixelAbort_data();
+    void testSixelAbort();
+
 private:
     static void sendAndCompare(TestEmulation *em, const char *input, size_t inputLen, const QString &expectedPrint, const QByteArray &expectedSent);
 };
@@ -197,6 +197,11 @@ public:
         return !operator==(a, b);
     }
 
+    friend constexpr uint qHash(const CharacterColor color, uint seed = 0)
+    {
+        return ((uint(color._colorSpace) << 24) | (uint(color._u) << 16) | (uint(color._v) << 8) | uint(color._w)) ^ seed;
+    }
+
 private:
     quint8 _colorSpace;
 
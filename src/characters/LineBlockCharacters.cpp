@@ -11,7 +11,11 @@
 #include "LineBlockCharacters.h"
 
 // Qt
+#include <QCache>
+#include <QCoreApplication>
 #include <QPainterPath>
+#include <QPixmap>
+#include <QtMath>
 
 namespace Konsole
 {
@@ -818,7 +822,7 @@ static inline bool drawLegacyCharacter(QPainter &paint, int x, int y, int w, int
     return false;
 }
 
-void draw(QPainter &paint, const QRect &cellRect, const uint &chr, bool bold)
+static void drawCharacter(QPainter &paint, const QRect &cellRect, const uint &chr, bool bold)
 {
     static const ushort FirstBoxDrawingCharacterCodePoint = 0x2500;
     static const uint FirstLegacyCharacterCodePoint = 0x1fb00;
@@ -844,5 +848,80 @@ void draw(QPainter &paint, const QRect &cellRect, const uint &chr, bool bold)
         || drawBlockCharacter(paint, x, y, w, h, code, bold);
 }
 
+// Everything a tile's pixels depend on
+struct TileKey {
+    uint character;
+    QSize cellSize;
+    QRgb color;
+    bool bold;
+    bool antialias;
+    int devicePixelRatio;
+
+    friend bool operator==(const TileKey &a, const TileKey &b)
+    {
+        return a.character == b.character && a.cellSize == b.cellSize && a.color == b.color && a.bold == b.bold && a.antialias == b.antialias
+            && a.devicePixelRatio == b.devicePixelRatio;
+    }
+
+    friend uint qHash(const TileKey &key, uint seed = 0)
+    {
+        return qHash(key.character, seed) ^ (key.cellSize.width() << 24) ^ (key.cellSize.height() << 16) ^ key.color
+            ^ (key.bold << 1 | key.antialias) ^ (key.devicePixelRatio << 8);
+    }
+};
+
+// The cost of a tile is its number of pixels; allow about 16 MiB of tiles
+static const int TileCacheMaxCost = 4 * 1024 * 1024;
+
+using TileCache = QCache<TileKey, QPixmap>;
+Q_GLOBAL_STATIC_WITH_ARGS(TileCache, tileCache, (TileCacheMaxCost))
+
+void draw(QPainter &paint, const QRect &cellRect, const uint &chr, bool bold)
+{
+    // Tiles are copied pixel for pixel, which only works when the painter
+    // maps cells straight onto whole device pixels
+    const qreal devicePixelRatio = paint.device() != nullptr ? paint.device()->devicePixelRatioF() : 1.0;
+    if (!paint.transform().isIdentity() || devicePixelRatio != qFloor(devicePixelRatio) || cellRect.isEmpty()) {
+        drawCharacter(paint, cellRect, chr, bold);
+        return;
+    }
+
+    const TileKey key{chr, cellRect.size(), paint.pen().color().rgba(), bold, paint.testRenderHint(QPainter::Antialiasing), int(devicePixelRatio)};
+
+    // Pixmaps must not outlive the QGuiApplication, while the global cache
+    // is only destroyed at exit; drop the tiles along with the application
+    static const bool postRoutineAdded = (qAddPostRoutine(clearCache), true);
+    Q_UNUSED(postRoutineAdded)
+
+    QPixmap *tile = tileCache->object(key);
+    if (tile == nullptr) {
+        tile = new QPixmap(cellRect.size() * key.devicePixelRatio);
+        tile->setDevicePixelRatio(key.devicePixelRatio);
+        tile->fill(Qt::transparent);
+
+        QPainter tilePainter(tile);
+        tilePainter.setPen(paint.pen());
+        tilePainter.setRenderHint(QPainter::Antialiasing, key.antialias);
+        drawCharacter(tilePainter, QRect(QPoint(0, 0), cellRect.size()), chr, bold);
+        tilePainter.end();
+
+        const int cost = tile->width() * tile->height();
+        if (!tileCache->insert(key, tile, cost)) {
+            // QCache deletes the tile right away if it is larger than the cache
+            drawCharacter(paint, cellRect, chr, bold);
+            return;
+        }
+    }
+
+    paint.drawPixmap(cellRect.topLeft(), *tile);
+}
+
+void clearCache()
+{
+    if (tileCache.exists()) {
+        tileCache->clear();
+    }
+}
+
 } // namespace LineBlockCharacters
 } // namespace Konsole
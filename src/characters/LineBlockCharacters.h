@@ -40,6 +40,9 @@ inline static bool isLegacyComputingSymbol(uint ucs4cp)
 /**
  * Draws character.
  *
+ * The character is rendered once for each cell size, color and weight into
+ * a cached tile, which is then copied to @p paint.
+ *
  * @param paint QPainter to draw on
  * @param cellRect Rectangle to draw in
  * @param chr Character to be drawn
@@ -47,6 +50,11 @@ inline static bool isLegacyComputingSymbol(uint ucs4cp)
  */
 void draw(QPainter &paint, const QRect &cellRect, const uint &chr, bool bold);
 
+/**
+ * Drops the cached tiles used by draw(), e.g. after the cell size changed.
+ */
+void clearCache();
+
 } // namespace LineBlockCharacters
 } // namespace Konsole
 
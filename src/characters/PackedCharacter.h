@@ -0,0 +1,229 @@
+/*
+    SPDX-FileCopyrightText: 2022 Konsole Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef PACKEDCHARACTER_H
+#define PACKEDCHARACTER_H
+
+// Konsole
+#include "Character.h"
+
+// Qt
+#include <QHash>
+#include <QVector>
+
+namespace Konsole
+{
+/**
+ * The colors and rendition of a Character, without its character value.
+ */
+struct CharacterAttributes {
+    RenditionFlags rendition;
+    CharacterColor foregroundColor;
+    CharacterColor backgroundColor;
+
+    friend constexpr bool operator==(const CharacterAttributes &a, const CharacterAttributes &b)
+    {
+        return a.rendition == b.rendition && a.foregroundColor == b.foregroundColor && a.backgroundColor == b.backgroundColor;
+    }
+
+    friend constexpr bool operator!=(const CharacterAttributes &a, const CharacterAttributes &b)
+    {
+        return !operator==(a, b);
+    }
+
+    friend constexpr uint qHash(const CharacterAttributes &attributes, uint seed = 0)
+    {
+        return (qHash(attributes.foregroundColor) * 31 + qHash(attributes.backgroundColor)) * 31 + attributes.rendition + seed;
+    }
+};
+
+/**
+ * Interns the distinct attributes used by a set of characters, so that every
+ * cell only has to store a small index into the table instead of its colors
+ * and rendition.
+ *
+ * Entries are only removed by clear() and compact(), so the table lives as
+ * long as the cells which refer to it; clear() it together with them, or
+ * compact() it once cells were dropped.
+ *
+ * Once the table holds MAX_SIZE entries, new attributes are stored without
+ * their colors, so that it cannot grow without bound even if the cells are
+ * never dropped.
+ */
+class CharacterAttributeTable
+{
+public:
+    /** The number of entries after which new attributes lose their colors */
+    static constexpr int MAX_SIZE = 1 << 20;
+    /** The most entries the table can hold, including the ones without colors for each rendition */
+    static constexpr quint32 MAX_ENTRIES = MAX_SIZE + (1 << (8 * sizeof(RenditionFlags)));
+
+    /** Returns the index of the attributes of @p character, adding them to the table if needed. */
+    quint32 intern(const Character &character)
+    {
+        CharacterAttributes attributes{character.rendition, character.foregroundColor, character.backgroundColor};
+
+        // text mostly comes in runs of identical attributes
+        if (!_attributes.isEmpty() && _attributes.at(_lastIndex) == attributes) {
+            return _lastIndex;
+        }
+
+        auto it = _indexes.constFind(attributes);
+        if (it == _indexes.constEnd() && _attributes.size() >= MAX_SIZE) {
+            attributes.foregroundColor = CharacterColor(COLOR_SPACE_DEFAULT, DEFAULT_FORE_COLOR);
+            attributes.backgroundColor = CharacterColor(COLOR_SPACE_DEFAULT, DEFAULT_BACK_COLOR);
+            it = _indexes.constFind(attributes);
+        }
+        if (it == _indexes.constEnd()) {
+            it = _indexes.insert(attributes, _attributes.size());
+            _attributes.append(attributes);
+        }
+        _lastIndex = it.value();
+        return _lastIndex;
+    }
+
+    /**
+     * Keeps only the entries for which @p used is true, and returns the new
+     * index of each of them.  The indexes of the other entries are left
+     * out of the table and map to 0.
+     */
+    QVector<quint32> compact(const QVector<bool> &used)
+    {
+        Q_ASSERT(used.size() == _attributes.size());
+
+        QVector<quint32> newIndexes(_attributes.size(), 0);
+        QVector<CharacterAttributes> attributes;
+        _indexes.clear();
+        for (int i = 0; i < _attributes.size(); ++i) {
+            if (used.at(i)) {
+                newIndexes[i] = attributes.size();
+                _indexes.insert(_attributes.at(i), attributes.size());
+                attributes.append(_attributes.at(i));
+            }
+        }
+        _attributes = attributes;
+        _lastIndex = 0;
+        return newIndexes;
+    }
+
+    const CharacterAttributes &at(quint32 index) const
+    {
+        return _attributes.at(index);
+    }
+
+    int size() const
+    {
+        return _attributes.size();
+    }
+
+    void clear()
+    {
+        _attributes.clear();
+        _indexes.clear();
+        _lastIndex = 0;
+    }
+
+    /** Returns all entries, the index of each being its position */
+    const QVector<CharacterAttributes> &entries() const
+    {
+        return _attributes;
+    }
+
+    /** Replaces the entries of the table, e.g. with entries() saved before */
+    void setEntries(const QVector<CharacterAttributes> &entries)
+    {
+        _attributes = entries;
+        _indexes.clear();
+        for (int i = 0; i < _attributes.size(); ++i) {
+            _indexes.insert(_attributes.at(i), i);
+        }
+        _lastIndex = 0;
+    }
+
+private:
+    QVector<CharacterAttributes> _attributes;
+    QHash<CharacterAttributes, quint32> _indexes;
+    quint32 _lastIndex = 0;
+};
+
+/**
+ * An 8 byte storage format for a Character.
+ *
+ * The character value is kept as is (it may be an extended character hash,
+ * which uses all 32 bits), while colors and rendition are replaced by an index
+ * into a CharacterAttributeTable. The top bit of that index marks place holder
+ * characters.
+ *
+ * Character stays the type used to draw and decode the terminal contents;
+ * PackedCharacter is only meant for bulk storage such as the history.
+ */
+class PackedCharacter
+{
+public:
+    PackedCharacter() = default;
+
+    PackedCharacter(const Character &character, CharacterAttributeTable &table)
+        : _character(character.character)
+        , _attributes(table.intern(character) | (character.isRealCharacter ? 0 : PLACE_HOLDER))
+    {
+    }
+
+    /**
+     * Creates a PackedCharacter from a character value and the attributes of
+     * another PackedCharacter, see packedAttributes().
+     */
+    static PackedCharacter fromPacked(uint character, quint32 packedAttributes)
+    {
+        PackedCharacter result;
+        result._character = character;
+        result._attributes = packedAttributes;
+        return result;
+    }
+
+    /** Returns the unpacked Character, using the attributes from @p table. */
+    Character unpack(const CharacterAttributeTable &table) const
+    {
+        const CharacterAttributes &attributes = table.at(attributeIndex());
+        return Character(_character, attributes.foregroundColor, attributes.backgroundColor, attributes.rendition, isRealCharacter());
+    }
+
+    uint character() const
+    {
+        return _character;
+    }
+
+    quint32 attributeIndex() const
+    {
+        return _attributes & ~PLACE_HOLDER;
+    }
+
+    bool isRealCharacter() const
+    {
+        return (_attributes & PLACE_HOLDER) == 0;
+    }
+
+    /**
+     * Returns the attribute index together with the place holder flag; two
+     * characters can be drawn with the same format if these are equal.
+     */
+    quint32 packedAttributes() const
+    {
+        return _attributes;
+    }
+
+private:
+    static constexpr quint32 PLACE_HOLDER = 1u << 31;
+    static_assert(CharacterAttributeTable::MAX_ENTRIES <= PLACE_HOLDER, "attribute indexes must not reach the place holder flag");
+
+    quint32 _character = ' ';
+    quint32 _attributes = 0;
+};
+
+static_assert(sizeof(PackedCharacter) == 8, "PackedCharacter must stay 8 bytes");
+}
+Q_DECLARE_TYPEINFO(Konsole::PackedCharacter, Q_PRIMITIVE_TYPE);
+
+#endif // PACKEDCHARACTER_H
@@ -10,6 +10,9 @@
 // Konsole decoders
 #include "TerminalCharacterDecoder.h"
 
+// Konsole characters
+#include <ExtendedCharTable.h>
+
 class QTextStream;
 template<typename>
 class QList;
@@ -51,6 +54,57 @@ public:
 
     void decodeLine(const Character *const characters, int count, LineProperty properties) override;
 
+    /**
+     * Calls @p append with each code point of the text which decodeLine()
+     * produces for the cells from @p start to @p end (not included) of a
+     * line of @p count cells.  This is used to index and search the text of
+     * lines without decoding them into a string.
+     */
+    template<typename Append>
+    static void decodeCharacters(const Character *const characters, int count, int start, int end, Append &&append)
+    {
+        // find out the last technically real character in the line
+        int realCharacterGuard = -1;
+        for (int i = count - 1; i >= start; i--) {
+            // FIXME: the special case of '\n' here is really ugly
+            // Maybe the '\n' should be added after calling this method in
+            // Screen::copyLineToStream()
+            if (characters[i].isRealCharacter && characters[i].character != '\n') {
+                realCharacterGuard = i;
+                break;
+            }
+        }
+
+        for (int i = start; i < end;) {
+            if ((characters[i].rendition & RE_EXTENDED_CHAR) != 0) {
+                ushort extendedCharLength = 0;
+                const uint *chars = ExtendedCharTable::instance.lookupExtendedChar(characters[i].character, extendedCharLength);
+                if (chars != nullptr) {
+                    for (uint nchar = 0; nchar < extendedCharLength; nchar++) {
+                        append(chars[nchar]);
+                    }
+                    i += qMax(1, Character::stringWidth(chars, extendedCharLength));
+                } else {
+                    ++i;
+                }
+            } else {
+                // All characters which appear before the last real character are
+                // seen as real characters, even when they are technically marked as
+                // non-real.
+                //
+                // This feels tricky, but otherwise leading "whitespaces" may be
+                // lost in some situation. One typical example is copying the result
+                // of `dialog --infobox "qwe" 10 10` .
+                if (characters[i].isRealCharacter || i <= realCharacterGuard) {
+                    append(characters[i].character);
+                    i += qMax(1, Character::stringWidth(&characters[i].character, 1));
+                } else {
+                    ++i; // should we 'break' directly here?
+                }
+            }
+        }
+    }
+
 private:
     QTextStream *_output;
     bool _includeLeadingWhitespace;
@@ -49,3 +49,8 @@ void EscapeSequenceUrlFilter::process()
         addHotSpot(spot);
     }
 }
+
+bool EscapeSequenceUrlFilter::hotSpotsUpToDate()
+{
+    return false;
+}
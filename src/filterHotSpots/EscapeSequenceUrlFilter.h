@@ -30,6 +30,9 @@ public:
 
     void process() override;
 
+    /** The hotspots come from the URLs of the screen rather than the text, and are always found again */
+    bool hotSpotsUpToDate() override;
+
 private:
     QPointer<Session> _session;
     QPointer<TerminalDisplay> _window;
@@ -140,16 +140,29 @@ QSharedPointer<HotSpot> FileFilter::newHotSpot(int startLine, int startColumn, i
 }
 
 void FileFilter::process()
+{
+    updateDirectory();
+
+    RegExpFilter::process();
+}
+
+bool FileFilter::hotSpotsUpToDate()
+{
+    const bool directoryChanged = updateDirectory();
+    return !directoryChanged && RegExpFilter::hotSpotsUpToDate();
+}
+
+bool FileFilter::updateDirectory()
 {
     const QDir dir(_session->currentWorkingDirectory());
     // Do not re-process.
-    if (_dirPath != dir.canonicalPath() + QLatin1Char('/')) {
-        _dirPath = dir.canonicalPath() + QLatin1Char('/');
-
-        _currentDirContents = dir.entryList(QDir::Dirs | QDir::Files);
+    if (_dirPath == dir.canonicalPath() + QLatin1Char('/')) {
+        return false;
     }
 
-    RegExpFilter::process();
+    _dirPath = dir.canonicalPath() + QLatin1Char('/');
+    _currentDirContents = dir.entryList(QDir::Dirs | QDir::Files);
+    return true;
 }
 
 void FileFilter::updateRegex(const QString &wordCharacters)
@@ -31,6 +31,9 @@ public:
 
     void process() override;
 
+    /** The hotspots are out of date when the current directory changed */
+    bool hotSpotsUpToDate() override;
+
     void updateRegex(const QString &wordCharacters);
 
 protected:
@@ -38,6 +41,9 @@ protected:
 
 private:
     QString concatRegexPattern(QString wordCharacters) const;
+    // reads the contents of the current directory if it changed, and
+    // returns true if it did
+    bool updateDirectory();
 
     QPointer<Session> _session;
     QString _dirPath;
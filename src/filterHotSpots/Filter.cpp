@@ -14,6 +14,7 @@ using namespace Konsole;
 Filter::Filter()
     : _linePositions(nullptr)
     , _buffer(nullptr)
+    , _upToDate(false)
 {
 }
 
@@ -26,6 +27,35 @@ void Filter::reset()
 {
     _hotspots.clear();
     _hotspotList.clear();
+    _upToDate = true;
+}
+
+bool Filter::hotSpotsUpToDate()
+{
+    return _upToDate;
+}
+
+void Filter::invalidate()
+{
+    _upToDate = false;
+}
+
+void Filter::moveHotSpots(const QVector<int> &lineMap)
+{
+    const QList<QSharedPointer<HotSpot>> hotspots = _hotspotList;
+    _hotspots.clear();
+    _hotspotList.clear();
+
+    for (const auto &spot : hotspots) {
+        bool keep = spot->startLine() >= 0 && spot->endLine() < lineMap.size();
+        for (int line = spot->startLine(); keep && line <= spot->endLine(); line++) {
+            keep = lineMap[line] != -1;
+        }
+        if (keep) {
+            spot->moveLines(lineMap[spot->startLine()] - spot->startLine());
+            addHotSpot(spot);
+        }
+    }
 }
 
 void Filter::setBuffer(const QString *buffer, const QList<int> *linePositions)
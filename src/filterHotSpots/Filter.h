@@ -18,6 +18,7 @@
 #include <QRegularExpression>
 #include <QSet>
 #include <QStringList>
+#include <QVector>
 
 // KDE
 #include <KFileItem>
@@ -72,6 +73,27 @@ public:
      */
     void reset();
 
+    /**
+     * Returns true if the hotspots found on lines whose text has not changed
+     * since they were processed are still valid, so that only the lines which
+     * changed have to be processed again, see TerminalImageFilterChain.
+     *
+     * This is the case from reset() until invalidate() is called.  Filters
+     * whose hotspots depend on more than the text of their lines reimplement
+     * this, and may update their state when doing so.
+     */
+    virtual bool hotSpotsUpToDate();
+
+    /**
+     * Keeps the hotspots whose lines are all mapped to a line by @p lineMap,
+     * and moves them by as many lines as their start line is mapped by, e.g.
+     * because the text scrolled.  The other hotspots are deleted.
+     *
+     * @param lineMap The new line of each line, or -1 if the line is to be
+     * processed again
+     */
+    void moveHotSpots(const QVector<int> &lineMap);
+
     /** Returns the hotspot which covers the given @p line and @p column, or 0 if no hotspot covers that area */
     QSharedPointer<HotSpot> hotSpotAt(int line, int column) const;
 
@@ -86,6 +108,11 @@ public:
     void setBuffer(const QString *buffer, const QList<int> *linePositions);
 
 protected:
+    /**
+     * Makes hotSpotsUpToDate() return false until the next reset(), e.g.
+     * because the filter looks for something else now.
+     */
+    void invalidate();
     /** Adds a new hotspot to the list */
     void addHotSpot(QSharedPointer<HotSpot> spot);
     /** Returns the internal buffer */
@@ -101,6 +128,7 @@ private:
 
     const QList<int> *_linePositions;
     const QString *_buffer;
+    bool _upToDate;
 };
 
 } // namespace Konsole
@@ -15,6 +15,8 @@
 #include <QRegion>
 #include <QSharedPointer>
 
+#include "konsoleprivate_export.h"
+
 class QAction;
 class QMenu;
 class QMouseEvent;
@@ -36,7 +38,7 @@ class TerminalDisplay;
  * Hotspots may have more than one action, in which case the list of actions can be obtained using the
  * actions() method.  These actions may then be displayed in a popup menu or toolbar for example.
  */
-class HotSpot : public QObject
+class KONSOLEPRIVATE_EXPORT HotSpot : public QObject
 {
     // krazy suggest using Q_OBJECT here but moc can not handle
     // nested classes
@@ -75,6 +77,8 @@ public:
     int startColumn() const;
     /** Returns the column on endLine() where the hotspot area ends */
     int endColumn() const;
+    /** Moves the hotspot area down by @p lines lines, or up if @p lines is negative */
+    void moveLines(int lines);
     /**
      * Returns the type of the hotspot.  This is usually used as a hint for views on how to represent
      * the hotspot graphically.  eg.  Link hotspots are typically underlined when the user mouses over them
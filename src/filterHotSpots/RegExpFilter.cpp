@@ -20,6 +20,7 @@ void RegExpFilter::setRegExp(const QRegularExpression &regExp)
 {
     _searchText = regExp;
     _searchText.optimize();
+    invalidate();
 }
 
 QRegularExpression RegExpFilter::regExp() const
@@ -9,60 +9,180 @@
 
 #include <QTextStream>
 
+#include <algorithm>
+
+#include "../Screen.h"
 #include "../decoders/PlainTextDecoder.h"
 
 #include "terminalDisplay/TerminalDisplay.h"
 
 using namespace Konsole;
 
+// Returns a hash of what the text of a line depends on, which is the same
+// when a line is moved from the screen to the history
+static quint64 lineHash(const Screen::LineView &view)
+{
+    // the decoder drops the cells after the last real character
+    int length = view.length;
+    while (length > 0 && !view.cells[length - 1].isRealCharacter) {
+        length--;
+    }
+
+    quint64 hash = 14695981039346656037ULL;
+    for (int i = 0; i < length; i++) {
+        const Character &cell = view.cells[i];
+        const quint64 flags = ((cell.rendition & RE_EXTENDED_CHAR) != 0 ? 1 : 0) | (cell.isRealCharacter ? 2 : 0);
+        hash = (hash ^ ((quint64(cell.character) << 2) | flags)) * 1099511628211ULL;
+    }
+    return hash;
+}
+
 TerminalImageFilterChain::TerminalImageFilterChain(TerminalDisplay *terminalDisplay)
     : FilterChain(terminalDisplay)
     , _buffer(nullptr)
     , _linePositions(nullptr)
+    , _changedBuffer(nullptr)
+    , _changedLinePositions(nullptr)
+    , _screen(nullptr)
+    , _firstLine(0)
 {
 }
 
 TerminalImageFilterChain::~TerminalImageFilterChain() = default;
 
-void TerminalImageFilterChain::setImage(const Character *const image, int lines, int columns, const QVector<LineProperty> &lineProperties)
+void TerminalImageFilterChain::setImage(const Screen *screen, int startLine, int lines)
 {
     if (_filters.empty()) {
+        _lines.clear();
         return;
     }
 
-    // reset all filters and hotspots
-    reset();
+    // the lines of the last image are only of use if the same filters
+    // processed lines of the same screen
+    const bool sameImage = screen == _screen && _filters == _processedFilters;
+    const qint64 firstLine = screen->totalDroppedLines() + startLine;
 
     PlainTextDecoder decoder;
     decoder.setLeadingWhitespace(true);
     decoder.setTrailingWhitespace(true);
 
-    // setup new shared buffers for the filters to process on
-    _buffer.reset(new QString());
-    _linePositions.reset(new QList<int>());
+    QString decodedLine;
+    QTextStream lineStream(&decodedLine);
+    decoder.begin(&lineStream);
 
-    setBuffer(_buffer.get(), _linePositions.get());
+    const int lineCount = screen->getHistLines() + screen->getLines();
 
-    QTextStream lineStream(_buffer.get());
-    decoder.begin(&lineStream);
+    // the line of the last image each line was on, or -1 if it changed
+    QVector<int> oldLines(lines, -1);
+    QVector<Line> image;
+    image.reserve(lines);
 
     for (int i = 0; i < lines; i++) {
-        _linePositions->append(_buffer->length());
-        decoder.decodeLine(image + i * columns, columns, LINE_DEFAULT);
+        // the decoder drops the blank columns after the end of the line,
+        // so these do not need to be filled in
+        Screen::LineView view = {nullptr, 0, LINE_DEFAULT};
+        if (startLine + i < lineCount) {
+            view = screen->getLineView(startLine + i);
+        }
+
+        Line line = {lineHash(view), (view.property & LINE_WRAPPED) != 0, QString()};
+        const qint64 oldLine = firstLine - _firstLine + i;
+        if (sameImage && oldLine >= 0 && oldLine < _lines.size() && _lines[int(oldLine)].hash == line.hash && _lines[int(oldLine)].wrapped == line.wrapped) {
+            line.text = _lines[int(oldLine)].text;
+            oldLines[i] = int(oldLine);
+        } else if (view.cells != nullptr) {
+            decodedLine.clear();
+            decoder.decodeLine(view.cells, view.length, LINE_DEFAULT);
+            line.text = decodedLine;
+        }
+        image << line;
+    }
+    decoder.end();
+
+    // a link may be spread over the lines of a wrapped line, which are
+    // only kept if all of them are, and if they were not part of a longer
+    // wrapped line in the last image
+    QVector<int> lineMap(_lines.size(), -1);
+    for (int first = 0; first < lines;) {
+        int last = first;
+        while (last < lines - 1 && image[last].wrapped) {
+            last++;
+        }
+
+        bool keep = std::all_of(oldLines.cbegin() + first, oldLines.cbegin() + last + 1, [](int oldLine) {
+            return oldLine != -1;
+        });
+        if (keep) {
+            const int oldFirst = oldLines[first];
+            const int oldLast = oldLines[last];
+            keep = (oldFirst == 0 || !_lines[oldFirst - 1].wrapped) && (oldLast == _lines.size() - 1 || !_lines[oldLast].wrapped);
+        }
 
+        for (int i = first; i <= last; i++) {
+            if (keep) {
+                lineMap[oldLines[i]] = i;
+            } else {
+                oldLines[i] = -1;
+            }
+        }
+        first = last + 1;
+    }
+
+    // the filters whose hotspots are up to date only process the lines
+    // which changed, the others start over with all lines
+    QList<Filter *> outdatedFilters;
+    for (auto *filter : qAsConst(_filters)) {
+        if (sameImage && filter->hotSpotsUpToDate()) {
+            filter->moveHotSpots(lineMap);
+        } else {
+            filter->reset();
+            outdatedFilters << filter;
+        }
+    }
+
+    // setup new shared buffers for the filters to process on
+    _buffer.reset(new QString());
+    _linePositions.reset(new QList<int>());
+    _changedBuffer.reset(new QString());
+    _changedLinePositions.reset(new QList<int>());
+
+    for (int i = 0; i < lines; i++) {
         // pretend that each line ends with a newline character.
         // this prevents a link that occurs at the end of one line
         // being treated as part of a link that occurs at the start of the next line
         //
         // the downside is that links which are spread over more than one line are not
-        // highlighted.
-        //
-        // TODO - Use the "line wrapped" attribute associated with lines in a
-        // terminal image to avoid adding this imaginary character for wrapped
-        // lines
-        if ((lineProperties.value(i, LINE_DEFAULT) & LINE_WRAPPED) == 0) {
-            lineStream << QLatin1Char('\n');
+        // highlighted, unless the lines are wrapped.
+        const QString &text = image[i].text;
+        const bool newLine = !image[i].wrapped;
+
+        if (!outdatedFilters.isEmpty()) {
+            _linePositions->append(_buffer->length());
+            _buffer->append(text);
+            if (newLine) {
+                _buffer->append(QLatin1Char('\n'));
+            }
+        }
+
+        _changedLinePositions->append(_changedBuffer->length());
+        if (oldLines[i] == -1) {
+            _changedBuffer->append(text);
+            if (newLine) {
+                _changedBuffer->append(QLatin1Char('\n'));
+            }
         }
     }
-    decoder.end();
+
+    for (auto *filter : qAsConst(_filters)) {
+        if (outdatedFilters.contains(filter)) {
+            filter->setBuffer(_buffer.get(), _linePositions.get());
+        } else {
+            filter->setBuffer(_changedBuffer.get(), _changedLinePositions.get());
+        }
+    }
+
+    _lines = image;
+    _screen = screen;
+    _firstLine = firstLine;
+    _processedFilters = _filters;
 }
@@ -8,40 +8,70 @@
 #ifndef TERMINAL_IMAGE_FILTER_CHAIN
 #define TERMINAL_IMAGE_FILTER_CHAIN
 
+#include <QList>
 #include <QString>
+#include <QVector>
 #include <memory>
 
 #include "../characters/Character.h"
 #include "FilterChain.h"
+#include "konsoleprivate_export.h"
 
 namespace Konsole
 {
+class Screen;
 class TerminalDisplay;
 
 /** A filter chain which processes character images from terminal displays */
-class TerminalImageFilterChain : public FilterChain
+class KONSOLEPRIVATE_EXPORT TerminalImageFilterChain : public FilterChain
 {
 public:
     explicit TerminalImageFilterChain(TerminalDisplay *terminalDisplay);
     ~TerminalImageFilterChain() override;
 
     /**
-     * Set the current terminal image to @p image.
+     * Set the current terminal image to @p lines lines of @p screen,
+     * starting with @p startLine.
      *
-     * @param image The terminal image
+     * The characters are read through Screen::getLineView(), without
+     * copying the image first.  Lines past the end of the screen are blank.
+     *
+     * The text of each line is kept along with a hash of its characters, so
+     * that a line is only decoded again if it changed.  The filters whose
+     * hotspots are up to date, see Filter::hotSpotsUpToDate(), keep the
+     * hotspots of the lines which did not change, moved to where the lines
+     * are now if the image scrolled, and are only given the text of the
+     * other lines to process.  A wrapped line is processed again along with
+     * the lines it continues on.
+     *
+     * @param screen The screen to read the terminal image from
+     * @param startLine The first line of the image, where 0 is the first line in the history
      * @param lines The number of lines in the terminal image
-     * @param columns The number of columns in the terminal image
-     * @param lineProperties The line properties to set for image
      */
-    void setImage(const Character *const image, int lines, int columns, const QVector<LineProperty> &lineProperties);
+    void setImage(const Screen *screen, int startLine, int lines);
 
 private:
     Q_DISABLE_COPY(TerminalImageFilterChain)
 
+    // a line of the image which was processed last
+    struct Line {
+        quint64 hash; // of the characters of the line
+        bool wrapped;
+        QString text; // without the new-line
+    };
+
     /* usually QStrings and QLists are not supposed to be in the heap, here we have a problem:
         we need a shared memory space between many filter objeccts, defined by this TerminalImage. */
     std::unique_ptr<QString> _buffer;
     std::unique_ptr<QList<int>> _linePositions;
+    // the text of the lines which changed, the other lines are empty
+    std::unique_ptr<QString> _changedBuffer;
+    std::unique_ptr<QList<int>> _changedLinePositions;
+
+    QVector<Line> _lines;
+    const Screen *_screen; // not dereferenced, only compared
+    qint64 _firstLine; // of _lines, counted from the first line ever added to the history
+    QList<Filter *> _processedFilters;
 };
 
 }
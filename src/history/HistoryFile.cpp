@@ -30,9 +30,12 @@ Q_GLOBAL_STATIC(QString, historyFileLocation)
 // History File ///////////////////////////////////////////
 HistoryFile::HistoryFile()
     : _length(0)
-    , _fileMap(nullptr)
-    , _readWriteBalance(0)
+    , _unflushed(false)
+    , _mapFailed(false)
 {
+    // the buffer is kept allocated while it is emptied, see flushPending()
+    _pending.reserve(WRITE_BUFFER_SIZE);
+
     // Determine the temp directory once
     // This class is called 3 times for each "unlimited" scrollback.
     // This has the down-side that users must restart to
@@ -97,63 +100,82 @@ HistoryFile::HistoryFile()
 
 HistoryFile::~HistoryFile()
 {
-    if (_fileMap != nullptr) {
-        unmap();
-    }
+    unmapSegments();
 }
 
-// TODO:  Mapping the entire file in will cause problems if the history file becomes exceedingly large,
-//(ie. larger than available memory).  HistoryFile::map() should only map in sections of the file at a time,
-// to avoid this.
-void HistoryFile::map()
+const uchar *HistoryFile::segment(qint64 index)
 {
-    Q_ASSERT(_fileMap == nullptr);
+    // mapped data must not be behind the file's write buffer
+    if (_unflushed) {
+        _tmpFile.flush();
+        _unflushed = false;
+    }
 
-    if (_tmpFile.flush()) {
-        Q_ASSERT(_tmpFile.size() >= _length);
-        _fileMap = _tmpFile.map(0, _length);
+    for (int i = 0; i < _segments.size(); ++i) {
+        if (_segments.at(i).index == index) {
+            if (i > 0) {
+                _segments.move(i, 0);
+            }
+            return _segments.at(0).data;
+        }
     }
 
+    uchar *data = _tmpFile.map(index * SEGMENT_SIZE, SEGMENT_SIZE);
     // if mmap'ing fails, fall back to the read-lseek combination
-    if (_fileMap == nullptr) {
-        _readWriteBalance = 0;
+    if (data == nullptr) {
+        _mapFailed = true;
         qCDebug(KonsoleDebug) << "mmap'ing history failed.  errno = " << errno;
+        return nullptr;
+    }
+
+    if (_segments.size() == MAX_SEGMENTS) {
+        _tmpFile.unmap(_segments.last().data);
+        _segments.removeLast();
     }
+    _segments.prepend(Segment{index, data});
+    return data;
 }
 
-void HistoryFile::unmap()
+void HistoryFile::unmapSegments()
 {
-    Q_ASSERT(_fileMap != nullptr);
-
-    if (_tmpFile.unmap(_fileMap)) {
-        _fileMap = nullptr;
+    for (const Segment &segment : qAsConst(_segments)) {
+        _tmpFile.unmap(segment.data);
     }
-
-    Q_ASSERT(_fileMap == nullptr);
+    _segments.clear();
 }
 
 void HistoryFile::add(const char *buffer, qint64 count)
 {
-    if (_fileMap != nullptr) {
-        unmap();
+    _pending.append(buffer, count);
+    _length += count;
+
+    if (_pending.size() >= WRITE_BUFFER_SIZE) {
+        flushPending();
     }
+}
 
-    if (_readWriteBalance < INT_MAX) {
-        _readWriteBalance++;
+void HistoryFile::flushPending()
+{
+    if (_pending.isEmpty()) {
+        return;
     }
 
+    const qint64 fileLength = _length - _pending.size();
     qint64 rc = 0;
 
-    if (!_tmpFile.seek(_length)) {
+    if (!_tmpFile.seek(fileLength)) {
         perror("HistoryFile::add.seek");
-        return;
-    }
-    rc = _tmpFile.write(buffer, count);
-    if (rc < 0) {
-        perror("HistoryFile::add.write");
-        return;
+        rc = -1;
+    } else {
+        rc = _tmpFile.write(_pending.constData(), _pending.size());
+        if (rc < 0) {
+            perror("HistoryFile::add.write");
+        }
     }
-    _length += rc;
+    // whatever could not be written is lost
+    _length = fileLength + qMax(rc, qint64(0));
+    _pending.resize(0);
+    _unflushed = true;
 }
 
 void HistoryFile::get(char *buffer, qint64 size, qint64 loc)
@@ -163,31 +185,38 @@ void HistoryFile::get(char *buffer, qint64 size, qint64 loc)
         return;
     }
 
-    // count number of get() calls vs. number of add() calls.
-    // If there are many more get() calls compared with add()
-    // calls (decided by using MAP_THRESHOLD) then mmap the log
-    // file to improve performance.
-    if (_readWriteBalance > INT_MIN) {
-        _readWriteBalance--;
-    }
-    if ((_fileMap == nullptr) && _readWriteBalance < MAP_THRESHOLD) {
-        map();
+    // The end of the range may still be in the write buffer
+    const qint64 fileLength = _length - _pending.size();
+    if (loc + size > fileLength) {
+        const qint64 start = qMax(loc, fileLength);
+        memcpy(buffer + (start - loc), _pending.constData() + (start - fileLength), loc + size - start);
+        size = start - loc;
     }
 
-    if (_fileMap != nullptr) {
-        memcpy(buffer, _fileMap + loc, size);
-    } else {
-        qint64 rc = 0;
+    while (size > 0) {
+        // Only segments which have been completely written are mapped, the
+        // rest is read from the file
+        const qint64 index = loc / SEGMENT_SIZE;
+        const qint64 offset = loc % SEGMENT_SIZE;
+        const qint64 count = qMin(size, SEGMENT_SIZE - offset);
+        const uchar *data = (!_mapFailed && (index + 1) * SEGMENT_SIZE <= fileLength) ? segment(index) : nullptr;
 
-        if (!_tmpFile.seek(loc)) {
-            perror("HistoryFile::get.seek");
-            return;
-        }
-        rc = _tmpFile.read(buffer, size);
-        if (rc < 0) {
-            perror("HistoryFile::get.read");
-            return;
+        if (data != nullptr) {
+            memcpy(buffer, data + offset, count);
+        } else {
+            if (!_tmpFile.seek(loc)) {
+                perror("HistoryFile::get.seek");
+                return;
+            }
+            if (_tmpFile.read(buffer, count) < 0) {
+                perror("HistoryFile::get.read");
+                return;
+            }
         }
+
+        buffer += count;
+        loc += count;
+        size -= count;
     }
 }
 
@@ -197,6 +226,13 @@ void HistoryFile::removeLast(qint64 loc)
         fprintf(stderr, "removeLast(%lld): invalid args.\n", loc);
         return;
     }
+
+    const qint64 fileLength = _length - _pending.size();
+    if (loc >= fileLength) {
+        _pending.truncate(loc - fileLength);
+    } else {
+        _pending.resize(0);
+    }
     _length = loc;
 }
 
@@ -8,7 +8,9 @@
 #define HISTORYFILE_H
 
 // Qt
+#include <QByteArray>
 #include <QTemporaryFile>
+#include <QVector>
 
 #include "konsoleprivate_export.h"
 
@@ -17,9 +19,14 @@ namespace Konsole
 /*
    An extendable tmpfile(1) based buffer.
 */
-class HistoryFile
+class KONSOLEPRIVATE_EXPORT HistoryFile
 {
 public:
+    /** The size of the segments the file is mapped in */
+    static const qint64 SEGMENT_SIZE = 1024 * 1024;
+    /** The size of the data which is collected before it is written to the file */
+    static const int WRITE_BUFFER_SIZE = 64 * 1024;
+
     HistoryFile();
     virtual ~HistoryFile();
 
@@ -28,26 +35,39 @@ public:
     virtual void removeLast(qint64 loc);
     virtual qint64 len() const;
 
-    // mmaps the file in read-only mode
-    void map();
-    // un-mmaps the file
-    void unmap();
-
 private:
+    // returns the mapped segment @p index, or nullptr if it can not be mapped
+    const uchar *segment(qint64 index);
+    void unmapSegments();
+    // writes the data in _pending to the file
+    void flushPending();
+
     qint64 _length;
     QTemporaryFile _tmpFile;
 
-    // pointer to start of mmap'ed file data, or 0 if the file is not mmap'ed
-    uchar *_fileMap;
+    // Data which has been added but not written to the file yet; it is
+    // written once it holds WRITE_BUFFER_SIZE bytes. get() copies from it
+    // and removeLast() truncates it directly. It always ends at _length.
+    QByteArray _pending;
+
+    // true if data was written since the file was last flushed
+    bool _unflushed;
+
+    // The file is mmap'ed in aligned segments of SEGMENT_SIZE bytes, which are
+    // mapped once they have been completely written and are then kept mapped.
+    // Shared mappings see later writes to the file, so adding data (even after
+    // removeLast()) never requires remapping. The most recently used segments
+    // are first in the list.
+    struct Segment {
+        qint64 index;
+        uchar *data;
+    };
+    QVector<Segment> _segments;
 
-    // incremented whenever 'add' is called and decremented whenever
-    //'get' is called.
-    // this is used to detect when a large number of lines are being read and processed from the history
-    // and automatically mmap the file for better performance (saves the overhead of many lseek-read calls).
-    int _readWriteBalance;
+    // set if mmap'ing failed, in which case the read-lseek combination is used
+    bool _mapFailed;
 
-    // when _readWriteBalance goes below this threshold, the file will be mmap'ed automatically
-    static const int MAP_THRESHOLD = -1000;
+    static const int MAX_SEGMENTS = 8;
 };
 
 }
@@ -8,6 +8,9 @@
 
 #include "HistoryTypeFile.h"
 
+// Qt
+#include <QVarLengthArray>
+
 /*
    The history scroll makes a Row(Row(Cell)) from
    two history buffers. The index buffer contains
@@ -17,6 +20,9 @@
    Note that index[0] addresses the second line
    (line #1), while the first line (line #0) starts
    at 0 in cells.
+
+   Cells are stored as PackedCharacter, their colors
+   and renditions are kept in memory in _attributes.
 */
 
 using namespace Konsole;
@@ -40,7 +46,7 @@ int HistoryScrollFile::getMaxLines() const
 
 int HistoryScrollFile::getLineLen(const int lineno) const
 {
-    return (startOfLine(lineno + 1) - startOfLine(lineno)) / sizeof(Character);
+    return (startOfLine(lineno + 1) - startOfLine(lineno)) / sizeof(PackedCharacter);
 }
 
 bool HistoryScrollFile::isWrappedLine(const int lineno) const
@@ -75,12 +81,21 @@ qint64 HistoryScrollFile::startOfLine(const int lineno) const
 
 void HistoryScrollFile::getCells(const int lineno, const int colno, const int count, Character res[]) const
 {
-    _cells.get(reinterpret_cast<char *>(res), count * sizeof(Character), startOfLine(lineno) + colno * sizeof(Character));
+    QVarLengthArray<PackedCharacter, 512> packed(count);
+    _cells.get(reinterpret_cast<char *>(packed.data()), count * sizeof(PackedCharacter), startOfLine(lineno) + colno * sizeof(PackedCharacter));
+    for (int i = 0; i < count; ++i) {
+        res[i] = packed[i].unpack(_attributes);
+    }
 }
 
 void HistoryScrollFile::addCells(const Character text[], const int count)
 {
-    _cells.add(reinterpret_cast<const char *>(text), count * sizeof(Character));
+    QVarLengthArray<PackedCharacter, 512> packed;
+    packed.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        packed.append(PackedCharacter(text[i], _attributes));
+    }
+    _cells.add(reinterpret_cast<const char *>(packed.constData()), count * sizeof(PackedCharacter));
 }
 
 void HistoryScrollFile::addLine(LineProperty lineProperty)
@@ -110,7 +125,7 @@ int HistoryScrollFile::reflowLines(const int columns)
     reflowData newLine;
 
     auto reflowLineLen = [](qint64 start, qint64 end) {
-        return (int)((end - start) / sizeof(Character));
+        return (int)((end - start) / sizeof(PackedCharacter));
     };
     auto setNewLine = [](reflowData &change, qint64 index, LineProperty lineflag) {
         change.index = index;
@@ -135,7 +150,7 @@ int HistoryScrollFile::reflowLines(const int columns)
 
         // Now reflow the lines
         while (reflowLineLen(startLine, endLine) > columns && !(lineProperty & (LINE_DOUBLEHEIGHT_BOTTOM | LINE_DOUBLEHEIGHT_TOP))) {
-            startLine += (qint64)columns * sizeof(Character);
+            startLine += (qint64)columns * sizeof(PackedCharacter);
             setNewLine(newLine, startLine, lineProperty | LINE_WRAPPED);
             reflowFile->add(reinterpret_cast<const char *>(&newLine), sizeof(reflowData));
         }
@@ -13,6 +13,9 @@
 #include "HistoryFile.h"
 #include "HistoryScroll.h"
 
+// Konsole
+#include "../characters/PackedCharacter.h"
+
 namespace Konsole
 {
 //////////////////////////////////////////////////////////////////////
@@ -33,7 +36,7 @@ public:
     LineProperty getLineProperty(const int lineno) const override;
 
     void addCells(const Character text[], const int count) override;
-    void addCellsMove(Character text[], const int count) override { addCells(text, count); } // TODO: optimize, if there's any point
+    void addCellsMove(Character text[], const int count) override { addCells(text, count); } // cells are packed anyway
     void addLine(LineProperty lineProperty = 0) override;
 
     // Modify history
@@ -44,8 +47,9 @@ private:
     qint64 startOfLine(const int lineno) const;
 
     mutable HistoryFile _index; // lines Row(qint64)
-    mutable HistoryFile _cells; // text  Row(Character)
+    mutable HistoryFile _cells; // text  Row(PackedCharacter)
     mutable HistoryFile _lineflags; // flags Row(unsigned char)
+    CharacterAttributeTable _attributes; // attributes referenced by _cells
 
     struct reflowData { // data to reflow lines
         qint64 index;
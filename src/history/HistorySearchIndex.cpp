@@ -0,0 +1,445 @@
+/*
+    SPDX-FileCopyrightText: 2022 Konsole Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+// Own
+#include "HistorySearchIndex.h"
+
+// Konsole
+#include "../decoders/PlainTextDecoder.h"
+
+using namespace Konsole;
+
+// Minimum length of a literal which can be looked up in the index
+static const int MIN_LITERAL_LENGTH = 3;
+
+static inline uint foldCase(uint character)
+{
+    return QChar::toLower(character);
+}
+
+void HistorySearchIndex::Signature::addTrigram(uint first, uint second, uint third)
+{
+    quint32 hash = 2166136261u;
+    hash = (hash ^ foldCase(first)) * 16777619u;
+    hash = (hash ^ foldCase(second)) * 16777619u;
+    hash = (hash ^ foldCase(third)) * 16777619u;
+    hash ^= hash >> 15;
+    hash *= 0x2c1b3c6du;
+    hash ^= hash >> 12;
+
+    // two bits per trigram, out of 256
+    const uint bit1 = hash & 0xff;
+    const uint bit2 = (hash >> 8) & 0xff;
+    bits[bit1 >> 6] |= quint64(1) << (bit1 & 63);
+    bits[bit2 >> 6] |= quint64(1) << (bit2 & 63);
+}
+
+bool HistorySearchIndex::Signature::contains(const Signature &other) const
+{
+    return ((bits[0] & other.bits[0]) == other.bits[0]) && ((bits[1] & other.bits[1]) == other.bits[1]) && ((bits[2] & other.bits[2]) == other.bits[2])
+        && ((bits[3] & other.bits[3]) == other.bits[3]);
+}
+
+HistorySearchIndex::Signature &HistorySearchIndex::Signature::operator|=(const Signature &other)
+{
+    for (int i = 0; i < 4; ++i) {
+        bits[i] |= other.bits[i];
+    }
+    return *this;
+}
+
+HistorySearchIndex::Filter::Filter(const QRegularExpression &regExp)
+    : _literal(canMatchLineBreak(regExp) ? QString() : requiredLiteral(regExp))
+{
+    const QVector<uint> characters = _literal.toUcs4();
+    for (int i = 2; i < characters.size(); ++i) {
+        _signature.addTrigram(characters[i - 2], characters[i - 1], characters[i]);
+    }
+}
+
+bool HistorySearchIndex::Filter::isValid() const
+{
+    return _literal.toUcs4().size() >= MIN_LITERAL_LENGTH;
+}
+
+QString HistorySearchIndex::Filter::literal() const
+{
+    return _literal;
+}
+
+HistorySearchIndex::HistorySearchIndex()
+    : _tail{0, 0}
+    , _tailLength(0)
+    , _lastLineWrapped(false)
+    , _firstLineContinues(false)
+{
+}
+
+void HistorySearchIndex::addLine(const Character cells[], int count, bool wrapped)
+{
+    Line line{Signature(), wrapped};
+
+    // continue the trigrams of the previous line if it wraps into this one
+    uint window[2] = {_tail[0], _tail[1]};
+    int windowLength = _lastLineWrapped ? qMax(0, _tailLength) : 0;
+    if (_lastLineWrapped && _tailLength < 0) {
+        // the end of the previous line is unknown, so the line has to be
+        // a candidate for every search
+        for (quint64 &bits : line.signature.bits) {
+            bits = ~quint64(0);
+        }
+    }
+    const auto addCharacter = [&](uint character) {
+        if (windowLength == 2) {
+            line.signature.addTrigram(window[0], window[1], character);
+            window[0] = window[1];
+            window[1] = character;
+        } else {
+            window[windowLength++] = character;
+        }
+    };
+
+    // the text the PlainTextDecoder produces when the line is copied out
+    // of the history, so that the same text is indexed
+    PlainTextDecoder::decodeCharacters(cells, count, 0, count, addCharacter);
+
+    if (_lines.empty()) {
+        _firstLineContinues = _lastLineWrapped;
+    }
+    _lines.push_back(line);
+
+    _tail[0] = window[0];
+    _tail[1] = window[1];
+    _tailLength = windowLength;
+    _lastLineWrapped = wrapped;
+
+    if (_lines.size() > size_t(MaxLines)) {
+        keepLastLines(MaxLines);
+    }
+}
+
+void HistorySearchIndex::removeLastLine()
+{
+    if (_lines.empty()) {
+        return;
+    }
+
+    _lines.pop_back();
+    _lastLineWrapped = _lines.empty() ? _firstLineContinues : _lines.back().wrapped;
+    _tailLength = -1;
+}
+
+void HistorySearchIndex::keepLastLines(int count)
+{
+    count = qMax(0, count);
+    if (_lines.size() <= size_t(count)) {
+        return;
+    }
+
+    const size_t dropped = _lines.size() - count;
+    _firstLineContinues = _lines[dropped - 1].wrapped;
+    _lines.erase(_lines.begin(), _lines.begin() + dropped);
+}
+
+void HistorySearchIndex::clear()
+{
+    _lines.clear();
+    _tailLength = 0;
+    _lastLineWrapped = false;
+    _firstLineContinues = false;
+}
+
+int HistorySearchIndex::lineCount() const
+{
+    return int(_lines.size());
+}
+
+QVector<int> HistorySearchIndex::candidateLines(const Filter &filter, int from, int to) const
+{
+    QVector<int> candidates;
+    from = qMax(0, from);
+    to = qMin(lineCount() - 1, to);
+    if (from > to) {
+        return candidates;
+    }
+
+    // start with the first line of the group of wrapped lines containing from
+    int groupStart = from;
+    while (groupStart > 0 && _lines[groupStart - 1].wrapped) {
+        groupStart--;
+    }
+
+    // a group which continues after to is still checked as a whole
+    Signature groupSignature;
+    for (int line = groupStart; line < lineCount() && groupStart <= to; ++line) {
+        groupSignature |= _lines[line].signature;
+
+        // the group ends with the first line which does not wrap
+        if (_lines[line].wrapped && line < lineCount() - 1) {
+            continue;
+        }
+
+        // a match in a group continuing a line which is not indexed may
+        // depend on text the index does not know about
+        const bool isCandidate = !filter.isValid() || groupSignature.contains(filter.signature()) || (groupStart == 0 && _firstLineContinues);
+        if (isCandidate) {
+            for (int candidate = qMax(groupStart, from); candidate <= qMin(line, to); ++candidate) {
+                candidates.append(candidate);
+            }
+        }
+
+        groupStart = line + 1;
+        groupSignature = Signature();
+    }
+
+    return candidates;
+}
+
+QString HistorySearchIndex::requiredLiteral(const QRegularExpression &regExp)
+{
+    // inline options, e.g. (?i), and extended syntax change how the rest of
+    // the pattern is read
+    const QString pattern = regExp.pattern();
+    if (pattern.contains(QLatin1String("(?")) || regExp.patternOptions().testFlag(QRegularExpression::ExtendedPatternSyntaxOption)) {
+        return QString();
+    }
+    // case insensitive matching of non ASCII characters is not necessarily
+    // the same as comparing their lower case
+    const bool asciiOnly = regExp.patternOptions().testFlag(QRegularExpression::CaseInsensitiveOption);
+
+    const QVector<uint> characters = pattern.toUcs4();
+    const int length = characters.size();
+    const auto isAsciiAlphanumeric = [](uint character) {
+        return (character >= 'a' && character <= 'z') || (character >= 'A' && character <= 'Z') || (character >= '0' && character <= '9');
+    };
+    const auto isHexDigit = [](uint character) {
+        return (character >= 'a' && character <= 'f') || (character >= 'A' && character <= 'F') || (character >= '0' && character <= '9');
+    };
+
+    QVector<uint> best;
+    QVector<uint> run;
+    const auto endRun = [&]() {
+        if (run.size() > best.size()) {
+            best = run;
+        }
+        run.clear();
+    };
+
+    int depth = 0;
+    for (int i = 0; i < length; ++i) {
+        const uint character = characters[i];
+
+        if (character == '\\') {
+            if (++i >= length) {
+                break;
+            }
+            const uint escaped = characters[i];
+            if (!isAsciiAlphanumeric(escaped)) {
+                // an escaped literal character
+                if (depth == 0) {
+                    if (asciiOnly && escaped > 0x7f) {
+                        endRun();
+                    } else {
+                        run.append(escaped);
+                    }
+                }
+                continue;
+            }
+
+            // a character type, assertion or back reference; skip its argument
+            if (depth == 0) {
+                endRun();
+            }
+            if (i + 1 < length && (characters[i + 1] == '{' || characters[i + 1] == '<' || characters[i + 1] == '\'')) {
+                const uint close = characters[i + 1] == '{' ? '}' : (characters[i + 1] == '<' ? '>' : '\'');
+                i++;
+                while (i + 1 < length && characters[i + 1] != close) {
+                    i++;
+                }
+                i++;
+            } else if (escaped == 'c') {
+                i++;
+            } else if (escaped == 'x') {
+                for (int digits = 0; digits < 2 && i + 1 < length && isHexDigit(characters[i + 1]); ++digits) {
+                    i++;
+                }
+            } else if (escaped >= '0' && escaped <= '9') {
+                while (i + 1 < length && characters[i + 1] >= '0' && characters[i + 1] <= '9') {
+                    i++;
+                }
+            }
+            continue;
+        }
+
+        if (character == '[') {
+            // skip the character class
+            if (depth == 0) {
+                endRun();
+            }
+            i++;
+            if (i < length && characters[i] == '^') {
+                i++;
+            }
+            if (i < length && characters[i] == ']') {
+                i++;
+            }
+            while (i < length && characters[i] != ']') {
+                if (characters[i] == '\\') {
+                    i++;
+                } else if (characters[i] == '[' && i + 1 < length && characters[i + 1] == ':') {
+                    while (i + 1 < length && !(characters[i] == ':' && characters[i + 1] == ']')) {
+                        i++;
+                    }
+                    i++;
+                }
+                i++;
+            }
+            continue;
+        }
+
+        switch (character) {
+        case '|':
+            // any alternative may match, so nothing is required
+            if (depth == 0) {
+                return QString();
+            }
+            break;
+        case '(':
+            if (depth++ == 0) {
+                endRun();
+            }
+            break;
+        case ')':
+            depth = qMax(0, depth - 1);
+            break;
+        case '*':
+        case '?':
+            // the previous character is optional
+            if (depth == 0) {
+                if (!run.isEmpty()) {
+                    run.removeLast();
+                }
+                endRun();
+            }
+            break;
+        case '+':
+            // the previous character is required, but may be repeated
+            if (depth == 0) {
+                endRun();
+            }
+            break;
+        case '{': {
+            // a quantifier if it looks like {n}, {n,} or {n,m}, else a literal
+            int end = i + 1;
+            bool hasDigit = false;
+            while (end < length && ((characters[end] >= '0' && characters[end] <= '9') || characters[end] == ',')) {
+                hasDigit = hasDigit || characters[end] != ',';
+                end++;
+            }
+            if (hasDigit && end < length && characters[end] == '}') {
+                if (depth == 0) {
+                    if (!run.isEmpty()) {
+                        run.removeLast();
+                    }
+                    endRun();
+                }
+                i = end;
+            } else if (depth == 0) {
+                run.append(character);
+            }
+            break;
+        }
+        case '.':
+        case '^':
+        case '$':
+            if (depth == 0) {
+                endRun();
+            }
+            break;
+        default:
+            if (depth == 0) {
+                if (asciiOnly && character > 0x7f) {
+                    endRun();
+                } else {
+                    run.append(character);
+                }
+            }
+            break;
+        }
+    }
+    endRun();
+
+    return QString::fromUcs4(best.constData(), best.size());
+}
+
+bool HistorySearchIndex::canMatchLineBreak(const QRegularExpression &regExp)
+{
+    const QString pattern = regExp.pattern();
+    if (regExp.patternOptions().testFlag(QRegularExpression::DotMatchesEverythingOption) && pattern.contains(QLatin1Char('.'))) {
+        return true;
+    }
+
+    // escapes which match, or may match, a line break: character types
+    // such as \s, \D and \W, and characters given by their code
+    static const QLatin1String lineBreakEscapes("nsvRDWHXCxocpP0123456789");
+
+    bool inClass = false;
+    for (int i = 0; i < pattern.size(); ++i) {
+        const QChar character = pattern.at(i);
+
+        // a literal line break or other control character, which may also
+        // be the start of a range in a character class
+        if (character.unicode() < 0x20) {
+            return true;
+        }
+
+        if (character == QLatin1Char('\\')) {
+            if (++i >= pattern.size()) {
+                break;
+            }
+            const QChar escaped = pattern.at(i);
+            // in a character class, escapes such as \t may start a range
+            // which includes the line break
+            if (escaped.unicode() < 0x80 && escaped.isLetterOrNumber() && (inClass || lineBreakEscapes.contains(escaped))) {
+                return true;
+            }
+            continue;
+        }
+
+        if (!inClass && character == QLatin1Char('[')) {
+            inClass = true;
+            // a negated class matches the line break unless it excludes it
+            if (i + 1 < pattern.size() && pattern.at(i + 1) == QLatin1Char('^')) {
+                return true;
+            }
+            // a leading ']' is part of the class
+            if (i + 1 < pattern.size() && pattern.at(i + 1) == QLatin1Char(']')) {
+                i++;
+            }
+            continue;
+        }
+
+        if (inClass && character == QLatin1Char('[') && i + 1 < pattern.size() && pattern.at(i + 1) == QLatin1Char(':')) {
+            // POSIX classes such as [:space:] and [:^alpha:]
+            const int end = pattern.indexOf(QLatin1String(":]"), i + 2);
+            if (end == -1) {
+                return true;
+            }
+            const QStringView name = QStringView(pattern).mid(i + 2, end - i - 2);
+            if (name.startsWith(QLatin1Char('^')) || name == QLatin1String("space") || name == QLatin1String("cntrl")) {
+                return true;
+            }
+            i = end + 1;
+            continue;
+        }
+
+        if (inClass && character == QLatin1Char(']')) {
+            inClass = false;
+        }
+    }
+
+    return false;
+}
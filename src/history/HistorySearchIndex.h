@@ -0,0 +1,154 @@
+/*
+    SPDX-FileCopyrightText: 2022 Konsole Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef HISTORYSEARCHINDEX_H
+#define HISTORYSEARCHINDEX_H
+
+// STD
+#include <deque>
+
+// Qt
+#include <QRegularExpression>
+#include <QString>
+#include <QVector>
+
+// Konsole
+#include "../characters/Character.h"
+#include "konsoleprivate_export.h"
+
+namespace Konsole
+{
+/**
+ * An index over the text of the last lines of the history, which tells
+ * which lines may contain a match of a search pattern without decoding them.
+ *
+ * For each line, the trigrams (three consecutive characters, case folded)
+ * of its text are hashed into a small bit set.  A pattern which requires a
+ * literal string (see Filter) can only match lines whose bit set contains
+ * all bits of the literal's trigrams, so a search only has to decode and
+ * match the text of those candidate lines.  Checking a line costs a few
+ * bitwise operations, and the index is updated in constant time as lines
+ * are added to and dropped from the history.
+ *
+ * Lines are indexed with the text the PlainTextDecoder produces for them,
+ * and a line which continues a wrapped line also gets the trigrams spanning
+ * the line break, so that matches spanning wrapped lines are found too.
+ */
+class KONSOLEPRIVATE_EXPORT HistorySearchIndex
+{
+public:
+    /** Max number of lines which are indexed, older lines are always candidates */
+    static const int MaxLines = 500000;
+
+    struct Signature {
+        quint64 bits[4] = {0, 0, 0, 0};
+
+        void addTrigram(uint first, uint second, uint third);
+        bool contains(const Signature &other) const;
+        Signature &operator|=(const Signature &other);
+    };
+
+    /**
+     * The trigrams of a literal string which every match of a regular
+     * expression contains.
+     *
+     * A filter is never valid for a pattern which may match a line break,
+     * as its matches may continue on lines which are no candidates.
+     */
+    class KONSOLEPRIVATE_EXPORT Filter
+    {
+    public:
+        explicit Filter(const QRegularExpression &regExp = QRegularExpression());
+
+        /**
+         * Returns false if no literal of at least three characters is
+         * required by the pattern, in which case every line is a candidate.
+         */
+        bool isValid() const;
+
+        /** The literal which every match contains */
+        QString literal() const;
+
+        const Signature &signature() const
+        {
+            return _signature;
+        }
+
+    private:
+        QString _literal;
+        Signature _signature;
+    };
+
+    HistorySearchIndex();
+
+    /**
+     * Indexes a new last line of the history.
+     *
+     * @param cells The cells of the line, as added to the history
+     * @param count The number of cells
+     * @param wrapped True if the line continues on the next line
+     */
+    void addLine(const Character cells[], int count, bool wrapped);
+
+    /** Drops the last line, e.g. because it was moved back to the screen */
+    void removeLastLine();
+
+    /** Drops the oldest lines so that at most @p count lines are left */
+    void keepLastLines(int count);
+
+    /** Drops all lines */
+    void clear();
+
+    /** Returns the number of indexed lines, which are the last lines of the history */
+    int lineCount() const;
+
+    /**
+     * Returns the indexed lines from @p from to @p to (both included, and
+     * counted from the oldest indexed line) which may contain a match of
+     * @p filter, in ascending order.
+     *
+     * All lines of a group of wrapped lines are candidates if the text of
+     * the group may contain a match.
+     */
+    QVector<int> candidateLines(const Filter &filter, int from, int to) const;
+
+    /**
+     * Returns the longest literal which every match of @p regExp contains,
+     * or an empty string if none could be determined.  This only looks at
+     * the parts of the pattern outside of groups, character classes and
+     * alternatives, which is enough for literal and most simple searches.
+     */
+    static QString requiredLiteral(const QRegularExpression &regExp);
+
+    /**
+     * Returns true if a match of @p regExp may contain a line break, e.g.
+     * because of \\s, a negated character class or '.' matching everything.
+     * This errs on the side of true for patterns it cannot tell.
+     */
+    static bool canMatchLineBreak(const QRegularExpression &regExp);
+
+private:
+    struct Line {
+        Signature signature;
+        bool wrapped;
+    };
+
+    std::deque<Line> _lines;
+
+    // the last two characters of the last added line, for the trigrams
+    // which span the break of a wrapped line; _tailLength is -1 if they
+    // are unknown because the last line was removed
+    uint _tail[2];
+    int _tailLength;
+    bool _lastLineWrapped;
+
+    // true if the oldest indexed line continues a line which is not indexed
+    bool _firstLineContinues;
+};
+
+}
+
+#endif // HISTORYSEARCHINDEX_H
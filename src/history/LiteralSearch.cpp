@@ -0,0 +1,212 @@
+/*
+    SPDX-FileCopyrightText: 2022 Konsole Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+// Own
+#include "LiteralSearch.h"
+
+// Qt
+#include <QtAlgorithms>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// STD
+#include <algorithm>
+
+// Konsole
+#include "../decoders/PlainTextDecoder.h"
+
+using namespace Konsole;
+
+static inline uint foldCase(uint character)
+{
+    if (character < 0x80) {
+        return (character >= 'A' && character <= 'Z') ? character + ('a' - 'A') : character;
+    }
+    return QChar::toCaseFolded(character);
+}
+
+LiteralSearch::LiteralSearch(const QRegularExpression &regExp)
+    : _literal(literal(regExp).toUcs4())
+    , _caseInsensitive(regExp.patternOptions().testFlag(QRegularExpression::CaseInsensitiveOption))
+{
+    if (_caseInsensitive) {
+        std::transform(_literal.begin(), _literal.end(), _literal.begin(), foldCase);
+    }
+}
+
+bool LiteralSearch::isValid() const
+{
+    return !_literal.isEmpty();
+}
+
+void LiteralSearch::clear()
+{
+    _text.clear();
+}
+
+void LiteralSearch::appendLine(const Character cells[], int count)
+{
+    // the text the PlainTextDecoder produces when the line is copied out
+    // of the history, so that the same text is searched
+    PlainTextDecoder::decodeCharacters(cells, count, 0, count, [this](uint character) {
+        _text.append(_caseInsensitive ? foldCase(character) : character);
+    });
+}
+
+void LiteralSearch::appendLineBreak()
+{
+    _text.append('\n');
+}
+
+int LiteralSearch::textLength() const
+{
+    return _text.size();
+}
+
+bool LiteralSearch::matchesAt(int position) const
+{
+    return std::equal(_literal.cbegin(), _literal.cend(), _text.cbegin() + position);
+}
+
+int LiteralSearch::indexIn() const
+{
+    if (!isValid()) {
+        return -1;
+    }
+
+    const uint *text = _text.constData();
+    const int length = _literal.size();
+    const int lastStart = _text.size() - length;
+    const uint first = _literal.first();
+    const uint last = _literal.last();
+
+    int i = 0;
+#if defined(__SSE2__)
+    // compare the first and last code point of the literal with the ones of
+    // four possible matches at once
+    const __m128i firstVector = _mm_set1_epi32(int(first));
+    const __m128i lastVector = _mm_set1_epi32(int(last));
+    for (; i + 3 <= lastStart; i += 4) {
+        const __m128i starts = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text + i));
+        const __m128i ends = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text + i + length - 1));
+        const __m128i candidates = _mm_and_si128(_mm_cmpeq_epi32(starts, firstVector), _mm_cmpeq_epi32(ends, lastVector));
+        uint mask = uint(_mm_movemask_ps(_mm_castsi128_ps(candidates)));
+        while (mask != 0) {
+            const int position = i + int(qCountTrailingZeroBits(mask));
+            if (matchesAt(position)) {
+                return position;
+            }
+            mask &= mask - 1;
+        }
+    }
+#endif
+    for (; i <= lastStart; ++i) {
+        if (text[i] == first && text[i + length - 1] == last && matchesAt(i)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int LiteralSearch::lastIndexIn() const
+{
+    if (!isValid()) {
+        return -1;
+    }
+
+    const uint *text = _text.constData();
+    const int length = _literal.size();
+    const uint first = _literal.first();
+    const uint last = _literal.last();
+
+    int i = _text.size() - length;
+#if defined(__SSE2__)
+    // the same as indexIn(), with the four possible matches ending at i
+    const __m128i firstVector = _mm_set1_epi32(int(first));
+    const __m128i lastVector = _mm_set1_epi32(int(last));
+    for (; i >= 3; i -= 4) {
+        const __m128i starts = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text + i - 3));
+        const __m128i ends = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text + i - 3 + length - 1));
+        const __m128i candidates = _mm_and_si128(_mm_cmpeq_epi32(starts, firstVector), _mm_cmpeq_epi32(ends, lastVector));
+        uint mask = uint(_mm_movemask_ps(_mm_castsi128_ps(candidates)));
+        while (mask != 0) {
+            const int bit = 31 - int(qCountLeadingZeroBits(mask));
+            if (matchesAt(i - 3 + bit)) {
+                return i - 3 + bit;
+            }
+            mask &= ~(1u << bit);
+        }
+    }
+#endif
+    for (; i >= 0; --i) {
+        if (text[i] == first && text[i + length - 1] == last && matchesAt(i)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+QString LiteralSearch::literal(const QRegularExpression &regExp)
+{
+    // extended syntax ignores white space in the pattern
+    if (regExp.patternOptions().testFlag(QRegularExpression::ExtendedPatternSyntaxOption)) {
+        return QString();
+    }
+    // case insensitive matching of non ASCII characters is not necessarily
+    // the same as comparing their case folding
+    const bool asciiOnly = regExp.patternOptions().testFlag(QRegularExpression::CaseInsensitiveOption);
+
+    const auto isMetacharacter = [](uint character) {
+        switch (character) {
+        case '.':
+        case '^':
+        case '$':
+        case '|':
+        case '?':
+        case '*':
+        case '+':
+        case '(':
+        case ')':
+        case '[':
+        case ']':
+        case '{':
+        case '}':
+            return true;
+        default:
+            return false;
+        }
+    };
+
+    const QVector<uint> characters = regExp.pattern().toUcs4();
+    QVector<uint> literal;
+    literal.reserve(characters.size());
+    for (int i = 0; i < characters.size(); ++i) {
+        uint character = characters[i];
+        if (character == '\\') {
+            // an escaped character is a literal, unless it is a letter or
+            // digit, which makes it a character type, assertion, etc.
+            if (++i == characters.size()) {
+                return QString();
+            }
+            character = characters[i];
+            if ((character >= 'a' && character <= 'z') || (character >= 'A' && character <= 'Z') || (character >= '0' && character <= '9')) {
+                return QString();
+            }
+        } else if (isMetacharacter(character)) {
+            return QString();
+        }
+
+        // lines are separated with new-lines in the text
+        if (character == '\n' || (asciiOnly && character > 0x7f)) {
+            return QString();
+        }
+        literal.append(character);
+    }
+
+    return QString::fromUcs4(literal.constData(), literal.size());
+}
@@ -0,0 +1,89 @@
+/*
+    SPDX-FileCopyrightText: 2022 Konsole Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef LITERALSEARCH_H
+#define LITERALSEARCH_H
+
+// Qt
+#include <QRegularExpression>
+#include <QString>
+#include <QVector>
+
+// Konsole
+#include "../characters/Character.h"
+#include "konsoleprivate_export.h"
+
+namespace Konsole
+{
+/**
+ * Searches the text of lines for a plain string, without a regular
+ * expression.
+ *
+ * The text is appended as the code points of the cells of each line, so
+ * that it does not have to be decoded into a QString.  Most searches are
+ * for a plain string, case sensitive or not, which is found by comparing
+ * the first and last code point of the string with four positions of the
+ * text at once, and only comparing the whole string where both match.
+ */
+class KONSOLEPRIVATE_EXPORT LiteralSearch
+{
+public:
+    /**
+     * Prepares searching for what @p regExp matches, if that is a plain
+     * string; see isValid().
+     */
+    explicit LiteralSearch(const QRegularExpression &regExp = QRegularExpression());
+
+    /**
+     * Returns false if the regular expression is not a plain string, in
+     * which case the text has to be searched with the regular expression.
+     */
+    bool isValid() const;
+
+    /** Clears the text to search */
+    void clear();
+
+    /**
+     * Appends the text of a line to the text to search, the same text the
+     * PlainTextDecoder produces for the line.  A line which continues a
+     * wrapped line is appended right after it.
+     *
+     * @param cells The cells of the line
+     * @param count The number of cells
+     */
+    void appendLine(const Character cells[], int count);
+
+    /** Appends a line break, which no match spans */
+    void appendLineBreak();
+
+    /** Returns the length of the text, in code points */
+    int textLength() const;
+
+    /** Returns the position of the first match in the text, or -1 if there is none */
+    int indexIn() const;
+
+    /** Returns the position of the last match in the text, or -1 if there is none */
+    int lastIndexIn() const;
+
+    /**
+     * Returns the string which @p regExp matches, or an empty string if it
+     * is not a plain string, i.e. if it has an unescaped metacharacter,
+     * a character type, or options which change how it matches.
+     */
+    static QString literal(const QRegularExpression &regExp);
+
+private:
+    // returns true if the string matches the text at position
+    bool matchesAt(int position) const;
+
+    QVector<uint> _literal; // case folded if _caseInsensitive
+    bool _caseInsensitive;
+    QVector<uint> _text; // case folded if _caseInsensitive
+};
+
+}
+
+#endif // LITERALSEARCH_H
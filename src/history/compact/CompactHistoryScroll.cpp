@@ -9,10 +9,27 @@
 #include "CompactHistoryScroll.h"
 #include "CompactHistoryType.h"
 
+// Qt
+#include <QVarLengthArray>
+
+// Standard
+#include <cstring>
+#include <functional>
+
 using namespace Konsole;
 
+// Size of the chunks lines are stored in
+static const unsigned int CHUNK_SIZE = 64 * 1024;
+
+// Number of attributes below which the attribute table is not compacted
+static const int MIN_COMPACTED_ATTRIBUTES = 1024;
+
 CompactHistoryScroll::CompactHistoryScroll(const unsigned int maxLineCount)
     : HistoryScroll(new CompactHistoryType(maxLineCount))
+    , _firstChunk(0)
+    , _firstLine(0)
+    , _lineCount(0)
+    , _compactedAttributeCount(0)
     , _maxLineCount(0)
 {
     setMaxNbLines(maxLineCount);
@@ -20,54 +37,200 @@ CompactHistoryScroll::CompactHistoryScroll(const unsigned int maxLineCount)
 
 void CompactHistoryScroll::removeLinesFromTop(size_t lines)
 {
-    if (_lineDatas.size() > 1) {
-        const unsigned int removing = _lineDatas.at(lines - 1).index;
-        _lineDatas.erase(_lineDatas.begin(), _lineDatas.begin() + lines);
+    if (lines >= _lineCount) {
+        _chunks.clear();
+        _firstChunk = 0;
+        _firstLine = 0;
+        _lineCount = 0;
+        _attributes.clear();
+        _compactedAttributeCount = 0;
+        return;
+    }
 
-        _cells.erase(_cells.begin(), _cells.begin() + (removing - _indexBias));
-        _indexBias = removing;
-    } else {
-        _lineDatas.clear();
-        _cells.clear();
+    for (size_t i = 0; i < lines; ++i) {
+        // lines are added in order, so the oldest line is always in the first chunk
+        Q_ASSERT(lineData(0).chunk == _firstChunk);
+        if (--_chunks.front().lineCount == 0) {
+            _chunks.pop_front();
+            _firstChunk++;
+        }
+
+        if (++_firstLine == _lineDatas.size()) {
+            _firstLine = 0;
+        }
+        _lineCount--;
     }
+
+    compactAttributes();
 }
 
-void CompactHistoryScroll::addCells(const Character a[], const int count)
+void CompactHistoryScroll::compactAttributes()
 {
-    _cells.insert(_cells.end(), a, a + count);
+    if (_attributes.size() < qMax(2 * _compactedAttributeCount, MIN_COMPACTED_ATTRIBUTES)) {
+        return;
+    }
 
-    // store the (biased) start of next line + default flag
-    // the flag is later updated when addLine is called
-    _lineDatas.push_back({static_cast<unsigned int>(_cells.size() + _indexBias), LINE_DEFAULT});
+    // the runs keep the place holder flag next to the attribute index
+    const auto forEachRun = [this](const std::function<void(AttributeRun &)> &function) {
+        for (size_t line = 0; line < _lineCount; ++line) {
+            const LineData &data = lineData(line);
+            char *runs = _chunks[data.chunk - _firstChunk].data.get() + data.offset;
+            for (unsigned int i = 0; i < data.runCount; ++i) {
+                AttributeRun run;
+                memcpy(&run, runs + i * sizeof(AttributeRun), sizeof(AttributeRun));
+                function(run);
+                memcpy(runs + i * sizeof(AttributeRun), &run, sizeof(AttributeRun));
+            }
+        }
+    };
 
-    if (_lineDatas.size() > _maxLineCount + 5) {
-        removeLinesFromTop(5);
+    QVector<bool> used(_attributes.size(), false);
+    forEachRun([&used](AttributeRun &run) {
+        used[PackedCharacter::fromPacked(0, run.attributes).attributeIndex()] = true;
+    });
+
+    const QVector<quint32> newIndexes = _attributes.compact(used);
+    forEachRun([&newIndexes](AttributeRun &run) {
+        const quint32 index = PackedCharacter::fromPacked(0, run.attributes).attributeIndex();
+        run.attributes = newIndexes.at(index) | (run.attributes ^ index);
+    });
+
+    _compactedAttributeCount = _attributes.size();
+}
+
+void CompactHistoryScroll::setLineCapacity(size_t capacity)
+{
+    Q_ASSERT(capacity >= _lineCount);
+
+    std::vector<LineData> lineDatas;
+    lineDatas.reserve(capacity);
+    for (size_t i = 0; i < _lineCount; ++i) {
+        lineDatas.push_back(lineData(i));
     }
+    lineDatas.resize(capacity);
+
+    _lineDatas = std::move(lineDatas);
+    _firstLine = 0;
 }
 
-void CompactHistoryScroll::addCellsMove(Character characters[], const int count)
+void CompactHistoryScroll::appendLine(const Character cells[], const int count, const LineProperty flag)
 {
-    std::move(characters, characters + count, std::back_inserter(_cells));
+    QVarLengthArray<AttributeRun, 16> runs;
+    bool wideText = false;
+    for (int i = 0; i < count; ++i) {
+        const quint32 attributes = PackedCharacter(cells[i], _attributes).packedAttributes();
+        if (!runs.isEmpty() && runs.last().attributes == attributes) {
+            runs.last().length++;
+        } else {
+            runs.append(AttributeRun{attributes, 1});
+        }
+        wideText = wideText || cells[i].character > 0xff;
+    }
 
-    // store the (biased) start of next line + default flag
-    // the flag is later updated when addLine is called
-    _lineDatas.push_back({static_cast<unsigned int>(_cells.size() + _indexBias), LINE_DEFAULT});
+    // find room for the line, in a new chunk if needed
+    const unsigned int runsSize = runs.size() * sizeof(AttributeRun);
+    const unsigned int size = runsSize + count * (wideText ? sizeof(uint) : sizeof(char));
+    if (_chunks.empty() || _chunks.back().size - _chunks.back().used < size) {
+        const unsigned int chunkSize = qMax(size, CHUNK_SIZE);
+        _chunks.push_back({std::unique_ptr<char[]>(new char[chunkSize]), chunkSize, 0, 0});
+    }
+    Chunk &chunk = _chunks.back();
+
+    char *out = chunk.data.get() + chunk.used;
+    memcpy(out, runs.constData(), runsSize);
+    out += runsSize;
+    if (wideText) {
+        for (int i = 0; i < count; ++i) {
+            memcpy(out + i * sizeof(uint), &cells[i].character, sizeof(uint));
+        }
+    } else {
+        for (int i = 0; i < count; ++i) {
+            out[i] = static_cast<char>(cells[i].character);
+        }
+    }
 
-    if (_lineDatas.size() > _maxLineCount + 5) {
-        removeLinesFromTop(5);
+    if (_lineCount == _lineDatas.size()) {
+        // grow geometrically, but not beyond what a full history needs
+        size_t capacity = qMax(2 * _lineCount, size_t(64));
+        if (_lineCount <= _maxLineCount) {
+            capacity = qMin(capacity, _maxLineCount + 1);
+        }
+        setLineCapacity(capacity);
+    }
+    _lineCount++;
+    lineData(_lineCount - 1) = {static_cast<unsigned int>(_firstChunk + _chunks.size() - 1),
+                                chunk.used,
+                                static_cast<unsigned int>(count),
+                                static_cast<unsigned int>(runs.size()),
+                                wideText,
+                                flag};
+
+    chunk.used += size;
+    chunk.lineCount++;
+}
+
+void CompactHistoryScroll::decodeLine(const LineData &line, const int startColumn, const int count, Character buffer[]) const
+{
+    const char *runs = _chunks[line.chunk - _firstChunk].data.get() + line.offset;
+    const char *text = runs + line.runCount * sizeof(AttributeRun);
+
+    // skip the runs before startColumn
+    unsigned int run = 0;
+    AttributeRun current;
+    memcpy(&current, runs, sizeof(AttributeRun));
+    int runStart = 0;
+    while (runStart + int(current.length) <= startColumn) {
+        runStart += current.length;
+        run++;
+        memcpy(&current, runs + run * sizeof(AttributeRun), sizeof(AttributeRun));
+    }
+
+    int column = startColumn;
+    const int endColumn = startColumn + count;
+    while (column < endColumn) {
+        Character format = PackedCharacter::fromPacked(0, current.attributes).unpack(_attributes);
+        const int runEnd = qMin(runStart + int(current.length), endColumn);
+        for (; column < runEnd; ++column) {
+            if (line.wideText) {
+                memcpy(&format.character, text + column * sizeof(uint), sizeof(uint));
+            } else {
+                format.character = static_cast<uchar>(text[column]);
+            }
+            *buffer++ = format;
+        }
+
+        runStart += current.length;
+        if (++run < line.runCount) {
+            memcpy(&current, runs + run * sizeof(AttributeRun), sizeof(AttributeRun));
+        }
     }
 }
 
+void CompactHistoryScroll::addCells(const Character a[], const int count)
+{
+    // the flag is later updated when addLine is called
+    appendLine(a, count, LINE_DEFAULT);
+}
+
+void CompactHistoryScroll::addCellsMove(Character characters[], const int count)
+{
+    // cells are encoded on the way in, so there is nothing to gain from moving them
+    addCells(characters, count);
+}
 
 void CompactHistoryScroll::addLine(const LineProperty lineProperty)
 {
-    auto &flag = _lineDatas.back().flag;
+    auto &flag = lineData(_lineCount - 1).flag;
     flag = lineProperty;
+
+    if (_lineCount > _maxLineCount) {
+        removeLinesFromTop(_lineCount - _maxLineCount);
+    }
 }
 
 int CompactHistoryScroll::getLines() const
 {
-    return _lineDatas.size();
+    return _lineCount;
 }
 
 int CompactHistoryScroll::getMaxLines() const
@@ -77,11 +240,11 @@ int CompactHistoryScroll::getMaxLines() const
 
 int CompactHistoryScroll::getLineLen(int lineNumber) const
 {
-    if (size_t(lineNumber) >= _lineDatas.size()) {
+    if (size_t(lineNumber) >= _lineCount) {
         return 0;
     }
 
-    return lineLen(lineNumber);
+    return lineData(lineNumber).length;
 }
 
 void CompactHistoryScroll::getCells(const int lineNumber, const int startColumn, const int count, Character buffer[]) const
@@ -89,14 +252,12 @@ void CompactHistoryScroll::getCells(const int lineNumber, const int startColumn,
     if (count == 0) {
         return;
     }
-    Q_ASSERT((size_t)lineNumber < _lineDatas.size());
+    Q_ASSERT((size_t)lineNumber < _lineCount);
 
     Q_ASSERT(startColumn >= 0);
-    Q_ASSERT(startColumn <= lineLen(lineNumber) - count);
+    Q_ASSERT(startColumn <= getLineLen(lineNumber) - count);
 
-    auto startCopy = _cells.begin() + startOfLine(lineNumber) + startColumn;
-    auto endCopy = startCopy + count;
-    std::copy(startCopy, endCopy, buffer);
+    decodeLine(lineData(lineNumber), startColumn, count, buffer);
 }
 
 void CompactHistoryScroll::setMaxNbLines(const int lineCount)
@@ -104,75 +265,74 @@ void CompactHistoryScroll::setMaxNbLines(const int lineCount)
     Q_ASSERT(lineCount >= 0);
     _maxLineCount = lineCount;
 
-    if (_lineDatas.size() > _maxLineCount) {
-        int linesToRemove = _lineDatas.size() - _maxLineCount;
-        removeLinesFromTop(linesToRemove);
+    if (_lineCount > _maxLineCount) {
+        removeLinesFromTop(_lineCount - _maxLineCount);
+    }
+    if (_lineDatas.size() > _maxLineCount + 1) {
+        setLineCapacity(qMax(_lineCount, _maxLineCount + 1));
     }
 }
 
 void CompactHistoryScroll::removeCells()
 {
-    if (_lineDatas.size() > 1) {
+    if (_lineCount > 1) {
         /** Here we remove a line from the "end" of the buffers **/
-
-        // Get last line start
-        int lastLineStart = startOfLine(_lineDatas.size() - 1);
-
-        // remove info about this line
-        _lineDatas.pop_back();
-
-        // remove the actual line content
-        _cells.erase(_cells.begin() + lastLineStart, _cells.end());
+        const LineData &line = lineData(_lineCount - 1);
+        Q_ASSERT(line.chunk == _firstChunk + _chunks.size() - 1);
+        Chunk &chunk = _chunks.back();
+        chunk.used = line.offset;
+        if (--chunk.lineCount == 0) {
+            _chunks.pop_back();
+        }
+        _lineCount--;
     } else {
-        _cells.clear();
-        _lineDatas.clear();
+        removeLinesFromTop(_lineCount);
     }
 }
 
 bool CompactHistoryScroll::isWrappedLine(const int lineNumber) const
 {
-    Q_ASSERT((size_t)lineNumber < _lineDatas.size());
-    return (_lineDatas.at(lineNumber).flag & LINE_WRAPPED) > 0;
+    Q_ASSERT((size_t)lineNumber < _lineCount);
+    return (lineData(lineNumber).flag & LINE_WRAPPED) > 0;
 }
 
 LineProperty CompactHistoryScroll::getLineProperty(const int lineNumber) const
 {
-    Q_ASSERT((size_t)lineNumber < _lineDatas.size());
-    return _lineDatas.at(lineNumber).flag;
+    Q_ASSERT((size_t)lineNumber < _lineCount);
+    return lineData(lineNumber).flag;
 }
 
 int CompactHistoryScroll::reflowLines(const int columns)
 {
-    std::vector<LineData> newLineData;
-
-    auto reflowLineLen = [](int start, int end) {
-        return end - start;
-    };
-    auto setNewLine = [](std::vector<LineData> &change, unsigned int index, LineProperty flag) {
-        change.push_back({index, flag});
-    };
+    QVector<Character> joined;
 
-    int currentPos = 0;
-    while (currentPos < getLines()) {
-        int startLine = startOfLine(currentPos);
-        int endLine = startOfLine(currentPos + 1);
-        LineProperty lineProperty = getLineProperty(currentPos);
+    // The reflowed lines are appended while the old ones are dropped from the
+    // top, so chunks are released as we go
+    size_t oldLines = _lineCount;
+    while (oldLines > 0) {
+        LineProperty lineProperty = getLineProperty(0);
 
         // Join the lines if they are wrapped
-        while (currentPos < getLines() - 1 && isWrappedLine(currentPos)) {
-            currentPos++;
-            endLine = startOfLine(currentPos + 1);
+        int joinedLines = 1;
+        joined.resize(getLineLen(0));
+        getCells(0, 0, joined.size(), joined.data());
+        while (size_t(joinedLines) < oldLines && isWrappedLine(joinedLines - 1)) {
+            const int joinedLength = joined.size();
+            joined.resize(joinedLength + getLineLen(joinedLines));
+            getCells(joinedLines, 0, getLineLen(joinedLines), joined.data() + joinedLength);
+            joinedLines++;
         }
+        removeLinesFromTop(joinedLines);
+        oldLines -= joinedLines;
 
         // Now reflow the lines
-        while (reflowLineLen(startLine, endLine) > columns && !(lineProperty & (LINE_DOUBLEHEIGHT_BOTTOM | LINE_DOUBLEHEIGHT_TOP))) {
+        int startLine = 0;
+        while (joined.size() - startLine > columns && !(lineProperty & (LINE_DOUBLEHEIGHT_BOTTOM | LINE_DOUBLEHEIGHT_TOP))) {
+            appendLine(joined.constData() + startLine, columns, lineProperty | LINE_WRAPPED);
             startLine += columns;
-            setNewLine(newLineData, startLine + _indexBias, lineProperty | LINE_WRAPPED);
         }
-        setNewLine(newLineData, endLine + _indexBias, lineProperty & ~LINE_WRAPPED);
-        currentPos++;
+        appendLine(joined.constData() + startLine, joined.size() - startLine, lineProperty & ~LINE_WRAPPED);
     }
-    _lineDatas = std::move(newLineData);
 
     int deletedLines = 0;
     size_t totalLines = getLines();
@@ -180,6 +340,14 @@ int CompactHistoryScroll::reflowLines(const int columns)
         deletedLines = totalLines - _maxLineCount;
         removeLinesFromTop(deletedLines);
     }
+    if (_lineDatas.size() > _maxLineCount + 1) {
+        setLineCapacity(_maxLineCount + 1);
+    }
 
     return deletedLines;
 }
+
+int CompactHistoryScroll::attributeCount() const
+{
+    return _attributes.size();
+}
@@ -8,16 +8,17 @@
 #ifndef COMPACTHISTORYSCROLL_H
 #define COMPACTHISTORYSCROLL_H
 
+#include "characters/PackedCharacter.h"
 #include "history/HistoryScroll.h"
 #include "konsoleprivate_export.h"
 #include <deque>
+#include <memory>
+#include <vector>
 
 namespace Konsole
 {
 class KONSOLEPRIVATE_EXPORT CompactHistoryScroll final : public HistoryScroll
 {
-    typedef QVector<Character> TextLine;
-
 public:
     explicit CompactHistoryScroll(const unsigned int maxLineCount = 1000);
     ~CompactHistoryScroll() override = default;
@@ -39,38 +40,76 @@ public:
 
     int reflowLines(const int columns) override;
 
+    /** Returns the number of distinct colors and renditions kept for the lines */
+    int attributeCount() const;
+
 private:
     /**
-     * This is the actual buffer that contains the cells
+     * A history line is stored as a list of attribute runs followed by the
+     * text of the line.
+     *
+     * Each run gives the packed attributes (see PackedCharacter) of a number
+     * of consecutive cells. The text uses one byte per cell if all character
+     * values of the line fit in Latin-1, and four bytes per cell otherwise.
+     *
+     * History lines are mostly long runs of the same colors and rendition, so
+     * this is usually a lot smaller than storing a Character per cell.
      */
-    std::deque<Character> _cells;
+    struct AttributeRun {
+        quint32 attributes;
+        quint32 length;
+    };
 
     /**
-     * Each entry contains the start of the next line and the current line's
-     * properties.  The start of lines is biased by _indexBias, i.e. an index
-     * value of _indexBias corresponds to _cells' zero index.
-     *
-     * The use of a biased line start means we don't need to traverse the
-     * vector recalculating line starts when removing lines from the top, and
-     * also we don't need to traverse the vector to compute the start of a line
-     * as we would have to do if we stored line lengths.
-     *
-     * unsigned int means we're limited in common architectures to 4 million
-     * characters, but CompactHistoryScroll is limited by the UI to 1_000_000
-     * lines (see historyLineSpinner in src/widgets/HistorySizeWidget.ui), so
-     * enough for 1_000_000 lines of an average ~4295 length (and each
-     * Character takes 16 bytes, so that's 64Gb!).
+     * Lines are stored one after another in chunks of CHUNK_SIZE bytes (or a
+     * single larger chunk for a line which does not fit). A line never spans
+     * two chunks, so a chunk can be freed as soon as its last line is dropped
+     * from the top of the history.
+     */
+    struct Chunk {
+        std::unique_ptr<char[]> data;
+        unsigned int size;
+        unsigned int used;
+        unsigned int lineCount;
+    };
+
+    /**
+     * Where a line is stored, and its properties. @c chunk is the sequence
+     * number of the chunk; the chunk itself is _chunks[chunk - _firstChunk].
      */
     struct LineData {
-        unsigned int index;
+        unsigned int chunk;
+        unsigned int offset;
+        unsigned int length;
+        unsigned int runCount;
+        bool wideText;
         LineProperty flag;
     };
+
+    std::deque<Chunk> _chunks;
+    unsigned int _firstChunk;
+
     /**
-     * This buffer contains the data about each line
-     * The size of this buffer is the number of lines we have.
+     * This circular buffer contains the data about each line. The oldest
+     * line is at _firstLine and there are _lineCount lines in use.
+     *
+     * It grows as lines are added, up to one more than the max number of
+     * lines, and is not reallocated once the history is full: appending a
+     * line and dropping the oldest one are both constant time.
      */
     std::vector<LineData> _lineDatas;
-    unsigned int _indexBias;
+    size_t _firstLine;
+    size_t _lineCount;
+
+    /**
+     * Colors and renditions referenced by the attribute runs
+     */
+    CharacterAttributeTable _attributes;
+
+    /**
+     * Size of _attributes when it was last compacted
+     */
+    int _compactedAttributeCount;
 
     /**
      * Max number of lines we can hold
@@ -82,19 +121,39 @@ private:
      */
     void removeLinesFromTop(size_t lines);
 
-    inline int lineLen(const int line) const
-    {
-        return line == 0 ? _lineDatas.at(0).index - _indexBias : _lineDatas.at(line).index - _lineDatas.at(line - 1).index;
-    }
+    /**
+     * Drop the attributes which are no longer used by any line, once the
+     * table doubled in size since it was last compacted
+     */
+    void compactAttributes();
 
     /**
-     * Get the start of @p line in _cells buffer
-     *
-     * index actually contains the start of the next line.
+     * Reallocate the line buffer with room for @p capacity lines
      */
-    inline int startOfLine(const int line) const
+    void setLineCapacity(size_t capacity);
+
+    /**
+     * Encode @p count cells starting at @p cells as a new last line
+     */
+    void appendLine(const Character cells[], const int count, const LineProperty flag);
+
+    /**
+     * Decode @p count cells of @p line, starting at @p startColumn
+     */
+    void decodeLine(const LineData &line, const int startColumn, const int count, Character buffer[]) const;
+
+    inline const LineData &lineData(const int line) const
+    {
+        size_t index = _firstLine + line;
+        if (index >= _lineDatas.size()) {
+            index -= _lineDatas.size();
+        }
+        return _lineDatas[index];
+    }
+
+    inline LineData &lineData(const int line)
     {
-        return line == 0 ? 0 : _lineDatas.at(line - 1).index - _indexBias;
+        return const_cast<LineData &>(static_cast<const CompactHistoryScroll *>(this)->lineData(line));
     }
 };
 
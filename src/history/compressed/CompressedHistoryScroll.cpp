@@ -0,0 +1,330 @@
+/*
+    SPDX-FileCopyrightText: 2022 Konsole Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+// Own
+#include "CompressedHistoryScroll.h"
+#include "CompressedHistoryType.h"
+
+// Konsole
+#include "konsoledebug.h"
+
+// Standard
+#include <cstring>
+#include <type_traits>
+
+using namespace Konsole;
+
+// Number of lines in a compressed block
+static const int BLOCK_LINES = 256;
+
+// Number of decompressed blocks kept in memory
+static const int BLOCK_CACHE_SIZE = 16;
+
+// zlib compression level; favour speed, history text compresses well anyway
+static const int COMPRESSION_LEVEL = 1;
+
+CompressedHistoryScroll::Block::Block()
+    : lineStarts({0})
+{
+}
+
+void CompressedHistoryScroll::Block::clear()
+{
+    lineStarts = {0};
+    lineProperties.clear();
+    cells.clear();
+    attributes.clear();
+}
+
+void CompressedHistoryScroll::Block::appendLine(const Character cells[], const int count, const LineProperty lineProperty)
+{
+    this->cells.reserve(this->cells.size() + count);
+    for (int i = 0; i < count; ++i) {
+        this->cells.append(PackedCharacter(cells[i], attributes));
+    }
+    lineStarts.append(this->cells.size());
+    lineProperties.append(lineProperty);
+}
+
+/*
+   Serialized block layout (native endianness, the file is never shared):
+
+     qint32                  number of lines (n)
+     qint32                  number of attributes (a)
+     qint32[n + 1]           lineStarts
+     LineProperty[n]         lineProperties
+     CharacterAttributes[a]  attributes
+     PackedCharacter[]       cells
+*/
+static_assert(std::is_trivially_copyable<CharacterAttributes>::value, "CharacterAttributes are serialized as is");
+
+QByteArray CompressedHistoryScroll::Block::serialize() const
+{
+    const qint32 lines = lineCount();
+    const QVector<CharacterAttributes> &entries = attributes.entries();
+    const qint32 attributeCount = entries.size();
+    QByteArray data;
+    data.reserve(2 * sizeof(qint32) + lineStarts.size() * sizeof(int) + lines * sizeof(LineProperty) + attributeCount * sizeof(CharacterAttributes)
+                 + cells.size() * sizeof(PackedCharacter));
+    data.append(reinterpret_cast<const char *>(&lines), sizeof(qint32));
+    data.append(reinterpret_cast<const char *>(&attributeCount), sizeof(qint32));
+    data.append(reinterpret_cast<const char *>(lineStarts.constData()), lineStarts.size() * sizeof(int));
+    data.append(reinterpret_cast<const char *>(lineProperties.constData()), lines * sizeof(LineProperty));
+    data.append(reinterpret_cast<const char *>(entries.constData()), attributeCount * sizeof(CharacterAttributes));
+    data.append(reinterpret_cast<const char *>(cells.constData()), cells.size() * sizeof(PackedCharacter));
+    return data;
+}
+
+bool CompressedHistoryScroll::Block::deserialize(const QByteArray &data)
+{
+    qint32 lines = 0;
+    qint32 attributeCount = 0;
+    if (data.size() < int(2 * sizeof(qint32))) {
+        return false;
+    }
+    memcpy(&lines, data.constData(), sizeof(qint32));
+    memcpy(&attributeCount, data.constData() + sizeof(qint32), sizeof(qint32));
+
+    if (lines < 0 || attributeCount < 0) {
+        return false;
+    }
+    const qint64 headerSize =
+        2 * sizeof(qint32) + qint64(lines + 1) * sizeof(int) + qint64(lines) * sizeof(LineProperty) + qint64(attributeCount) * sizeof(CharacterAttributes);
+    if (data.size() < headerSize) {
+        return false;
+    }
+    const char *in = data.constData() + 2 * sizeof(qint32);
+
+    lineStarts.resize(lines + 1);
+    memcpy(lineStarts.data(), in, lineStarts.size() * sizeof(int));
+    in += lineStarts.size() * sizeof(int);
+
+    lineProperties.resize(lines);
+    memcpy(lineProperties.data(), in, lines * sizeof(LineProperty));
+    in += lines * sizeof(LineProperty);
+
+    QVector<CharacterAttributes> entries(attributeCount);
+    memcpy(entries.data(), in, attributeCount * sizeof(CharacterAttributes));
+    in += attributeCount * sizeof(CharacterAttributes);
+
+    const int cellCount = lineStarts.last();
+    if (data.size() - headerSize != cellCount * qint64(sizeof(PackedCharacter))) {
+        return false;
+    }
+    cells.resize(cellCount);
+    memcpy(cells.data(), in, cellCount * sizeof(PackedCharacter));
+
+    // a cell referring to no attributes would be read out of bounds
+    for (const PackedCharacter &cell : qAsConst(cells)) {
+        if (cell.attributeIndex() >= quint32(attributeCount)) {
+            return false;
+        }
+    }
+    attributes.setEntries(entries);
+    return true;
+}
+
+CompressedHistoryScroll::CompressedHistoryScroll()
+    : HistoryScroll(new CompressedHistoryType())
+    , _cache(BLOCK_CACHE_SIZE)
+{
+}
+
+CompressedHistoryScroll::~CompressedHistoryScroll() = default;
+
+const CompressedHistoryScroll::Block *CompressedHistoryScroll::loadBlock(const int index) const
+{
+    if (Block *block = _cache.object(index)) {
+        return block;
+    }
+
+    const BlockLocation &location = _blocks.at(index);
+    QByteArray compressed(location.size, Qt::Uninitialized);
+    _file.get(compressed.data(), location.size, location.offset);
+
+    auto block = new Block();
+    if (!block->deserialize(qUncompress(compressed))) {
+        qCWarning(KonsoleDebug) << "Unable to read history block" << index;
+        delete block;
+        return &_emptyBlock;
+    }
+    _cache.insert(index, block);
+    return block;
+}
+
+const CompressedHistoryScroll::Block *CompressedHistoryScroll::lineBlock(const int lineNumber, int &line) const
+{
+    const int index = lineNumber / BLOCK_LINES;
+    line = lineNumber % BLOCK_LINES;
+    return index < _blocks.size() ? loadBlock(index) : &_current;
+}
+
+void CompressedHistoryScroll::flushBlock()
+{
+    const QByteArray compressed = qCompress(_current.serialize(), COMPRESSION_LEVEL);
+    _blocks.append(BlockLocation{_file.len(), compressed.size()});
+    _file.add(compressed.constData(), compressed.size());
+
+    // the newest lines are the most likely to be read back
+    _cache.insert(_blocks.size() - 1, new Block(std::move(_current)));
+    _current = Block();
+}
+
+int CompressedHistoryScroll::getLines() const
+{
+    return _blocks.size() * BLOCK_LINES + _current.lineCount();
+}
+
+int CompressedHistoryScroll::getMaxLines() const
+{
+    return getLines();
+}
+
+int CompressedHistoryScroll::getLineLen(const int lineNumber) const
+{
+    if (lineNumber < 0 || lineNumber >= getLines()) {
+        return 0;
+    }
+
+    int line;
+    const Block *block = lineBlock(lineNumber, line);
+    if (line >= block->lineCount()) {
+        return 0;
+    }
+    return block->lineStarts.at(line + 1) - block->lineStarts.at(line);
+}
+
+void CompressedHistoryScroll::getCells(const int lineNumber, const int startColumn, const int count, Character buffer[]) const
+{
+    if (count == 0) {
+        return;
+    }
+    Q_ASSERT(lineNumber < getLines());
+    Q_ASSERT(startColumn >= 0);
+    Q_ASSERT(startColumn <= getLineLen(lineNumber) - count);
+
+    int line;
+    const Block *block = lineBlock(lineNumber, line);
+    if (line >= block->lineCount()) {
+        return;
+    }
+    const PackedCharacter *cells = block->cells.constData() + block->lineStarts.at(line) + startColumn;
+    for (int i = 0; i < count; ++i) {
+        buffer[i] = cells[i].unpack(block->attributes);
+    }
+}
+
+bool CompressedHistoryScroll::isWrappedLine(const int lineNumber) const
+{
+    return (getLineProperty(lineNumber) & LINE_WRAPPED) > 0;
+}
+
+LineProperty CompressedHistoryScroll::getLineProperty(const int lineNumber) const
+{
+    if (lineNumber < 0 || lineNumber >= getLines()) {
+        return 0;
+    }
+
+    int line;
+    const Block *block = lineBlock(lineNumber, line);
+    return line < block->lineCount() ? block->lineProperties.at(line) : LineProperty(0);
+}
+
+void CompressedHistoryScroll::addCells(const Character a[], const int count)
+{
+    // the flag is later updated when addLine is called
+    _current.appendLine(a, count, LINE_DEFAULT);
+}
+
+void CompressedHistoryScroll::addLine(const LineProperty lineProperty)
+{
+    if (_current.lineCount() == 0) {
+        return;
+    }
+
+    _current.lineProperties.last() = lineProperty;
+    if (_current.lineCount() == BLOCK_LINES) {
+        flushBlock();
+    }
+}
+
+void CompressedHistoryScroll::removeCells()
+{
+    if (_current.lineCount() == 0) {
+        if (_blocks.isEmpty()) {
+            return;
+        }
+
+        // Make the last compressed block the current one again
+        const int index = _blocks.size() - 1;
+        _current = *loadBlock(index);
+        _cache.remove(index);
+        _file.removeLast(_blocks.last().offset);
+        _blocks.removeLast();
+        if (_current.lineCount() == 0) {
+            return;
+        }
+    }
+
+    _current.lineProperties.removeLast();
+    _current.lineStarts.removeLast();
+    _current.cells.resize(_current.lineStarts.last());
+}
+
+int CompressedHistoryScroll::reflowLines(const int columns)
+{
+    // As in HistoryScrollFile, only the last MAX_REFLOW_LINES lines are
+    // reflowed; start at a block boundary so the rest can be rewritten
+    const int firstBlock = qMax(0, getLines() - MAX_REFLOW_LINES) / BLOCK_LINES;
+
+    // the lines are unpacked, as each block has its own attributes
+    QVector<Character> cells;
+    QVector<int> lineStarts{0};
+    QVector<LineProperty> lineProperties;
+    for (int index = firstBlock; index <= _blocks.size(); ++index) {
+        const Block *block = index < _blocks.size() ? loadBlock(index) : &_current;
+        for (const PackedCharacter &cell : block->cells) {
+            cells.append(cell.unpack(block->attributes));
+        }
+        for (int line = 0; line < block->lineCount(); ++line) {
+            lineStarts.append(lineStarts.last() + block->lineStarts.at(line + 1) - block->lineStarts.at(line));
+            lineProperties.append(block->lineProperties.at(line));
+        }
+    }
+
+    if (firstBlock < _blocks.size()) {
+        _file.removeLast(_blocks.at(firstBlock).offset);
+        _blocks.resize(firstBlock);
+    }
+    _cache.clear();
+    _current.clear();
+
+    const int lineCount = lineProperties.size();
+    int currentPos = 0;
+    while (currentPos < lineCount) {
+        int startLine = lineStarts.at(currentPos);
+        int endLine = lineStarts.at(currentPos + 1);
+        LineProperty lineProperty = lineProperties.at(currentPos);
+
+        // Join the lines if they are wrapped
+        while (currentPos < lineCount - 1 && (lineProperties.at(currentPos) & LINE_WRAPPED)) {
+            currentPos++;
+            endLine = lineStarts.at(currentPos + 1);
+        }
+
+        // Now reflow the lines
+        while (endLine - startLine > columns && !(lineProperty & (LINE_DOUBLEHEIGHT_BOTTOM | LINE_DOUBLEHEIGHT_TOP))) {
+            _current.appendLine(cells.constData() + startLine, columns, LINE_DEFAULT);
+            addLine(lineProperty | LINE_WRAPPED);
+            startLine += columns;
+        }
+        _current.appendLine(cells.constData() + startLine, endLine - startLine, LINE_DEFAULT);
+        addLine(lineProperty & ~LINE_WRAPPED);
+        currentPos++;
+    }
+
+    return 0;
+}
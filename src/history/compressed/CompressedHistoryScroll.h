@@ -0,0 +1,116 @@
+/*
+    SPDX-FileCopyrightText: 2022 Konsole Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef COMPRESSEDHISTORYSCROLL_H
+#define COMPRESSEDHISTORYSCROLL_H
+
+#include "characters/PackedCharacter.h"
+#include "history/HistoryFile.h"
+#include "history/HistoryScroll.h"
+#include "konsoleprivate_export.h"
+
+// Qt
+#include <QCache>
+#include <QVector>
+
+namespace Konsole
+{
+/**
+ * File based history which stores its lines in compressed blocks.
+ *
+ * Lines are appended to an uncompressed block kept in memory. Once it holds
+ * BLOCK_LINES lines, the block is compressed and added to the history file.
+ * Reading a line from an older block decompresses the whole block, and the
+ * most recently used blocks are kept in a small cache.
+ *
+ * Each block has a CharacterAttributeTable of its own, which is stored and
+ * dropped along with it, so the colors of a long session never fill up a
+ * single table.
+ *
+ * Like HistoryScrollFile, the number of lines is unlimited.
+ */
+class KONSOLEPRIVATE_EXPORT CompressedHistoryScroll final : public HistoryScroll
+{
+public:
+    explicit CompressedHistoryScroll();
+    ~CompressedHistoryScroll() override;
+
+    int getLines() const override;
+    int getMaxLines() const override;
+    int getLineLen(const int lineNumber) const override;
+    void getCells(const int lineNumber, const int startColumn, const int count, Character buffer[]) const override;
+    bool isWrappedLine(const int lineNumber) const override;
+    LineProperty getLineProperty(const int lineNumber) const override;
+
+    void addCells(const Character a[], const int count) override;
+    void addCellsMove(Character a[], const int count) override
+    {
+        addCells(a, count);
+    }
+    void addLine(const LineProperty lineProperty = 0) override;
+
+    void removeCells() override;
+
+    int reflowLines(const int columns) override;
+
+private:
+    /**
+     * A number of consecutive lines. lineStarts has one more entry than there
+     * are lines: the end of the last line. The cells refer to the colors and
+     * renditions in attributes.
+     */
+    struct Block {
+        QVector<int> lineStarts;
+        QVector<LineProperty> lineProperties;
+        QVector<PackedCharacter> cells;
+        CharacterAttributeTable attributes;
+
+        Block();
+        int lineCount() const
+        {
+            return lineProperties.size();
+        }
+        void clear();
+        void appendLine(const Character cells[], const int count, const LineProperty lineProperty);
+        QByteArray serialize() const;
+        bool deserialize(const QByteArray &data);
+    };
+
+    /**
+     * Location of a compressed block in the history file
+     */
+    struct BlockLocation {
+        qint64 offset;
+        int size;
+    };
+
+    /**
+     * Returns the block which contains @p lineNumber, and the line within
+     * that block in @p line.
+     */
+    const Block *lineBlock(const int lineNumber, int &line) const;
+
+    /**
+     * Returns the compressed block @p index, reading it from the history file
+     * if it is not cached.
+     */
+    const Block *loadBlock(const int index) const;
+
+    /**
+     * Compresses the current block and adds it to the history file
+     */
+    void flushBlock();
+
+    mutable HistoryFile _file; // compressed blocks
+    QVector<BlockLocation> _blocks;
+    Block _current; // block being appended to, not in _file yet
+    mutable QCache<int, Block> _cache;
+    Block _emptyBlock;
+};
+
+}
+
+#endif
@@ -0,0 +1,54 @@
+/*
+    SPDX-FileCopyrightText: 2022 Konsole Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+// Own
+#include "CompressedHistoryType.h"
+
+#include "CompressedHistoryScroll.h"
+
+using namespace Konsole;
+
+// Reasonable line size
+static const int LINE_SIZE = 1024;
+
+CompressedHistoryType::CompressedHistoryType() = default;
+
+bool CompressedHistoryType::isEnabled() const
+{
+    return true;
+}
+
+int CompressedHistoryType::maximumLineCount() const
+{
+    return -1;
+}
+
+void CompressedHistoryType::scroll(std::unique_ptr<HistoryScroll> &old) const
+{
+    if (dynamic_cast<CompressedHistoryScroll *>(old.get()) != nullptr) {
+        return; // Unchanged.
+    }
+    auto newScroll = std::make_unique<CompressedHistoryScroll>();
+
+    Character line[LINE_SIZE];
+    int lines = (old != nullptr) ? old->getLines() : 0;
+    std::vector<Character> tmp_line;
+    for (int i = 0; i < lines; i++) {
+        int size = old->getLineLen(i);
+        if (size > LINE_SIZE) {
+            tmp_line.resize(size);
+            old->getCells(i, 0, size, tmp_line.data());
+            newScroll->addCells(tmp_line.data(), size);
+            newScroll->addLine(old->getLineProperty(i));
+        } else {
+            old->getCells(i, 0, size, line);
+            newScroll->addCells(line, size);
+            newScroll->addLine(old->getLineProperty(i));
+        }
+    }
+
+    old = std::move(newScroll);
+}
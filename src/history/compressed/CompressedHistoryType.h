@@ -0,0 +1,31 @@
+/*
+    SPDX-FileCopyrightText: 2022 Konsole Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef COMPRESSEDHISTORYTYPE_H
+#define COMPRESSEDHISTORYTYPE_H
+
+#include "history/HistoryType.h"
+#include "konsoleprivate_export.h"
+
+namespace Konsole
+{
+/**
+ * Unlimited history which is written to a temporary file in compressed blocks.
+ */
+class KONSOLEPRIVATE_EXPORT CompressedHistoryType : public HistoryType
+{
+public:
+    explicit CompressedHistoryType();
+
+    bool isEnabled() const override;
+    int maximumLineCount() const override;
+
+    void scroll(std::unique_ptr<HistoryScroll> &) const override;
+};
+
+}
+
+#endif
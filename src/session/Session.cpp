@@ -34,14 +34,15 @@
 #include <sessionadaptor.h>
 
 #include "Pty.h"
+#include "RenderScheduler.h"
 #include "SSHProcessInfo.h"
 #include "SessionManager.h"
 #include "ShellCommand.h"
 #include "Vt102Emulation.h"
 #include "ZModemDialog.h"
-#include "history/HistoryTypeFile.h"
 #include "history/HistoryTypeNone.h"
 #include "history/compact/CompactHistoryType.h"
+#include "history/compressed/CompressedHistoryType.h"
 #include "konsoledebug.h"
 #include "profile/Profile.h"
 #include "profile/ProfileManager.h"
@@ -336,6 +337,13 @@ void Session::addView(TerminalDisplay *widget)
 
     widget->setBracketedPasteMode(_emulation->programBracketedPasteMode());
 
+    // while the output arrives faster than it can be displayed, the view
+    // only follows it with its scroll bar
+    connect(_emulation, &Konsole::Emulation::outputBackloggedChanged, widget, &Konsole::TerminalDisplay::setOutputBacklogged);
+    connect(_emulation, &Konsole::Emulation::outputSkipped, widget, &Konsole::TerminalDisplay::updateScrollBar);
+
+    widget->setOutputBacklogged(_emulation->isOutputBacklogged());
+
     widget->setScreenWindow(_emulation->createWindow());
 
     _emulation->setCurrentTerminalDisplay(widget);
@@ -1608,7 +1616,7 @@ void Session::setHistorySize(int lines)
     }
 
     if (lines < 0) {
-        setHistoryType(HistoryTypeFile());
+        setHistoryType(CompressedHistoryType());
     } else if (lines == 0) {
         setHistoryType(HistoryTypeNone());
     } else {
@@ -1636,6 +1644,32 @@ QString Session::profile()
     return SessionManager::instance()->sessionProfile(this)->name();
 }
 
+QString Session::renderStatistics() const
+{
+    QStringList statistics;
+    for (TerminalDisplay *view : qAsConst(_views)) {
+        statistics << view->renderStatistics()->summary();
+    }
+    // the updates are scheduled for all sessions together
+    statistics << RenderScheduler::instance()->summary();
+    return statistics.join(QLatin1String("\n\n"));
+}
+
+void Session::resetRenderStatistics()
+{
+    for (TerminalDisplay *view : qAsConst(_views)) {
+        view->renderStatistics()->clear();
+    }
+    RenderScheduler::instance()->resetStatistics();
+}
+
+void Session::setRenderStatisticsVisible(bool visible)
+{
+    for (TerminalDisplay *view : qAsConst(_views)) {
+        view->setRenderStatisticsVisible(visible);
+    }
+}
+
 void Session::setProfile(const QString &profileName)
 {
     const QList<Profile::Ptr> profiles = ProfileManager::instance()->allProfiles();
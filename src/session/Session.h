@@ -641,6 +641,24 @@ public Q_SLOTS:
      */
     Q_SCRIPTABLE QString profile();
 
+    /**
+     * Returns a description of the time spent drawing the last frames of
+     * each of the session's views, see RenderStatistics, followed by the
+     * frame statistics of the RenderScheduler
+     */
+    Q_SCRIPTABLE QString renderStatistics() const;
+
+    /**
+     * Drops the render statistics of the session's views, and resets the
+     * frame statistics of the RenderScheduler, e.g. before a measurement
+     */
+    Q_SCRIPTABLE void resetRenderStatistics();
+
+    /**
+     * Shows or hides the render statistics overlay on the session's views
+     */
+    Q_SCRIPTABLE void setRenderStatisticsVisible(bool visible);
+
 Q_SIGNALS:
 
     /** Emitted when the terminal process starts. */
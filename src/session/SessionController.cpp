@@ -64,6 +64,7 @@
 #include "SaveHistoryTask.h"
 #include "ScreenWindow.h"
 #include "SearchHistoryTask.h"
+#include "SearchMatches.h"
 
 #include "filterHotSpots/ColorFilter.h"
 #include "filterHotSpots/EscapeSequenceUrlFilter.h"
@@ -72,13 +73,12 @@
 #include "filterHotSpots/Filter.h"
 #include "filterHotSpots/FilterChain.h"
 #include "filterHotSpots/HotSpot.h"
-#include "filterHotSpots/RegExpFilter.h"
 #include "filterHotSpots/UrlFilter.h"
 
 #include "history/HistoryType.h"
-#include "history/HistoryTypeFile.h"
 #include "history/HistoryTypeNone.h"
 #include "history/compact/CompactHistoryType.h"
+#include "history/compressed/CompressedHistoryType.h"
 
 #include "profile/ProfileList.h"
 
@@ -106,7 +106,7 @@ SessionController::SessionController(Session *sessionParam, TerminalDisplay *vie
     , _profileList(nullptr)
     , _sessionIcon(QIcon())
     , _sessionIconName(QString())
-    , _searchFilter(nullptr)
+    , _searchMatches(nullptr)
     , _urlFilter(nullptr)
     , _fileFilter(nullptr)
     , _colorFilter(nullptr)
@@ -591,15 +591,28 @@ void SessionController::toggleAllowMouseTracking(QAction *action)
     _sessionDisplayConnection->view()->setAllowMouseTracking(action->isChecked());
 }
 
-void SessionController::removeSearchFilter()
+void SessionController::addSearchMatches()
 {
-    if (_searchFilter == nullptr) {
+    if (_searchMatches != nullptr || _searchBar.isNull()) {
         return;
     }
 
-    view()->filterChain()->removeFilter(_searchFilter);
-    delete _searchFilter;
-    _searchFilter = nullptr;
+    _searchMatches = new SearchMatches(view()->screenWindow(), this);
+    _searchMatches->setRegExp(regexpFromSearchBarOptions());
+    view()->setSearchMatches(_searchMatches);
+}
+
+void SessionController::removeSearchMatches()
+{
+    if (_searchMatches == nullptr) {
+        return;
+    }
+
+    if (!view().isNull()) {
+        view()->setSearchMatches(nullptr);
+    }
+    delete _searchMatches;
+    _searchMatches = nullptr;
 }
 
 void SessionController::setupSearchBar()
@@ -1384,20 +1397,11 @@ void SessionController::listenForScreenWindowUpdates()
         return;
     }
 
-    connect(view()->screenWindow(), &Konsole::ScreenWindow::outputChanged, this, &Konsole::SessionController::updateSearchFilter);
-    connect(view()->screenWindow(), &Konsole::ScreenWindow::scrolled, this, &Konsole::SessionController::updateSearchFilter);
     connect(view()->screenWindow(), &Konsole::ScreenWindow::currentResultLineChanged, view(), QOverload<>::of(&Konsole::TerminalDisplay::update));
 
     _listenForScreenWindowUpdates = true;
 }
 
-void SessionController::updateSearchFilter()
-{
-    if ((_searchFilter != nullptr) && (!_searchBar.isNull())) {
-        view()->processFilters();
-    }
-}
-
 void SessionController::searchBarEvent()
 {
     QString selectedText = view()->screenWindow()->selectedText(Screen::PreserveLineBreaks | Screen::TrimLeadingWhitespace | Screen::TrimTrailingWhitespace);
@@ -1474,20 +1478,22 @@ void SessionController::searchHistory(bool showSearchBar)
 
     if (!_searchBar.isNull()) {
         if (showSearchBar) {
-            removeSearchFilter();
+            removeSearchMatches();
 
             listenForScreenWindowUpdates();
 
-            _searchFilter = new RegExpFilter();
-            _searchFilter->setRegExp(regexpFromSearchBarOptions());
-            view()->filterChain()->addFilter(_searchFilter);
-            view()->processFilters();
+            if (_searchBar->optionsChecked().at(IncrementalSearchBar::HighlightMatches)) {
+                addSearchMatches();
+            }
 
             setFindNextPrevEnabled(true);
         } else {
             setFindNextPrevEnabled(false);
 
-            removeSearchFilter();
+            if (_searchTask) {
+                _searchTask->cancel();
+            }
+            removeSearchMatches();
 
             view()->setFocus(Qt::ActiveWindowFocusReason);
         }
@@ -1527,13 +1533,21 @@ void SessionController::searchCompleted(bool success)
     }
 }
 
+void SessionController::searchProgress(int searchedLines, int totalLines)
+{
+    if (!_searchBar.isNull() && totalLines > 0) {
+        _searchBar->setSearchProgress(searchedLines * 100 / totalLines);
+    }
+}
+
 void SessionController::beginSearch(const QString &text, Enum::SearchDirection direction)
 {
     Q_ASSERT(_searchBar);
-    Q_ASSERT(_searchFilter);
 
     QRegularExpression regExp = regexpFromSearchBarOptions();
-    _searchFilter->setRegExp(regExp);
+    if (_searchMatches != nullptr) {
+        _searchMatches->setRegExp(regExp);
+    }
 
     if (_searchStartLine < 0 || _searchStartLine > view()->screenWindow()->lineCount()) {
         if (direction == Enum::ForwardsSearch) {
@@ -1543,11 +1557,18 @@ void SessionController::beginSearch(const QString &text, Enum::SearchDirection d
         }
     }
 
+    // a new search replaces the one in progress, e.g. when the user types on
+    if (_searchTask) {
+        _searchTask->cancel();
+    }
+
     if (!regExp.pattern().isEmpty()) {
         view()->screenWindow()->setCurrentResultLine(-1);
         auto task = new SearchHistoryTask(this);
+        _searchTask = task;
 
         connect(task, &Konsole::SearchHistoryTask::completed, this, &Konsole::SessionController::searchCompleted);
+        connect(task, &Konsole::SearchHistoryTask::progress, this, &Konsole::SessionController::searchProgress);
 
         task->setRegExp(regExp);
         task->setSearchDirection(direction);
@@ -1558,25 +1579,19 @@ void SessionController::beginSearch(const QString &text, Enum::SearchDirection d
     } else if (text.isEmpty()) {
         searchCompleted(false);
     }
-
-    view()->processFilters();
 }
 void SessionController::highlightMatches(bool highlight)
 {
     if (highlight) {
-        view()->filterChain()->addFilter(_searchFilter);
-        view()->processFilters();
+        addSearchMatches();
     } else {
-        view()->filterChain()->removeFilter(_searchFilter);
+        removeSearchMatches();
     }
-
-    view()->update();
 }
 
 void SessionController::searchFrom()
 {
     Q_ASSERT(_searchBar);
-    Q_ASSERT(_searchFilter);
 
     if (reverseSearchChecked()) {
         setSearchStartTo(view()->screenWindow()->lineCount());
@@ -1589,7 +1604,6 @@ void SessionController::searchFrom()
 void SessionController::findNextInHistory()
 {
     Q_ASSERT(_searchBar);
-    Q_ASSERT(_searchFilter);
 
     setSearchStartTo(_prevSearchResultLine);
 
@@ -1598,7 +1612,6 @@ void SessionController::findNextInHistory()
 void SessionController::findPreviousInHistory()
 {
     Q_ASSERT(_searchBar);
-    Q_ASSERT(_searchFilter);
 
     setSearchStartTo(_prevSearchResultLine);
 
@@ -1617,7 +1630,6 @@ void SessionController::updateMenuIconsAccordingToReverseSearchSetting()
 void SessionController::changeSearchMatch()
 {
     Q_ASSERT(_searchBar);
-    Q_ASSERT(_searchFilter);
 
     // reset Selection for new case match
     view()->screenWindow()->clearSelection();
@@ -1662,7 +1674,7 @@ void SessionController::scrollBackOptionsChanged(int mode, int lines)
         session()->setHistoryType(CompactHistoryType(lines));
         break;
     case Enum::UnlimitedHistory:
-        session()->setHistoryType(HistoryTypeFile());
+        session()->setHistoryType(CompressedHistoryType());
         break;
     }
 }
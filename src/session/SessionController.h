@@ -43,8 +43,9 @@ class FileFilter;
 class IncrementalSearchBar;
 class Profile;
 class ProfileList;
-class RegExpFilter;
 class ScreenWindow;
+class SearchHistoryTask;
+class SearchMatches;
 class Session;
 class SessionGroup;
 class TerminalDisplay;
@@ -272,6 +273,7 @@ private Q_SLOTS:
     void sessionReadOnlyChanged();
     void searchTextChanged(const QString &text);
     void searchCompleted(bool success);
+    void searchProgress(int searchedLines, int totalLines);
 
     void updateFilterList(
         const QExplicitlySharedDataPointer<Profile> &profile); // Called when the profile has changed, so we might need to change the list of filters
@@ -289,8 +291,6 @@ private Q_SLOTS:
     // when a key press occurs in the
     // display area
 
-    void updateSearchFilter();
-
     void zmodemDownload();
     void zmodemUpload();
 
@@ -310,7 +310,8 @@ private:
     bool reverseSearchChecked() const;
     void setupCommonActions();
     void setupExtraActions();
-    void removeSearchFilter(); // remove and delete the current search filter if set
+    void addSearchMatches(); // highlight all matches of the search bar's pattern
+    void removeSearchMatches(); // remove and delete the current search matches if set
     void setFindNextPrevEnabled(bool enabled);
     void listenForScreenWindowUpdates();
 
@@ -327,7 +328,7 @@ private:
     QIcon _sessionIcon;
     QString _sessionIconName;
 
-    RegExpFilter *_searchFilter;
+    SearchMatches *_searchMatches;
     UrlFilter *_urlFilter;
     FileFilter *_fileFilter;
     ColorFilter *_colorFilter;
@@ -366,6 +367,7 @@ private:
 
     QString _searchText;
     QPointer<IncrementalSearchBar> _searchBar;
+    QPointer<SearchHistoryTask> _searchTask; // the search in progress, if any
 
     QString _previousForegroundProcessName;
     bool _monitorProcessFinish;
@@ -26,9 +26,9 @@
 #include "Screen.h"
 #include "ShouldApplyProperty.h"
 
-#include "history/HistoryTypeFile.h"
 #include "history/HistoryTypeNone.h"
 #include "history/compact/CompactHistoryType.h"
+#include "history/compressed/CompressedHistoryType.h"
 
 #include "profile/ProfileCommandParser.h"
 #include "profile/ProfileManager.h"
@@ -258,7 +258,7 @@ void SessionManager::applyProfile(Session *session, const Profile::Ptr &profile,
         }
 
         case Enum::UnlimitedHistory:
-            session->setHistoryType(HistoryTypeFile());
+            session->setHistoryType(CompressedHistoryType());
             break;
         }
     }
@@ -0,0 +1,194 @@
+/*
+    SPDX-FileCopyrightText: 2022 Konsole Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+// Own
+#include "GlyphCache.h"
+
+// Konsole
+#include "../characters/Character.h"
+
+// Qt
+#include <QFontMetrics>
+#include <QImage>
+#include <QPainter>
+#include <QString>
+#include <QVarLengthArray>
+#include <QtMath>
+
+namespace Konsole
+{
+// The atlas is a grid of ATLAS_COLUMNS x ATLAS_ROWS slots
+static const int ATLAS_COLUMNS = 32;
+static const int ATLAS_ROWS = 16;
+
+// Glyphs can overhang their cell (italics, ambiguous width characters), so a
+// slot is three cells wide with the glyph drawn in the middle one
+static const int SLOT_CELLS = 3;
+
+// Returns true if the font may replace @p previous followed by @p character
+// with a ligature, such as "->" or "!=" in programming fonts
+static inline bool mayFormLigature(uint previous, uint character)
+{
+    const auto isSymbol = [](uint c) {
+        return c > ' ' && c < 0x7f && !QChar::isLetterOrNumber(c);
+    };
+    return isSymbol(previous) && isSymbol(character);
+}
+
+static inline uint fontStyle(const QFont &font)
+{
+    return (font.weight() << 4) | (font.italic() ? 1 : 0) | (font.underline() ? 2 : 0) | (font.strikeOut() ? 4 : 0) | (font.overline() ? 8 : 0);
+}
+
+// Returns true if text in @p font is drawn with subpixel antialiasing on an
+// opaque background, which is the case if a glyph drawn in black on white
+// has colored pixels
+static bool usesSubpixelAntialiasing(const QFont &font)
+{
+    if ((font.styleStrategy() & (QFont::NoAntialias | QFont::NoSubpixelAntialias)) != 0) {
+        return false;
+    }
+
+    const QFontMetrics metrics(font);
+    QImage image(2 * metrics.horizontalAdvance(QLatin1Char('W')) + 2, metrics.height() + 2, QImage::Format_RGB32);
+    image.fill(Qt::white);
+
+    QPainter painter(&image);
+    painter.setFont(font);
+    painter.setPen(Qt::black);
+    painter.drawText(1, 1 + metrics.ascent(), QStringLiteral("W"));
+    painter.end();
+
+    for (int y = 0; y < image.height(); ++y) {
+        const QRgb *line = reinterpret_cast<const QRgb *>(image.constScanLine(y));
+        for (int x = 0; x < image.width(); ++x) {
+            if (qRed(line[x]) != qGreen(line[x]) || qGreen(line[x]) != qBlue(line[x])) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void GlyphCache::setFont(const QFont &font, const QSize &cellSize, int baseline, qreal devicePixelRatio)
+{
+    if (font == _font && cellSize == _cellSize && baseline == _baseline && qFuzzyCompare(devicePixelRatio, _devicePixelRatio)) {
+        return;
+    }
+
+    clear();
+    _font = font;
+    _cellSize = cellSize;
+    _baseline = baseline;
+    _devicePixelRatio = devicePixelRatio;
+    _subpixelAntialiasing = usesSubpixelAntialiasing(font);
+}
+
+void GlyphCache::clear()
+{
+    _slots.clear();
+    _atlas = QPixmap();
+}
+
+void GlyphCache::resetCounters()
+{
+    _hits = 0;
+    _misses = 0;
+}
+
+QRect GlyphCache::slotRect(int slot) const
+{
+    const int width = SLOT_CELLS * _cellSize.width();
+    const int height = _cellSize.height();
+    return QRect((slot % ATLAS_COLUMNS) * width, (slot / ATLAS_COLUMNS) * height, width, height);
+}
+
+int GlyphCache::glyphSlot(const GlyphKey &key, const QFont &font)
+{
+    auto it = _slots.constFind(key);
+    if (it != _slots.constEnd()) {
+        ++_hits;
+        return it.value();
+    }
+    ++_misses;
+
+    if (_slots.size() == ATLAS_COLUMNS * ATLAS_ROWS) {
+        // Start over rather than track usage; a screen rarely needs more
+        // glyphs than fit in the atlas
+        _slots.clear();
+    }
+
+    if (_atlas.isNull()) {
+        const QSize size(ATLAS_COLUMNS * SLOT_CELLS * _cellSize.width(), ATLAS_ROWS * _cellSize.height());
+        _atlas = QPixmap(size * _devicePixelRatio);
+        _atlas.setDevicePixelRatio(_devicePixelRatio);
+        // the glyphs are drawn over any background, so the atlas has to be
+        // transparent, which limits them to grayscale antialiasing
+        _atlas.fill(Qt::transparent);
+    }
+
+    const int slot = _slots.size();
+    const QRect rect = slotRect(slot);
+
+    QPainter painter(&_atlas);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    painter.fillRect(rect, Qt::transparent);
+    painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+    painter.setClipRect(rect);
+    painter.setFont(font);
+    painter.setPen(QColor::fromRgba(key.color));
+    painter.setLayoutDirection(Qt::LeftToRight);
+    painter.drawText(rect.x() + _cellSize.width(), rect.y() + _baseline, QString::fromUcs4(&key.character, 1));
+
+    _slots.insert(key, slot);
+    return slot;
+}
+
+bool GlyphCache::drawText(QPainter &painter, const QPoint &position, const QString &text, const QColor &color)
+{
+    // Glyphs rasterized at a fractional scale would not line up with the
+    // pixel grid of the display, and the transparent atlas would lose
+    // subpixel antialiasing
+    if (_cellSize.isEmpty() || _devicePixelRatio != qFloor(_devicePixelRatio) || _subpixelAntialiasing) {
+        return false;
+    }
+
+    QVarLengthArray<uint, 256> characters;
+    for (int i = 0; i < text.size(); ++i) {
+        uint character = text.at(i).unicode();
+        if (QChar::isHighSurrogate(character) && i + 1 < text.size() && text.at(i + 1).isLowSurrogate()) {
+            character = QChar::surrogateToUcs4(text.at(i), text.at(i + 1));
+            ++i;
+        }
+
+        if (Character::width(character) != 1) {
+            return false;
+        }
+        if (!characters.isEmpty() && mayFormLigature(characters.last(), character)) {
+            return false;
+        }
+        characters.append(character);
+    }
+
+    const QFont &font = painter.font();
+    const bool hasDecoration = font.underline() || font.strikeOut() || font.overline();
+    GlyphKey key{0, color.rgba(), fontStyle(font)};
+
+    for (int i = 0; i < characters.size(); ++i) {
+        if (characters.at(i) == ' ' && !hasDecoration) {
+            continue;
+        }
+
+        key.character = characters.at(i);
+        const QRect source = slotRect(glyphSlot(key, font));
+        const QRectF sourcePixels(QPointF(source.topLeft()) * _devicePixelRatio, QSizeF(source.size()) * _devicePixelRatio);
+        painter.drawPixmap(QPointF(position.x() + (i - 1) * _cellSize.width(), position.y()), _atlas, sourcePixels);
+    }
+
+    return true;
+}
+
+}
@@ -0,0 +1,120 @@
+/*
+    SPDX-FileCopyrightText: 2022 Konsole Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef GLYPHCACHE_H
+#define GLYPHCACHE_H
+
+// Qt
+#include <QColor>
+#include <QFont>
+#include <QHash>
+#include <QPixmap>
+#include <QSize>
+
+class QPainter;
+class QPoint;
+class QString;
+
+namespace Konsole
+{
+/**
+ * Keeps the glyphs drawn by TerminalPainter in an atlas pixmap, so that each
+ * (character, font style, color) combination is only shaped and rasterized
+ * once, and then copied to the display for every cell which shows it.
+ *
+ * Only text with one glyph per cell can be drawn from the cache. Callers
+ * must fall back to QPainter::drawText() for anything else (wide or combining
+ * characters, possible ligatures, bidi text, scaled lines), which drawText()
+ * reports by returning false.
+ *
+ * The atlas is transparent, so glyphs rasterized into it can only have
+ * grayscale antialiasing.  Fonts which are drawn with subpixel antialiasing
+ * are therefore not cached at all, so that the text looks the same either
+ * way.
+ */
+class GlyphCache
+{
+public:
+    GlyphCache() = default;
+
+    /**
+     * Sets the font, cell size, baseline and device pixel ratio glyphs are
+     * rasterized for. The cached glyphs are dropped if any of them changed.
+     *
+     * drawText() draws nothing from the cache if @p font is drawn with
+     * subpixel antialiasing.
+     */
+    void setFont(const QFont &font, const QSize &cellSize, int baseline, qreal devicePixelRatio);
+
+    /**
+     * Draws @p text one glyph per cell, using the painter's current font,
+     * with the top left corner of the first cell at @p position.
+     *
+     * Returns false, without drawing anything, if @p text can not be drawn
+     * from the cache.
+     */
+    bool drawText(QPainter &painter, const QPoint &position, const QString &text, const QColor &color);
+
+    /** Drops all cached glyphs */
+    void clear();
+
+    /** Number of glyphs found in the cache since the last resetCounters() */
+    int hits() const
+    {
+        return _hits;
+    }
+
+    /** Number of glyphs rasterized into the cache since the last resetCounters() */
+    int misses() const
+    {
+        return _misses;
+    }
+
+    /** Resets hits() and misses() */
+    void resetCounters();
+
+private:
+    struct GlyphKey {
+        uint character;
+        QRgb color;
+        uint fontStyle;
+
+        friend bool operator==(const GlyphKey &a, const GlyphKey &b)
+        {
+            return a.character == b.character && a.color == b.color && a.fontStyle == b.fontStyle;
+        }
+
+        friend uint qHash(const GlyphKey &key, uint seed = 0)
+        {
+            return (key.character * 31 + key.color) * 31 + key.fontStyle + seed;
+        }
+    };
+
+    /**
+     * Returns the atlas slot holding the glyph for @p key, rasterizing it
+     * with @p font if needed.
+     */
+    int glyphSlot(const GlyphKey &key, const QFont &font);
+
+    // Area of a slot in the atlas, in logical pixels
+    QRect slotRect(int slot) const;
+
+    QPixmap _atlas;
+    QHash<GlyphKey, int> _slots;
+
+    QFont _font;
+    QSize _cellSize;
+    int _baseline = 0;
+    qreal _devicePixelRatio = 1;
+    bool _subpixelAntialiasing = false;
+
+    int _hits = 0;
+    int _misses = 0;
+};
+
+}
+
+#endif // GLYPHCACHE_H
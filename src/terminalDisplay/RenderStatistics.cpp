@@ -0,0 +1,85 @@
+/*
+    SPDX-FileCopyrightText: 2022 Konsole Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+// Own
+#include "RenderStatistics.h"
+
+using namespace Konsole;
+
+RenderStatistics::RenderStatistics()
+    : _nextFrame(0)
+{
+    _frames.reserve(HistorySize);
+}
+
+void RenderStatistics::finishFrame()
+{
+    if (_frames.size() < HistorySize) {
+        _frames.append(_currentFrame);
+    } else {
+        _frames[_nextFrame] = _currentFrame;
+    }
+    _nextFrame = (_nextFrame + 1) % HistorySize;
+    _currentFrame = Frame();
+}
+
+QVector<RenderStatistics::Frame> RenderStatistics::frames() const
+{
+    if (_frames.size() < HistorySize) {
+        return _frames;
+    }
+    return _frames.mid(_nextFrame) + _frames.mid(0, _nextFrame);
+}
+
+RenderStatistics::Frame RenderStatistics::lastFrame() const
+{
+    if (_frames.isEmpty()) {
+        return Frame();
+    }
+    return _frames.at((_nextFrame + HistorySize - 1) % HistorySize);
+}
+
+void RenderStatistics::clear()
+{
+    _currentFrame = Frame();
+    _frames.clear();
+    _nextFrame = 0;
+}
+
+QString RenderStatistics::summary() const
+{
+    const auto milliseconds = [](qint64 nanoseconds) {
+        return QString::number(nanoseconds / 1000000.0, 'f', 2);
+    };
+
+    const Frame last = lastFrame();
+    qint64 totalTime = 0;
+    Frame slowest;
+    for (const Frame &frame : _frames) {
+        totalTime += frame.totalTime();
+        if (frame.totalTime() > slowest.totalTime()) {
+            slowest = frame;
+        }
+    }
+    const qint64 averageTime = _frames.isEmpty() ? 0 : totalTime / _frames.size();
+
+    return QStringLiteral(
+               "last frame: %1 ms (update %2, filters %3, paint %4)\n"
+               "dirty lines %5, scrolled lines %6, fragments %7, drawText %8, glyph cache %9 hits / %10 misses\n"
+               "last %11 frames: average %12 ms, slowest %13 ms")
+        .arg(milliseconds(last.totalTime()),
+             milliseconds(last.updateImageTime),
+             milliseconds(last.filterTime),
+             milliseconds(last.paintTime),
+             QString::number(last.dirtyLines),
+             QString::number(last.scrolledLines),
+             QString::number(last.fragments),
+             QString::number(last.drawTextCalls),
+             QString::number(last.glyphCacheHits))
+        .arg(last.glyphCacheMisses)
+        .arg(_frames.size())
+        .arg(milliseconds(averageTime), milliseconds(slowest.totalTime()));
+}
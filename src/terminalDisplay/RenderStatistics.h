@@ -0,0 +1,86 @@
+/*
+    SPDX-FileCopyrightText: 2022 Konsole Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef RENDERSTATISTICS_H
+#define RENDERSTATISTICS_H
+
+// Qt
+#include <QString>
+#include <QVector>
+
+// Konsole
+#include "konsoleprivate_export.h"
+
+namespace Konsole
+{
+/**
+ * Records how much work a TerminalDisplay did for each of its last frames,
+ * so that stutter can be attributed to updating the image, filtering or
+ * painting without attaching a profiler.
+ *
+ * The display adds to the counters of currentFrame() while it updates and
+ * paints, and calls finishFrame() at the end of each paint, which moves the
+ * frame into a ring buffer holding the last HistorySize frames.
+ */
+class KONSOLEPRIVATE_EXPORT RenderStatistics
+{
+public:
+    /** Number of finished frames which are kept */
+    static const int HistorySize = 120;
+
+    struct Frame {
+        int dirtyLines = 0; // lines found to differ from the previous image
+        int scrolledLines = 0; // lines moved instead of being drawn again
+        int fragments = 0; // text fragments drawn
+        int drawTextCalls = 0; // fragments drawn with QPainter::drawText()
+        int glyphCacheHits = 0; // glyphs copied from the glyph cache
+        int glyphCacheMisses = 0; // glyphs rasterized into the glyph cache
+        qint64 updateImageTime = 0; // nanoseconds in TerminalDisplay::updateImage()
+        qint64 filterTime = 0; // nanoseconds in TerminalDisplay::processFilters()
+        qint64 paintTime = 0; // nanoseconds in TerminalDisplay::paintEvent()
+
+        /** Total time spent on the frame, in nanoseconds */
+        qint64 totalTime() const
+        {
+            return updateImageTime + filterTime + paintTime;
+        }
+    };
+
+    RenderStatistics();
+
+    /** Returns the frame which is being collected */
+    Frame &currentFrame()
+    {
+        return _currentFrame;
+    }
+
+    /** Adds the current frame to the finished ones and starts a new one */
+    void finishFrame();
+
+    /** Returns the last finished frames, oldest first */
+    QVector<Frame> frames() const;
+
+    /** Returns the last finished frame, or an empty frame if there is none */
+    Frame lastFrame() const;
+
+    /** Drops all finished frames and the current one */
+    void clear();
+
+    /**
+     * Returns a human readable description of the last frame, and the
+     * average and slowest of the finished frames
+     */
+    QString summary() const;
+
+private:
+    Frame _currentFrame;
+    QVector<Frame> _frames; // ring buffer of finished frames
+    int _nextFrame; // index in _frames which finishFrame() writes to
+};
+
+}
+
+#endif // RENDERSTATISTICS_H
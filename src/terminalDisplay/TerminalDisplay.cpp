@@ -45,6 +45,10 @@
 #include <KMessageWidget>
 #include <KShell>
 
+// Standard
+#include <cstddef>
+#include <cstring>
+
 // Konsole
 #include "extras/AutoScrollHandler.h"
 #include "extras/CompositeWidgetFocusWatcher.h"
@@ -63,7 +67,9 @@
 #include "../widgets/TerminalDisplayAccessible.h"
 #include "EscapeSequenceUrlExtractor.h"
 #include "PrintOptions.h"
+#include "RenderScheduler.h"
 #include "Screen.h"
+#include "SearchMatches.h"
 #include "ViewManager.h" // for colorSchemeForProfile. // TODO: Rewrite this.
 #include "WindowSystemInfo.h"
 #include "konsoledebug.h"
@@ -97,6 +103,46 @@ inline int TerminalDisplay::loc(int x, int y) const
     return y * _columns + x;
 }
 
+// Cells are compared as two overlapping 64-bit words, which cover everything
+// but the trailing padding byte of Character: the character value, the
+// rendition, both colors and isRealCharacter
+static_assert(sizeof(Character) == 16 && offsetof(Character, isRealCharacter) == 14, "cellDifference() depends on the layout of Character");
+
+static inline quint64 cellDifference(const Character &a, const Character &b)
+{
+    quint64 a0, a1, b0, b1;
+    memcpy(&a0, reinterpret_cast<const char *>(&a), sizeof(quint64));
+    memcpy(&a1, reinterpret_cast<const char *>(&a) + 7, sizeof(quint64));
+    memcpy(&b0, reinterpret_cast<const char *>(&b), sizeof(quint64));
+    memcpy(&b1, reinterpret_cast<const char *>(&b) + 7, sizeof(quint64));
+    return (a0 ^ b0) | (a1 ^ b1);
+}
+
+// Sets dirtyMask[x] for the cells which differ between oldLine and newLine,
+// and returns whether any did. The mask is left untouched for identical
+// lines. The renditions of all new cells are or'ed into renditions.
+static bool compareLine(const Character *oldLine, const Character *newLine, const int count, char *dirtyMask, RenditionFlags &renditions)
+{
+    // Most lines don't change between updates; find out without touching the mask
+    int x = 0;
+    while (x < count && cellDifference(oldLine[x], newLine[x]) == 0) {
+        renditions |= newLine[x].rendition;
+        ++x;
+    }
+    if (x == count) {
+        return false;
+    }
+
+    memset(dirtyMask, 0, x);
+    for (; x < count; ++x) {
+        dirtyMask[x] = cellDifference(oldLine[x], newLine[x]) != 0;
+        renditions |= newLine[x].rendition;
+    }
+    dirtyMask[count] = 0;
+    dirtyMask[count + 1] = 0;
+    return true;
+}
+
 /* ------------------------------------------------------------------------- */
 /*                                                                           */
 /*                                Colors                                     */
@@ -119,6 +165,7 @@ void TerminalDisplay::setScreenWindow(ScreenWindow *window)
     }
 
     _screenWindow = window;
+    _compareWholeImage = true;
 
     if (!_screenWindow.isNull()) {
         connect(_screenWindow.data(), &Konsole::ScreenWindow::outputChanged, this, &Konsole::TerminalDisplay::updateImage);
@@ -148,6 +195,40 @@ void TerminalDisplay::setScreenWindow(ScreenWindow *window)
     }
 }
 
+void TerminalDisplay::setSearchMatches(SearchMatches *searchMatches)
+{
+    if (searchMatches == _searchMatches) {
+        return;
+    }
+
+    if (!_searchMatches.isNull()) {
+        disconnect(_searchMatches, nullptr, this, nullptr);
+    }
+
+    _searchMatches = searchMatches;
+    if (!_searchMatches.isNull()) {
+        connect(_searchMatches.data(), &Konsole::SearchMatches::matchesChanged, this, &Konsole::TerminalDisplay::searchMatchesChanged);
+    }
+    _scrollBar->setSearchMatches(searchMatches);
+
+    update();
+}
+
+void TerminalDisplay::searchMatchesChanged(int firstLine, int lastLine)
+{
+    if (lastLine == -1 || _screenWindow.isNull()) {
+        update();
+        return;
+    }
+
+    // only repaint the visible lines whose matches changed
+    const int first = qMax(firstLine - _screenWindow->currentLine(), 0);
+    const int last = qMin(lastLine - _screenWindow->currentLine(), _lines - 1);
+    if (first <= last) {
+        update(imageToWidget(QRect(0, first, _columns, last - first + 1)));
+    }
+}
+
 /* ------------------------------------------------------------------------- */
 /*                                                                           */
 /*                         Accessibility                                     */
@@ -193,6 +274,7 @@ TerminalDisplay::TerminalDisplay(QWidget *parent)
     , _image(nullptr)
     , _imageSize(0)
     , _lineProperties(QVector<LineProperty>())
+    , _compareWholeImage(true)
     , _randomSeed(0)
     , _resizing(false)
     , _showTerminalSizeHint(true)
@@ -225,6 +307,7 @@ TerminalDisplay::TerminalDisplay(QWidget *parent)
     , _possibleTripleClick(false)
     , _resizeWidget(nullptr)
     , _resizeTimer(nullptr)
+    , _backlogWidget(nullptr)
     , _flowControlWarningEnabled(false)
     , _outputSuspendedMessageWidget(nullptr)
     , _size(QSize())
@@ -246,6 +329,7 @@ TerminalDisplay::TerminalDisplay(QWidget *parent)
     , _headerBar(new TerminalHeaderBar(this))
     , _searchResultRect(QRect())
     , _drawOverlay(false)
+    , _renderStatisticsVisible(qEnvironmentVariableIsSet("KONSOLE_SHOW_RENDER_STATISTICS"))
     , _scrollBar(nullptr)
     , _terminalColor(nullptr)
     , _terminalFont(std::make_unique<TerminalFont>(this))
@@ -466,20 +550,25 @@ void TerminalDisplay::processFilters()
         return;
     }
 
+    QElapsedTimer filterTimer;
+    filterTimer.start();
+
     const QRegion preUpdateHotSpots = _filterChain->hotSpotRegion();
 
-    // use _screenWindow->getImage() here rather than _image because
+    // read the lines from the screen here rather than from _image because
     // other classes may call processFilters() when this display's
     // ScreenWindow emits a scrolled() signal - which will happen before
     // updateImage() is called on the display and therefore _image is
     // out of date at this point
-    _filterChain->setImage(_screenWindow->getImage(), _screenWindow->windowLines(), _screenWindow->windowColumns(), _screenWindow->getLineProperties());
+    _filterChain->setImage(_screenWindow->screen(), _screenWindow->currentLine(), _screenWindow->windowLines());
     _filterChain->process();
 
     const QRegion postUpdateHotSpots = _filterChain->hotSpotRegion();
 
     update(preUpdateHotSpots | postUpdateHotSpots);
     _filterUpdateRequired = false;
+
+    _renderStatistics.currentFrame().filterTime += filterTimer.nsecsElapsed();
 }
 
 void TerminalDisplay::updateImage()
@@ -488,29 +577,24 @@ void TerminalDisplay::updateImage()
         return;
     }
 
+    QElapsedTimer updateTimer;
+    updateTimer.start();
+
     // Better control over screen resizing visual glitches
     _screenWindow->updateCurrentLine();
 
     // optimization - scroll the existing image where possible and
     // avoid expensive text drawing for parts of the image that
-    // can simply be moved up or down
-    // disable this shortcut for transparent konsole with scaled pixels, otherwise we get rendering artifacts, see BUG 350651
-    if (!(WindowSystemInfo::HAVE_TRANSPARENCY && (qApp->devicePixelRatio() > 1.0)) && _wallpaper->isNull() && !_searchBar->isVisible()) {
-        // if the flow control warning is enabled this will interfere with the
-        // scrolling optimizations and cause artifacts.  the simple solution here
-        // is to just disable the optimization whilst it is visible
-        if (!((_outputSuspendedMessageWidget != nullptr) && _outputSuspendedMessageWidget->isVisible())
-            && !((_readOnlyMessageWidget != nullptr) && _readOnlyMessageWidget->isVisible())) {
-            // hide terminal size label to prevent it being scrolled and show again after scroll
-            const bool viewResizeWidget = (_resizeWidget != nullptr) && _resizeWidget->isVisible();
-            if (viewResizeWidget) {
-                _resizeWidget->hide();
-            }
-            _scrollBar->scrollImage(_screenWindow->scrollCount(), _screenWindow->scrollRegion(), _image, _imageSize);
-            if (viewResizeWidget) {
-                _resizeWidget->show();
-            }
-        }
+    // can simply be moved up or down, see moveScrolledLines()
+    //
+    // hide terminal size label to prevent it being scrolled and show again after scroll
+    const bool viewResizeWidget = (_resizeWidget != nullptr) && _resizeWidget->isVisible();
+    if (viewResizeWidget) {
+        _resizeWidget->hide();
+    }
+    _scrollBar->scrollImage(_screenWindow->scrollCount(), _screenWindow->scrollRegion(), _image, _imageSize);
+    if (viewResizeWidget) {
+        _resizeWidget->show();
     }
 
     if (_image == nullptr) {
@@ -536,22 +620,37 @@ void TerminalDisplay::updateImage()
     const QPoint tL = contentsRect().topLeft();
     const int tLx = tL.x();
     const int tLy = tL.y();
-    _hasTextBlinker = false;
 
     CharacterColor cf; // undefined
 
     const int linesToUpdate = qBound(0, lines, _lines);
     const int columnsToUpdate = qBound(0, columns, _columns);
 
-    auto dirtyMask = new char[columnsToUpdate + 2];
+    if (_dirtyMask.size() < columnsToUpdate + 2) {
+        _dirtyMask.resize(columnsToUpdate + 2);
+    }
+    char *const dirtyMask = _dirtyMask.data();
     QRegion dirtyRegion;
 
+    // Lines which the screen window did not update are still the same as in
+    // _image, unless _image has since been resized or scrolled
+    const QBitArray &changedLines = _screenWindow->changedLines();
+    const bool compareAllLines = _compareWholeImage || _screenWindow->scrollCount() != 0 || changedLines.size() < linesToUpdate
+        || linesToUpdate != _usedLines || columnsToUpdate != _usedColumns;
+    if (_blinkingLines.size() != linesToUpdate) {
+        _blinkingLines = QBitArray(linesToUpdate);
+    }
+
     // debugging variable, this records the number of lines that are found to
     // be 'dirty' ( ie. have changed from the old _image to the new _image ) and
     // which therefore need to be repainted
     int dirtyLineCount = 0;
 
     for (y = 0; y < linesToUpdate; ++y) {
+        if (!compareAllLines && !changedLines.testBit(y)) {
+            continue;
+        }
+
         const Character *currentLine = &_image[y * _columns];
         const Character *const newLine = &newimg[y * columns];
 
@@ -560,18 +659,12 @@ void TerminalDisplay::updateImage()
         // The dirty mask indicates which characters need repainting. We also
         // mark surrounding neighbors dirty, in case the character exceeds
         // its cell boundaries
-        memset(dirtyMask, 0, columnsToUpdate + 2);
-
-        for (x = 0; x < columnsToUpdate; ++x) {
-            if (newLine[x] != currentLine[x]) {
-                dirtyMask[x] = 1;
-            }
-        }
+        RenditionFlags renditions = 0;
+        const bool lineChanged = compareLine(currentLine, newLine, columnsToUpdate, dirtyMask, renditions);
+        _blinkingLines.setBit(y, (renditions & RE_BLINK) != 0);
 
-        if (!_resizing) { // not while _resizing, we're expecting a paintEvent
+        if (lineChanged && !_resizing) { // not while _resizing, we're expecting a paintEvent
             for (x = 0; x < columnsToUpdate; ++x) {
-                _hasTextBlinker |= (newLine[x].rendition & RE_BLINK);
-
                 // Start drawing if this character or the next one differs.
                 // We also take the next one into account to handle the situation
                 // where characters exceed their cell width.
@@ -628,9 +721,14 @@ void TerminalDisplay::updateImage()
 
         // replace the line of characters in the old _image with the
         // current line of the new _image
-        memcpy((void *)currentLine, (const void *)newLine, columnsToUpdate * sizeof(Character));
+        if (lineChanged) {
+            memcpy((void *)currentLine, (const void *)newLine, columnsToUpdate * sizeof(Character));
+        }
     }
     _lineProperties = newLineProperties;
+    _hasTextBlinker = !_resizing && _blinkingLines.count(true) > 0;
+    _screenWindow->resetChangedLines();
+    _compareWholeImage = false;
 
     // if the new _image is smaller than the previous _image, then ensure that the area
     // outside the new _image is cleared
@@ -665,14 +763,24 @@ void TerminalDisplay::updateImage()
     if (_scrollBar->highlightScrolledLines().isEnabled()) {
         dirtyRegion |= _terminalPainter->highlightScrolledLinesRegion(_scrollBar);
     }
+
+    if (_renderStatisticsVisible) {
+        dirtyRegion |= renderStatisticsRect();
+    }
+
+    // graphics placements are drawn over the text of the lines which are
+    // repainted anyway, only the placements which changed need more
+    dirtyRegion |= updateGraphicsPlacements(_screenWindow->scrollCount());
+    RenderStatistics::Frame &frameStatistics = _renderStatistics.currentFrame();
+    frameStatistics.dirtyLines += dirtyLineCount;
+    frameStatistics.scrolledLines += qAbs(_screenWindow->scrollCount());
     _screenWindow->resetScrollCount();
 
     // update the parts of the display which have changed
-    if (_screenWindow->screen()->hasGraphics()) {
-        update();
-    } else {
-        update(dirtyRegion);
+    if (!_contentLayer.isNull()) {
+        _contentLayerDamage |= dirtyRegion;
     }
+    update(dirtyRegion);
 
     if (_allowBlinkingText && _hasTextBlinker && !_blinkTextTimer->isActive()) {
         _blinkTextTimer->start();
@@ -681,7 +789,6 @@ void TerminalDisplay::updateImage()
         _blinkTextTimer->stop();
         _textBlinking = false;
     }
-    delete[] dirtyMask;
 
 #ifndef QT_NO_ACCESSIBILITY
     QAccessibleEvent dataChangeEvent(this, QAccessible::VisibleDataChanged);
@@ -689,6 +796,124 @@ void TerminalDisplay::updateImage()
     QAccessibleTextCursorEvent cursorEvent(this, _usedColumns * screenWindow()->screen()->getCursorY() + screenWindow()->screen()->getCursorX());
     QAccessible::updateAccessibility(&cursorEvent);
 #endif
+
+    frameStatistics.updateImageTime += updateTimer.nsecsElapsed();
+}
+
+void TerminalDisplay::setRenderStatisticsVisible(bool visible)
+{
+    if (_renderStatisticsVisible == visible) {
+        return;
+    }
+
+    _renderStatisticsVisible = visible;
+    update(renderStatisticsRect());
+}
+
+QString TerminalDisplay::renderStatisticsText() const
+{
+    return _renderStatistics.summary() + QLatin1Char('\n') + RenderScheduler::instance()->summary();
+}
+
+QRect TerminalDisplay::renderStatisticsRect() const
+{
+    const int lines = renderStatisticsText().count(QLatin1Char('\n')) + 1;
+    return QRect(_contentRect.left(), _contentRect.top(), _contentRect.width(), lines * fontMetrics().lineSpacing() + 2 * _margin);
+}
+
+bool TerminalDisplay::useContentLayer() const
+{
+    // blitting the view's own pixels would move the wallpaper along with the text,
+    // and leaves artifacts with a translucent window and scaled pixels, see BUG 350651
+    return !_wallpaper->isNull() || (WindowSystemInfo::HAVE_TRANSPARENCY && (qApp->devicePixelRatio() > 1.0));
+}
+
+void TerminalDisplay::moveScrolledLines(int dy, const QRect &rect)
+{
+    if (!useContentLayer()) {
+        scroll(0, dy, rect);
+
+        // child widgets covering the text, like the search bar or the message
+        // widgets, share the view's pixels, and have been moved along
+        QRegion overlays;
+        const auto children = findChildren<QWidget *>(QString(), Qt::FindDirectChildrenOnly);
+        for (const QWidget *child : children) {
+            if (child != _scrollBar && child->isVisible()) {
+                overlays |= child->geometry() & rect;
+            }
+        }
+        if (_renderStatisticsVisible) {
+            overlays |= renderStatisticsRect() & rect;
+        }
+        if (!overlays.isEmpty()) {
+            update(overlays | overlays.translated(0, dy));
+        }
+        return;
+    }
+
+    // the background stays in place, only the text is scrolled
+    const qreal dpr = _contentLayer.devicePixelRatio();
+    const auto isPixelAligned = [dpr](int value) {
+        return qAbs(value * dpr - qRound(value * dpr)) < 0.01;
+    };
+    if (!_contentLayer.isNull() && isPixelAligned(rect.left()) && isPixelAligned(rect.top()) && isPixelAligned(rect.width())
+        && isPixelAligned(rect.height()) && isPixelAligned(dy)) {
+        const QRect layerRect(qRound(rect.left() * dpr), qRound(rect.top() * dpr), qRound(rect.width() * dpr), qRound(rect.height() * dpr));
+        _contentLayer.scroll(0, qRound(dy * dpr), layerRect);
+
+        // the text which was out of date before the scroll still is
+        _contentLayerDamage |= (_contentLayerDamage & rect).translated(0, dy);
+        _contentLayerScrolled |= rect;
+    } else {
+        _contentLayerDamage |= rect;
+    }
+    update(rect);
+}
+
+QRegion TerminalDisplay::updateGraphicsPlacements(int scrolledLines)
+{
+    Screen *screen = _screenWindow->screen();
+
+    QVector<DrawnGraphicsPlacement> placements;
+    if (screen->hasGraphics()) {
+        for (int i = 0; TerminalGraphicsPlacement_t *p = screen->getGraphicsPlacement(i); i++) {
+            placements.append({_terminalPainter->graphicsPlacementRect(p), p->pixmap.cacheKey(), p->opacity, p->z});
+        }
+    }
+
+    QRegion damage;
+    if (scrolledLines != 0) {
+        // scrollImage() may have moved the pixels of all placements along
+        // with the text, including the ones which stay in place
+        const int scrolledPixels = -scrolledLines * _terminalFont->fontHeight();
+        for (const DrawnGraphicsPlacement &drawn : qAsConst(_drawnGraphics)) {
+            damage |= drawn.rect;
+            damage |= drawn.rect.translated(0, scrolledPixels);
+        }
+        for (const DrawnGraphicsPlacement &placement : qAsConst(placements)) {
+            damage |= placement.rect;
+        }
+    } else if (placements != _drawnGraphics) {
+        for (const DrawnGraphicsPlacement &drawn : qAsConst(_drawnGraphics)) {
+            if (!placements.contains(drawn)) {
+                damage |= drawn.rect;
+            }
+        }
+        for (const DrawnGraphicsPlacement &placement : qAsConst(placements)) {
+            if (!_drawnGraphics.contains(placement)) {
+                damage |= placement.rect;
+            }
+        }
+        // only the stacking order changed
+        if (damage.isEmpty()) {
+            for (const DrawnGraphicsPlacement &placement : qAsConst(placements)) {
+                damage |= placement.rect;
+            }
+        }
+    }
+
+    _drawnGraphics = placements;
+    return damage;
 }
 
 void TerminalDisplay::showResizeNotification()
@@ -715,16 +940,80 @@ void TerminalDisplay::showResizeNotification()
     }
 }
 
+void TerminalDisplay::setOutputBacklogged(bool backlogged)
+{
+    if (!backlogged) {
+        if (_backlogWidget != nullptr) {
+            _backlogWidget->hide();
+        }
+        return;
+    }
+
+    if (_backlogWidget == nullptr) {
+        _backlogWidget = new QLabel(i18n("Skipping output…"), this);
+        _backlogWidget->setMinimumHeight(_backlogWidget->sizeHint().height());
+        _backlogWidget->setAlignment(Qt::AlignCenter);
+        _backlogWidget->setStyleSheet(QStringLiteral("background-color:palette(window);border-style:solid;border-width:1px;border-color:palette(dark)"));
+        _backlogWidget->adjustSize();
+    }
+    moveBacklogWidget();
+    _backlogWidget->show();
+}
+
+void TerminalDisplay::moveBacklogWidget()
+{
+    if (_backlogWidget == nullptr) {
+        return;
+    }
+    // bottom right corner of the terminal area
+    _backlogWidget->move(_contentRect.right() + 1 - _backlogWidget->width(), _contentRect.bottom() + 1 - _backlogWidget->height());
+}
+
+void TerminalDisplay::updateScrollBar()
+{
+    if (_screenWindow.isNull()) {
+        return;
+    }
+
+    // the screen window only follows the output when the image is updated
+    const int lineCount = _screenWindow->lineCount();
+    const int currentLine = _screenWindow->trackOutput() ? lineCount - _screenWindow->windowLines() : _screenWindow->currentLine();
+    _scrollBar->setScroll(qMax(0, currentLine), lineCount);
+}
+
 void TerminalDisplay::paintEvent(QPaintEvent *pe)
 {
+    QElapsedTimer paintTimer;
+    paintTimer.start();
+
     QPainter paint(this);
 
     // Determine which characters should be repainted (1 region unit = 1 character)
     QRegion dirtyImageRegion;
     const QRegion region = pe->region() & contentsRect();
 
-    for (const QRect &rect : region) {
+    // with a content layer, the text which has only been scrolled is not drawn again
+    QRegion textRegion = region;
+    if (useContentLayer()) {
+        const qreal dpr = devicePixelRatioF();
+        if (_contentLayer.isNull() || _contentLayer.devicePixelRatio() != dpr || _contentLayer.size() != size() * dpr) {
+            _contentLayer = QPixmap(size() * dpr);
+            _contentLayer.setDevicePixelRatio(dpr);
+            _contentLayer.fill(Qt::transparent);
+            textRegion = contentsRect();
+        } else {
+            textRegion -= _contentLayerScrolled - _contentLayerDamage;
+        }
+    } else {
+        _contentLayer = QPixmap();
+    }
+    _contentLayerScrolled = QRegion();
+    _contentLayerDamage = QRegion();
+
+    for (const QRect &rect : qAsConst(textRegion)) {
         dirtyImageRegion += widgetToImage(rect);
+    }
+    for (const QRect &rect : region) {
         _terminalPainter->drawBackground(paint, rect, _terminalColor->backgroundColor(), true /* use opacity setting */);
     }
 
@@ -741,8 +1030,27 @@ void TerminalDisplay::paintEvent(QPaintEvent *pe)
     // set https://bugreports.qt.io/browse/QTBUG-66036
     paint.setRenderHint(QPainter::TextAntialiasing, _terminalFont->antialiasText());
 
-    for (const QRect &rect : qAsConst(dirtyImageRegion)) {
-        _terminalPainter->drawContents(_image, paint, rect, false, _imageSize, _bidiEnabled, _lineProperties);
+    if (_contentLayer.isNull()) {
+        for (const QRect &rect : qAsConst(dirtyImageRegion)) {
+            _terminalPainter->drawContents(_image, paint, rect, false, _imageSize, _bidiEnabled, _lineProperties);
+        }
+    } else {
+        QPainter layerPainter(&_contentLayer);
+        layerPainter.setRenderHint(QPainter::TextAntialiasing, _terminalFont->antialiasText());
+        for (const QRect &rect : qAsConst(dirtyImageRegion)) {
+            const QRect layerRect = imageToWidget(rect).translated(contentsRect().topLeft());
+            layerPainter.setClipRect(layerRect);
+            layerPainter.setCompositionMode(QPainter::CompositionMode_Source);
+            layerPainter.fillRect(layerRect, Qt::transparent);
+            layerPainter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+            _terminalPainter->drawContents(_image, layerPainter, rect, false, _imageSize, _bidiEnabled, _lineProperties);
+        }
+        layerPainter.end();
+
+        paint.save();
+        paint.setClipRegion(region);
+        paint.drawPixmap(0, 0, _contentLayer);
+        paint.restore();
     }
 
     if (screenWindow()->currentResultLine() != -1) {
@@ -753,6 +1061,7 @@ void TerminalDisplay::paintEvent(QPaintEvent *pe)
         );
         _terminalPainter->drawCurrentResultRect(paint, _searchResultRect);
     }
+    _terminalPainter->drawSearchMatches(paint, region);
 
     if (_scrollBar->highlightScrolledLines().isEnabled()) {
         _terminalPainter->highlightScrolledLines(paint, _scrollBar->highlightScrolledLines().isTimerActive(), _scrollBar->highlightScrolledLines().rect());
@@ -780,6 +1089,24 @@ void TerminalDisplay::paintEvent(QPaintEvent *pe)
         paint.setBrush(QColor(100, 100, 100, 127));
         paint.drawRect(rect);
     }
+
+    if (_renderStatisticsVisible) {
+        const QRect rect = renderStatisticsRect();
+        paint.fillRect(rect, QColor(0, 0, 0, 160));
+        paint.setPen(Qt::white);
+        paint.drawText(rect.adjusted(_margin, _margin, -_margin, -_margin), Qt::AlignLeft | Qt::AlignTop, renderStatisticsText());
+    }
+
+    RenderStatistics::Frame &frameStatistics = _renderStatistics.currentFrame();
+    frameStatistics.paintTime += paintTimer.nsecsElapsed();
+    // frames taking longer than two frame intervals are visible as stutter
+    if (frameStatistics.totalTime() > 2 * RenderScheduler::instance()->frameInterval() * qint64(1000000)) {
+        qCDebug(KonsoleDebug) << "Slow frame in" << this << ":" << frameStatistics.totalTime() / 1000000.0 << "ms, update"
+                              << frameStatistics.updateImageTime / 1000000.0 << "ms, filters" << frameStatistics.filterTime / 1000000.0 << "ms, paint"
+                              << frameStatistics.paintTime / 1000000.0 << "ms," << frameStatistics.dirtyLines << "dirty lines,"
+                              << frameStatistics.fragments << "fragments," << frameStatistics.drawTextCalls << "drawText calls";
+    }
+    _renderStatistics.finishFrame();
 }
 
 QPoint TerminalDisplay::cursorPosition() const
@@ -983,6 +1310,7 @@ void TerminalDisplay::updateImageSize()
     const int oldColumns = _columns;
 
     makeImage();
+    _compareWholeImage = true;
 
     if (oldImage != nullptr) {
         // copy the old image to reduce flicker
@@ -1089,6 +1417,9 @@ void TerminalDisplay::calcGeometry()
         QSize unusedPixels = _contentRect.size() - QSize(_columns * fontWidth, _lines * _terminalFont->fontHeight());
         _contentRect.adjust(unusedPixels.width() / 2, unusedPixels.height() / 2, 0, 0);
     }
+
+    // the terminal area moved or was resized
+    moveBacklogWidget();
 }
 
 // calculate the needed size, this must be synced with calcGeometry()
@@ -10,7 +10,9 @@
 
 // Qt
 #include <QColor>
+#include <QPixmap>
 #include <QPointer>
+#include <QRegion>
 #include <QWidget>
 
 #include <memory>
@@ -21,6 +23,7 @@
 #include "ScreenWindow.h"
 #include "ScrollState.h"
 #include "colorscheme/ColorScheme.h"
+#include "RenderStatistics.h"
 #include "konsoleprivate_export.h"
 #include "widgets/TerminalHeaderBar.h"
 
@@ -57,6 +60,7 @@ class SessionController;
 class IncrementalSearchBar;
 class HotSpot;
 class Profile;
+class SearchMatches;
 
 /**
  * A widget which displays output from a terminal emulation and sends input keypresses and mouse activity
@@ -245,6 +249,17 @@ public:
         return _screenWindow;
     }
 
+    /**
+     * Sets the search matches which are highlighted in the display and
+     * marked on its scroll bar, or none if @p searchMatches is null.
+     */
+    void setSearchMatches(SearchMatches *searchMatches);
+    /** Returns the highlighted search matches.  See setSearchMatches() */
+    SearchMatches *searchMatches() const
+    {
+        return _searchMatches;
+    }
+
     // Select the current line.
     void selectCurrentLine();
 
@@ -284,6 +299,27 @@ public:
     QRect imageToWidget(const QRect &imageArea) const;
     QRect widgetToImage(const QRect &widgetArea) const;
 
+    /** Returns the time and work spent on the last frames of the display */
+    RenderStatistics *renderStatistics()
+    {
+        return &_renderStatistics;
+    }
+
+    /**
+     * Shows or hides an overlay with the renderStatistics() of the last frames
+     * at the top of the display. It is shown by default when the
+     * KONSOLE_SHOW_RENDER_STATISTICS environment variable is set.
+     */
+    void setRenderStatisticsVisible(bool visible);
+    bool isRenderStatisticsVisible() const
+    {
+        return _renderStatisticsVisible;
+    }
+
+    // moves the pixels of the lines in 'rect' by 'dy' after they have been
+    // scrolled in the character image, see TerminalScrollBar::scrollImage()
+    void moveScrolledLines(int dy, const QRect &rect);
+
     // maps a point on the widget to the position ( ie. line and column )
     // of the character at that point. When the edge is true, it maps to
     // a character which left edge is closest to the point.
@@ -440,6 +476,19 @@ public Q_SLOTS:
 
     void setBracketedPasteMode(bool on);
 
+    /**
+     * Shows or hides the indicator that the output of the program is not
+     * displayed while it arrives faster than it could be, see
+     * Emulation::outputBackloggedChanged()
+     */
+    void setOutputBacklogged(bool backlogged);
+
+    /**
+     * Updates the scroll bar for new output without updating the image,
+     * see Emulation::outputSkipped()
+     */
+    void updateScrollBar();
+
     /**
      * Shows a notification that a bell event has occurred in the terminal.
      * TODO: More documentation here
@@ -558,6 +607,7 @@ protected Q_SLOTS:
 private Q_SLOTS:
 
     void viewScrolledByUser();
+    void searchMatchesChanged(int firstLine, int lastLine);
 
 private:
     Q_DISABLE_COPY(TerminalDisplay)
@@ -569,10 +619,26 @@ private:
     // current size in columns and lines
     void showResizeNotification();
 
+    // keeps the label shown by setOutputBacklogged() in the bottom right
+    // corner of the terminal area
+    void moveBacklogWidget();
+
     void calcGeometry();
     void updateImageSize();
     void makeImage();
 
+    // true if the text is drawn into _contentLayer instead of directly into the view
+    bool useContentLayer() const;
+
+    // text of the render statistics overlay, the display's and the scheduler's
+    QString renderStatisticsText() const;
+    // area covered by the render statistics overlay, see setRenderStatisticsVisible()
+    QRect renderStatisticsRect() const;
+
+    // returns the area of the graphics placements which were added, removed,
+    // moved or changed since the previous call, and remembers the current ones
+    QRegion updateGraphicsPlacements(int scrolledLines);
+
     void paintFilters(QPainter &painter);
 
     void setupHeaderVisibility();
@@ -648,6 +714,30 @@ private:
 
     int _imageSize;
     QVector<LineProperty> _lineProperties;
+    QVector<char> _dirtyMask; // scratch space for updateImage(), kept to avoid reallocating it
+    bool _compareWholeImage; // true if updateImage() can not rely on ScreenWindow::changedLines()
+    QBitArray _blinkingLines; // lines of _image with blinking text
+
+    // with a wallpaper or a translucent HiDPI window, the text is drawn into
+    // this layer, which is scrolled instead of the view's own pixels and then
+    // drawn over the background, see moveScrolledLines()
+    QPixmap _contentLayer;
+    QRegion _contentLayerScrolled; // parts of _contentLayer moved since the last paint
+    QRegion _contentLayerDamage; // parts of _contentLayer whose text changed since the last paint
+
+    // a graphics placement as it was drawn with the current _image
+    struct DrawnGraphicsPlacement {
+        QRect rect;
+        qint64 pixmapKey;
+        qreal opacity;
+        int z;
+
+        bool operator==(const DrawnGraphicsPlacement &other) const
+        {
+            return rect == other.rect && pixmapKey == other.pixmapKey && opacity == other.opacity && z == other.z;
+        }
+    };
+    QVector<DrawnGraphicsPlacement> _drawnGraphics;
 
     QColor _colorTable[TABLE_COLORS];
 
@@ -696,6 +786,8 @@ private:
     QLabel *_resizeWidget;
     QTimer *_resizeTimer;
 
+    QLabel *_backlogWidget; // see setOutputBacklogged()
+
     bool _flowControlWarningEnabled;
 
     // widgets related to the warning message that appears when the user presses Ctrl+S to suspend
@@ -743,11 +835,15 @@ private:
     IncrementalSearchBar *_searchBar;
     TerminalHeaderBar *_headerBar;
     QRect _searchResultRect;
+    QPointer<SearchMatches> _searchMatches;
     friend class TerminalDisplayAccessible;
 
     bool _drawOverlay;
     Qt::Edge _overlayEdge;
 
+    RenderStatistics _renderStatistics;
+    bool _renderStatisticsVisible;
+
     bool _hasCompositeFocus;
     bool _displayVerticalLine;
     int _displayVerticalLineAtChar;
@@ -10,6 +10,7 @@
 #include "TerminalFonts.h"
 
 // Konsole
+#include "characters/LineBlockCharacters.h"
 #include "konsoledebug.h"
 #include "session/Session.h"
 #include "session/SessionController.h"
@@ -199,6 +200,9 @@ bool TerminalFont::useFontLineCharacters() const
 
 void TerminalFont::fontChange(const QFont &)
 {
+    const int oldFontWidth = m_fontWidth;
+    const int oldFontHeight = m_fontHeight;
+
     QFontMetrics fm(qobject_cast<QWidget *>(m_parent)->font());
     m_fontHeight = fm.height() + m_lineSpacing;
 
@@ -212,6 +216,11 @@ void TerminalFont::fontChange(const QFont &)
 
     m_fontAscent = fm.ascent();
 
+    if (m_fontWidth != oldFontWidth || m_fontHeight != oldFontHeight) {
+        // Tiles for the old cell size are unlikely to be needed again
+        LineBlockCharacters::clearCache();
+    }
+
     qobject_cast<TerminalDisplay *>(m_parent)->propagateSize();
 }
 
@@ -11,9 +11,11 @@
 
 // Konsole
 #include "../Screen.h"
+#include "../SearchMatches.h"
 #include "../characters/ExtendedCharTable.h"
 #include "../characters/LineBlockCharacters.h"
 #include "../session/SessionManager.h"
+#include "RenderStatistics.h"
 #include "TerminalColor.h"
 #include "TerminalFonts.h"
 #include "TerminalScrollBar.h"
@@ -90,6 +92,20 @@ void TerminalPainter::drawContents(Character *image,
     const int fontWidth = m_parentDisplay->terminalFont()->fontWidth();
     const int fontHeight = m_parentDisplay->terminalFont()->fontHeight();
 
+    if (!printerFriendly) {
+        const int baseline = m_parentDisplay->terminalFont()->fontAscent() + m_parentDisplay->terminalFont()->lineSpacing() / 2;
+        m_glyphCache.setFont(m_parentDisplay->font(), QSize(fontWidth, fontHeight), baseline, paint.device()->devicePixelRatioF());
+    }
+
+    RenderStatistics::Frame &frameStatistics = m_parentDisplay->renderStatistics()->currentFrame();
+
+    // the graphics layers are drawn once for the whole area, instead of once per text fragment
+    const bool drawGraphics = !printerFriendly && m_parentDisplay->screenWindow()->screen()->hasGraphics();
+    const QRect graphicsArea(leftPadding + fontWidth * rect.x(), topPadding + fontHeight * rect.y(), fontWidth * rect.width(), fontHeight * rect.height());
+    if (drawGraphics) {
+        drawGraphicsPlacements(paint, graphicsArea, false);
+    }
+
     for (int y = rect.y(); y <= rect.bottom(); y++) {
         int x = rect.x();
         bool doubleHeightLinePair = false;
@@ -246,6 +262,7 @@ void TerminalPainter::drawContents(Character *image,
             univec.clear();
 
             // paint text fragment
+            ++frameStatistics.fragments;
             if (printerFriendly) {
                 drawPrinterFriendlyTextFragment(paint, textArea, unistr, image[pos], y < lineProperties.size() ? lineProperties[y] : 0);
             } else {
@@ -267,6 +284,57 @@ void TerminalPainter::drawContents(Character *image,
             y++;
         }
     }
+
+    if (drawGraphics) {
+        drawGraphicsPlacements(paint, graphicsArea, true);
+    }
+
+    frameStatistics.glyphCacheHits += m_glyphCache.hits();
+    frameStatistics.glyphCacheMisses += m_glyphCache.misses();
+    m_glyphCache.resetCounters();
+}
+
+QRect TerminalPainter::graphicsPlacementRect(const TerminalGraphicsPlacement_t *placement) const
+{
+    const int fontWidth = m_parentDisplay->terminalFont()->fontWidth();
+    const int fontHeight = m_parentDisplay->terminalFont()->fontHeight();
+    const int scrollDelta = fontHeight * (m_parentDisplay->screenWindow()->currentLine() - m_parentDisplay->screenWindow()->screen()->getHistLines());
+
+    const int x = placement->col * fontWidth + placement->X + m_parentDisplay->contentRect().left();
+    const int y = placement->row * fontHeight + placement->Y + m_parentDisplay->contentRect().top() - scrollDelta;
+    return QRect(x, y, placement->pixmap.width(), placement->pixmap.height());
+}
+
+void TerminalPainter::drawGraphicsPlacements(QPainter &painter, const QRect &rect, bool aboveText)
+{
+    Screen *screen = m_parentDisplay->screenWindow()->screen();
+
+    const qreal opacity = painter.opacity();
+    const bool origClipping = painter.hasClipping();
+    const auto origClipRegion = painter.clipRegion();
+    painter.setClipRect(rect);
+
+    // placements are sorted by z, the ones with z < 0 are below the text
+    for (int placementIdx = 0;; placementIdx++) {
+        TerminalGraphicsPlacement_t *p = screen->getGraphicsPlacement(placementIdx);
+        if (!p) {
+            break;
+        }
+        if ((p->z >= 0) != aboveText) {
+            continue;
+        }
+
+        const QRect dstRect = graphicsPlacementRect(p);
+        if (!dstRect.intersects(rect)) {
+            continue;
+        }
+        painter.setOpacity(p->opacity);
+        painter.drawPixmap(dstRect, p->pixmap, QRect(0, 0, p->pixmap.width(), p->pixmap.height()));
+    }
+
+    painter.setOpacity(opacity);
+    painter.setClipRegion(origClipRegion);
+    painter.setClipping(origClipping);
 }
 
 void TerminalPainter::drawCurrentResultRect(QPainter &painter, const QRect &searchResultRect)
@@ -274,6 +342,41 @@ void TerminalPainter::drawCurrentResultRect(QPainter &painter, const QRect &sear
     painter.fillRect(searchResultRect, QColor(0, 0, 255, 80));
 }
 
+void TerminalPainter::drawSearchMatches(QPainter &painter, const QRegion &region)
+{
+    const SearchMatches *searchMatches = m_parentDisplay->searchMatches();
+    ScreenWindow *window = m_parentDisplay->screenWindow();
+    if (searchMatches == nullptr || window == nullptr) {
+        return;
+    }
+
+    const int currentLine = window->currentLine();
+    const int fontWidth = m_parentDisplay->terminalFont()->fontWidth();
+    const int fontHeight = m_parentDisplay->terminalFont()->fontHeight();
+    const QRect contentRect = m_parentDisplay->contentRect();
+    // the matches are highlighted in the yellow and red of the color scheme
+    const QColor *colorTable = m_parentDisplay->terminalColor()->colorTable();
+
+    painter.save();
+    painter.setClipRegion(region);
+    const QVector<SearchMatches::Match> matches = searchMatches->matches(currentLine, currentLine + m_parentDisplay->lines() - 1);
+    for (const SearchMatches::Match &match : matches) {
+        const int endColumn = qMin(match.endColumn, m_parentDisplay->columns());
+        if (match.startColumn >= endColumn) {
+            continue;
+        }
+
+        QColor color = colorTable[window->currentResultLine() == match.line ? Color3Index : Color1Index];
+        color.setAlpha(120);
+        painter.fillRect(QRect(contentRect.left() + match.startColumn * fontWidth,
+                               contentRect.top() + (match.line - currentLine) * fontHeight,
+                               (endColumn - match.startColumn) * fontWidth,
+                               fontHeight),
+                         color);
+    }
+    painter.restore();
+}
+
 void TerminalPainter::highlightScrolledLines(QPainter &painter, bool isTimerActive, QRect rect)
 {
     QColor color = QColor(m_parentDisplay->terminalColor()->colorTable()[Color4Index]);
@@ -443,33 +546,12 @@ void TerminalPainter::drawTextFragment(QPainter &painter,
         }
     }
 
-    Screen *screen = m_parentDisplay->screenWindow()->screen();
-
-    int placementIdx = 0;
-    qreal opacity = painter.opacity();
-    int scrollDelta = m_parentDisplay->terminalFont()->fontHeight() * (m_parentDisplay->screenWindow()->currentLine() - screen->getHistLines());
-    const bool origClipping = painter.hasClipping();
-    const auto origClipRegion = painter.clipRegion();
-    if (screen->hasGraphics()) {
-        painter.setClipRect(rect);
-        while (1) {
-            TerminalGraphicsPlacement_t *p = screen->getGraphicsPlacement(placementIdx);
-            if (!p || p->z >= 0) {
-                break;
-            }
-            int x = p->col * m_parentDisplay->terminalFont()->fontWidth() + p->X + m_parentDisplay->contentRect().left();
-            int y = p->row * m_parentDisplay->terminalFont()->fontHeight() + p->Y + m_parentDisplay->contentRect().top();
-            QRectF srcRect(0, 0, p->pixmap.width(), p->pixmap.height());
-            QRectF dstRect(x, y - scrollDelta, p->pixmap.width(), p->pixmap.height());
-            painter.setOpacity(p->opacity);
-            painter.drawPixmap(dstRect, p->pixmap, srcRect);
-            placementIdx++;
-        }
-        painter.setOpacity(opacity);
-    }
+    // graphics placements are drawn by drawContents(), below and above all
+    // text fragments, concealed text lets the placements below it show through
+    const bool hasGraphics = m_parentDisplay->screenWindow()->screen()->hasGraphics();
 
     bool drawBG = backgroundColor != colorTable[DEFAULT_BACK_COLOR];
-    if (screen->hasGraphics() && style.rendition == RE_CONCEAL) {
+    if (hasGraphics && style.rendition == RE_CONCEAL) {
         drawBG = false;
     }
 
@@ -484,26 +566,6 @@ void TerminalPainter::drawTextFragment(QPainter &painter,
 
     // draw text
     drawCharacters(painter, rect, text, style, characterColor, lineProperty);
-
-    if (screen->hasGraphics()) {
-        while (1) {
-            TerminalGraphicsPlacement_t *p = screen->getGraphicsPlacement(placementIdx);
-            if (!p) {
-                break;
-            }
-            QPixmap image = p->pixmap;
-            int x = p->col * m_parentDisplay->terminalFont()->fontWidth() + p->X + m_parentDisplay->contentRect().left();
-            int y = p->row * m_parentDisplay->terminalFont()->fontHeight() + p->Y + m_parentDisplay->contentRect().top();
-            QRectF srcRect(0, 0, image.width(), image.height());
-            QRectF dstRect(x, y - scrollDelta, image.width(), image.height());
-            painter.setOpacity(p->opacity);
-            painter.drawPixmap(dstRect, image, srcRect);
-            placementIdx++;
-        }
-        painter.setOpacity(opacity);
-        painter.setClipRegion(origClipRegion);
-        painter.setClipping(origClipping);
-    }
 }
 
 void TerminalPainter::drawPrinterFriendlyTextFragment(QPainter &painter,
@@ -677,10 +739,18 @@ void TerminalPainter::drawCharacters(QPainter &painter,
             y += shifted;
         }
 
-        if (m_parentDisplay->bidiEnabled()) {
-            painter.drawText(rect.x(), y, text);
-        } else {
-            painter.drawText(rect.x(), y, LTR_OVERRIDE_CHAR + text);
+        // Text with one glyph per cell is copied from the glyph cache;
+        // scaled lines, bidi text and printing still go through drawText()
+        const bool cacheable = characterColor.isValid() && !m_parentDisplay->bidiEnabled() && painter.transform().isIdentity()
+            && (lineProperty & (LINE_DOUBLEWIDTH | LINE_DOUBLEHEIGHT_TOP | LINE_DOUBLEHEIGHT_BOTTOM)) == 0;
+
+        if (!cacheable || !m_glyphCache.drawText(painter, rect.topLeft(), text, color)) {
+            ++m_parentDisplay->renderStatistics()->currentFrame().drawTextCalls;
+            if (m_parentDisplay->bidiEnabled()) {
+                painter.drawText(rect.x(), y, text);
+            } else {
+                painter.drawText(rect.x(), y, LTR_OVERRIDE_CHAR + text);
+            }
         }
 
         if (shifted > 0) {
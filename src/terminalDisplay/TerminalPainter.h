@@ -18,6 +18,7 @@
 // Konsole
 #include "../characters/Character.h"
 #include "Enumeration.h"
+#include "GlyphCache.h"
 #include "ScreenWindow.h"
 #include "colorscheme/ColorSchemeWallpaper.h"
 #include "profile/Profile.h"
@@ -30,6 +31,8 @@ class QPainter;
 class QString;
 class QTimer;
 
+struct TerminalGraphicsPlacement_t;
+
 namespace Konsole
 {
 class Character;
@@ -59,6 +62,9 @@ public Q_SLOTS:
     // draw a transparent rectangle over the line of the current match
     void drawCurrentResultRect(QPainter &painter, const QRect &searchResultRect);
 
+    // draw transparent rectangles over the search matches in the visible lines
+    void drawSearchMatches(QPainter &painter, const QRegion &region);
+
     // draw a thin highlight on the left of the screen for lines that have been scrolled into view
     void highlightScrolledLines(QPainter &painter, bool isTimerActive, QRect rect);
 
@@ -82,6 +88,9 @@ public Q_SLOTS:
     // draws the preedit string for input methods
     void drawInputMethodPreeditString(QPainter &painter, const QRect &rect, TerminalDisplay::InputMethodData &inputMethodData, Character *image);
 
+    // returns the area covered by a graphics placement, in display coordinates
+    QRect graphicsPlacementRect(const TerminalGraphicsPlacement_t *placement) const;
+
 private:
     // draws a string of line graphics
     void drawLineCharString(TerminalDisplay *display, QPainter &painter, int x, int y, const QString &str, const Character attributes);
@@ -98,10 +107,17 @@ private:
 
     void drawPrinterFriendlyTextFragment(QPainter &painter, const QRect &rect, const QString &text, Character style, const LineProperty lineProperty);
 
+    // draws the part of the graphics placements below (z < 0) or above the
+    // text which falls inside 'rect'
+    void drawGraphicsPlacements(QPainter &painter, const QRect &rect, bool aboveText);
+
     // draws the cursor character
     void drawCursor(QPainter &painter, const QRect &rect, const QColor &foregroundColor, const QColor &backgroundColor, QColor &characterColor);
 
     TerminalDisplay *m_parentDisplay = nullptr;
+
+    // rasterized glyphs, reused by drawCharacters() across repaints
+    GlyphCache m_glyphCache;
 };
 
 }
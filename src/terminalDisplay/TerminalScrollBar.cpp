@@ -11,6 +11,8 @@
 
 // Konsole
 #include "../characters/Character.h"
+#include "SearchMatches.h"
+#include "TerminalColor.h"
 #include "TerminalDisplay.h"
 #include "TerminalFonts.h"
 #include "session/SessionController.h"
@@ -21,8 +23,10 @@
 // Qt
 #include <QGuiApplication>
 #include <QLabel>
+#include <QPainter>
 #include <QProxyStyle>
 #include <QRect>
+#include <QStyleOptionSlider>
 #include <QTimer>
 
 namespace Konsole
@@ -213,7 +217,59 @@ void TerminalScrollBar::scrollImage(int lines, const QRect &screenWindowRegion,
     }
 
     // scroll the display vertically to match internal _image
-    display->scroll(0, display->terminalFont()->fontHeight() * (-lines), scrollRect);
+    display->moveScrolledLines(display->terminalFont()->fontHeight() * (-lines), scrollRect);
+}
+
+void TerminalScrollBar::setSearchMatches(SearchMatches *searchMatches)
+{
+    if (searchMatches == _searchMatches) {
+        return;
+    }
+
+    if (!_searchMatches.isNull()) {
+        disconnect(_searchMatches, nullptr, this, nullptr);
+    }
+
+    _searchMatches = searchMatches;
+    if (!_searchMatches.isNull()) {
+        connect(_searchMatches.data(), &Konsole::SearchMatches::matchesChanged, this, QOverload<>::of(&QWidget::update));
+    }
+
+    update();
+}
+
+void TerminalScrollBar::paintEvent(QPaintEvent *event)
+{
+    QScrollBar::paintEvent(event);
+
+    if (_searchMatches.isNull()) {
+        return;
+    }
+
+    QStyleOptionSlider option;
+    initStyleOption(&option);
+    const QRect groove = style()->subControlRect(QStyle::CC_ScrollBar, &option, QStyle::SC_ScrollBarGroove, this);
+    const int totalLines = maximum() + pageStep();
+    if (groove.height() <= 0 || totalLines <= 0) {
+        return;
+    }
+
+    // mark each row of pixels of the groove whose lines have a match, so
+    // that painting does not depend on the number of matches
+    const auto display = qobject_cast<TerminalDisplay *>(this->parent());
+    QColor color = display != nullptr ? display->terminalColor()->colorTable()[Color1Index] : QColor(Qt::red);
+    color.setAlpha(160);
+    QPainter painter(this);
+    int firstLine = 0;
+    for (int y = 0; y < groove.height(); ++y) {
+        // the lines which are mapped to the row, which are none if there
+        // are fewer lines than rows
+        const int endLine = int((qint64(y + 1) * totalLines + groove.height() - 1) / groove.height());
+        if (_searchMatches->hasMatches(firstLine, endLine - 1)) {
+            painter.fillRect(QRect(groove.left(), qMin(groove.top() + y, groove.bottom() - 1), groove.width(), 2), color);
+        }
+        firstLine = endLine;
+    }
 }
 
 void TerminalScrollBar::changeEvent(QEvent *e)
@@ -10,6 +10,7 @@
 #define TERMINALSCROLLBAR_HPP
 
 // Qt
+#include <QPointer>
 #include <QScrollBar>
 
 // Konsole
@@ -21,6 +22,7 @@
 
 namespace Konsole
 {
+class SearchMatches;
 class TerminalDisplay;
 
 class KONSOLEPRIVATE_EXPORT TerminalScrollBar : public QScrollBar
@@ -84,6 +86,12 @@ public:
         return _highlightScrolledLines;
     }
 
+    /**
+     * Sets the search matches whose lines are marked on the scroll bar,
+     * or none if @p searchMatches is null.
+     */
+    void setSearchMatches(SearchMatches *searchMatches);
+
     void changeEvent(QEvent *e) override;
 
     void updatePalette(const QPalette &pal);
@@ -93,12 +101,16 @@ public Q_SLOTS:
     void scrollBarPositionChanged(int value);
     void highlightScrolledLinesEvent();
 
+protected:
+    void paintEvent(QPaintEvent *event) override;
+
 private:
     bool _scrollFullPage;
     bool _alternateScrolling;
     Enum::ScrollBarPositionEnum _scrollbarLocation;
     HighlightScrolledLines _highlightScrolledLines;
     QPalette _backgroundMatchingPalette;
+    QPointer<SearchMatches> _searchMatches;
 };
 } // namespace Konsole
 
@@ -11,6 +11,7 @@
 #include <QApplication>
 #include <QHBoxLayout>
 #include <QKeyEvent>
+#include <QLabel>
 #include <QMenu>
 #include <QTimer>
 #include <QToolButton>
@@ -33,6 +34,7 @@ using namespace Konsole;
 IncrementalSearchBar::IncrementalSearchBar(QWidget *parent)
     : QWidget(parent)
     , _searchEdit(nullptr)
+    , _searchProgress(nullptr)
     , _caseSensitive(nullptr)
     , _regExpression(nullptr)
     , _highlightMatches(nullptr)
@@ -69,6 +71,12 @@ IncrementalSearchBar::IncrementalSearchBar(QWidget *parent)
     _searchEdit->setMinimumWidth(maxWidth * 6);
     _searchEdit->setMaximumWidth(maxWidth * 10);
 
+    _searchProgress = new QLabel(this);
+    _searchProgress->setObjectName(QStringLiteral("search-progress"));
+    _searchProgress->setToolTip(i18nc("@info:tooltip", "Part of the output searched so far"));
+    _searchProgress->setContentsMargins(4, 0, 4, 0);
+    _searchProgress->hide();
+
     _searchTimer = new QTimer(this);
     _searchTimer->setInterval(250);
     _searchTimer->setSingleShot(true);
@@ -145,6 +153,7 @@ IncrementalSearchBar::IncrementalSearchBar(QWidget *parent)
 
     auto barLayout = new QHBoxLayout(this);
     barLayout->addWidget(_searchEdit);
+    barLayout->addWidget(_searchProgress);
     barLayout->addWidget(_findNextButton);
     barLayout->addWidget(_findPreviousButton);
     barLayout->addWidget(_searchFromButton);
@@ -249,8 +258,21 @@ void IncrementalSearchBar::setVisible(bool visible)
     }
 }
 
+void IncrementalSearchBar::setSearchProgress(int percent)
+{
+    if (percent < 0 || percent > 99) {
+        _searchProgress->hide();
+        return;
+    }
+
+    _searchProgress->setText(i18nc("@info:status Part of the output searched so far", "%1%", percent));
+    _searchProgress->show();
+}
+
 void IncrementalSearchBar::setFoundMatch(bool match)
 {
+    _searchProgress->hide();
+
     if (_searchEdit->text().isEmpty()) {
         clearLineEdit();
         return;
@@ -13,6 +13,7 @@
 
 class QAction;
 class QTimer;
+class QLabel;
 class QLineEdit;
 class QToolButton;
 
@@ -79,6 +80,13 @@ public:
      */
     void setFoundMatch(bool match);
 
+    /**
+     * Shows how much of the document has been searched, while a search is
+     * in progress. The indicator is hidden when @p percent is out of the
+     * range 0 to 99, or when setFoundMatch() is called.
+     */
+    void setSearchProgress(int percent);
+
     /** Returns the current search text */
     QString searchText();
 
@@ -142,6 +150,7 @@ private:
     Q_DISABLE_COPY(IncrementalSearchBar)
 
     QLineEdit *_searchEdit;
+    QLabel *_searchProgress;
     QAction *_caseSensitive;
     QAction *_regExpression;
     QAction *_highlightMatches;